@@ -0,0 +1,176 @@
+/**
+	@file arenautils.c
+
+	A simple 'bump' allocator, for the many small allocations
+	that all share the lifetime of a single tBuffer flush.
+
+	@version 0.92
+	@author Paul Chambers
+	@date 2005-2006
+*/
+/* $Header$ */
+
+#include "common.h"
+
+#include <stdlib.h>
+
+#include "arenautils.h"
+
+/**
+	used to work out the strictest alignment an allocation may need
+*/
+typedef union {
+	long	l;
+	double	d;
+	void	*p;
+} tAlign;
+
+/** rounds a size up to a multiple of the alignment */
+#define qAlignSize(size)	(((size) + sizeof(tAlign) - 1) & ~(sizeof(tAlign) - 1))
+
+/** the start of the memory that follows a block's header */
+#define qBlockData(block)	((char *)(block) + qAlignSize(sizeof(tArenaBlock)))
+
+static int useBlock(tArena *arena, size_t size);
+
+/*
+	private functions
+*/
+
+/**
+	@internal
+
+	Moves the arena on to a block with at least 'size' bytes available,
+	reusing the rest of the chain if it can, or adding a new block.
+
+	@param[in,out] 	arena 	the arena to advance
+	@param[in] 		size 	the number of bytes needed
+
+	@return int
+	@retval 0		all is well
+	@retval -108	unable to allocate a new block
+*/
+static int useBlock(tArena *arena, size_t size)
+{
+	tArenaBlock	*block;
+	tArenaBlock	**link;
+
+	/* try the blocks left over from before the last reset */
+	link = (arena->current != NULL) ? &arena->current->next : &arena->first;
+	while ((block = *link) != NULL && block->size < size)
+		link = &block->next;
+
+	if (block == NULL)
+	{
+		if (size < qArenaBlockSize)
+			size = qArenaBlockSize;
+
+		block = (tArenaBlock *)malloc(qAlignSize(sizeof(tArenaBlock)) + size);
+		if (block == NULL)
+			return (-108);
+
+		block->next = NULL;
+		block->size = size;
+	}
+	else
+	{
+		/* unlink it, so it can be put right after the current block */
+		*link = block->next;
+	}
+
+	if (arena->current != NULL)
+	{
+		block->next = arena->current->next;
+		arena->current->next = block;
+	}
+	else
+	{
+		block->next = arena->first;
+		arena->first = block;
+	}
+
+	arena->current = block;
+	arena->ptr = qBlockData(block);
+	arena->end = arena->ptr + block->size;
+
+	return 0;
+}
+
+/*
+	public functions
+*/
+
+/**
+	Initialize a tArena to the 'empty' state.
+
+	@param[out] 	arena 	the tArena to initialize
+*/
+void initArena(tArena *arena)
+{
+	arena->first = NULL;
+	arena->current = NULL;
+	arena->ptr = NULL;
+	arena->end = NULL;
+	arena->allocations = 0;
+}
+
+/**
+	Releases everything allocated from an arena at once.
+
+	@note the blocks are kept, so they can be reused.
+
+	@param[in,out] 	arena 	the tArena to reset
+*/
+void resetArena(tArena *arena)
+{
+	arena->current = NULL;
+	arena->ptr = NULL;
+	arena->end = NULL;
+}
+
+/**
+	Returns all of an arena's blocks to the heap.
+
+	@param[in,out] 	arena 	the tArena to free
+*/
+void freeArena(tArena *arena)
+{
+	tArenaBlock	*block;
+
+	while ((block = arena->first) != NULL)
+	{
+		arena->first = block->next;
+		free(block);
+	}
+	initArena(arena);
+}
+
+/**
+	Allocates memory from an arena.
+
+	The memory stays valid until the next resetArena() or freeArena().
+
+	@param[in,out] 	arena 	the tArena to allocate from
+	@param[in] 		size 	the number of bytes needed
+
+	@return a pointer to the memory, suitably aligned for any type
+	@retval NULL	unable to allocate memory
+*/
+void *arenaAlloc(tArena *arena, size_t size)
+{
+	char	*p;
+
+	size = qAlignSize(size);
+
+	if ((size_t)(arena->end - arena->ptr) < size || arena->ptr == NULL)
+	{
+		if (useBlock(arena, size) != 0)
+			return NULL;
+	}
+
+	p = arena->ptr;
+	arena->ptr += size;
+	++arena->allocations;
+
+	return p;
+}
@@ -0,0 +1,48 @@
+/**
+	@file arenautils.h
+
+	Public interface for arenautils.c
+
+	@version 0.92
+	@author Paul Chambers
+	@date 2005-2006
+*/
+/* $Header$ */
+
+/**
+	the minimum size of each block an arena allocates from.
+	Allocations larger than this get a block of their own.
+*/
+#define qArenaBlockSize	4096
+
+/**
+	one block of memory that an arena hands out pieces of.
+	The memory itself immediately follows this header.
+*/
+typedef struct tArenaBlock
+{
+	struct tArenaBlock	*next;	/**< the next block in the chain */
+	size_t	size;				/**< bytes available after the header */
+} tArenaBlock;
+
+/**
+	a 'bump' allocator.
+
+	Allocating just advances a pointer through the current block,
+	and everything is released at once by resetArena(). The blocks
+	are kept for reuse, so a reset arena doesn't go back to malloc()
+	until it needs more than it did before.
+*/
+typedef struct
+{
+	tArenaBlock	*first;		/**< the first block in the chain */
+	tArenaBlock	*current;	/**< the block being allocated from */
+	char	*ptr;			/**< the next free byte in the current block */
+	char	*end;			/**< just past the end of the current block */
+	size_t	allocations;	/**< the number of allocations made (for --stats) */
+} tArena;
+
+void initArena(tArena *arena);
+void resetArena(tArena *arena);
+void freeArena(tArena *arena);
+void *arenaAlloc(tArena *arena, size_t size);
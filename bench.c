@@ -0,0 +1,475 @@
+/**
+	@file bench.c
+	@brief A throughput benchmark for the parser.
+
+	Generates several synthetic C corpora in memory, each stressing
+	a different part of the state machine, then runs processMemory()
+	over each of them in-process and reports the throughput.
+	Each corpus is run in a child process of its own, so the peak
+	memory reported for it isn't swollen by the corpora before it.
+
+	Run it with 'make bench'.
+
+	@version 0.92
+	@author Paul Chambers
+	@date 2005-2006
+*/
+/* $Header$ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "arenautils.h"
+#include "sinkutils.h"
+#include "stringutils.h"
+#include "parser.h"
+#include "keywordutils.h"
+#include "typeutils.h"
+
+/** the parser expects these to exist */
+tAppOptions gOptions;
+
+/** where the parser's output goes */
+#define qNullDevice	"/dev/null"
+
+/** the default size of each corpus, in megabytes */
+#define qDefaultSize	8
+
+/** the default number of times to process each corpus */
+#define qDefaultRuns	3
+
+/**
+	the description of one synthetic corpus.
+*/
+typedef struct
+{
+	const char *name;						/**< shown in the report */
+	size_t (*generate)(tSink *sink, size_t size);	/**< returns the number of functions */
+	bool	crlf;							/**< convert line endings to CR/LF */
+} tCorpus;
+
+static unsigned long sSeed = 1;
+
+static unsigned int nextRandom(unsigned int range);
+static void indent(tSink *sink, int depth);
+static size_t genMixed(tSink *sink, size_t size);
+static size_t genNested(tSink *sink, size_t size);
+static size_t genGigantic(tSink *sink, size_t size);
+static size_t genComments(tSink *sink, size_t size);
+static size_t genReturns(tSink *sink, size_t size);
+static void toCrLf(tSink *sink);
+static double now(void);
+static long peakRSS(void);
+static int runCorpus(const tCorpus *corpus, size_t size, int runs, FILE *nullFile);
+
+/** the corpora, in the order they're reported */
+static const tCorpus sCorpora[] = {
+	{ "mixed",		genMixed,		false },
+	{ "nested",		genNested,		false },
+	{ "gigantic",	genGigantic,	false },
+	{ "comments",	genComments,	false },
+	{ "returns",	genReturns,		false },
+	{ "crlf",		genMixed,		true }
+};
+
+/**
+	@internal
+
+	A small, repeatable pseudo-random number generator,
+	so every run benchmarks exactly the same text.
+
+	@param[in] 	range 	the result is less than this
+
+	@return unsigned int
+*/
+static unsigned int nextRandom(unsigned int range)
+{
+	sSeed = sSeed * 1103515245UL + 12345UL;
+	return (unsigned int)((sSeed >> 16) & 0x7FFF) % range;
+}
+
+/**
+	@internal
+
+	Writes 'depth' tabs.
+
+	@param[in,out] 	sink 	where to write them
+	@param[in] 		depth 	how many
+*/
+static void indent(tSink *sink, int depth)
+{
+	while (depth-- > 0)
+		sinkChar(sink, '\t');
+}
+
+/**
+	@internal
+
+	Typical code: a mixture of commented and uncommented functions,
+	declarations and preprocessor lines.
+
+	@param[in,out] 	sink 	receives the corpus
+	@param[in] 		size 	the approximate size to generate
+
+	@return the number of functions generated
+*/
+static size_t genMixed(tSink *sink, size_t size)
+{
+	size_t	count = 0;
+
+	sinkPuts(sink, "/* synthetic corpus */\n#include <stdio.h>\n\n");
+	while (sink->length < size)
+	{
+		if (nextRandom(2) == 0)
+			sinkPuts(sink, "/*\n\tadds things up, in a 'clever' way.\n\t"
+						   "todo: make it less clever */\n");
+		sinkPuts(sink, "#define qLimit\t100\n"
+			"static const char *sNames[] = { \"one\", \"two\", \"{\" };\n"
+			"static int add(int a, const char *b, char *argv[])\n{\n"
+			"\tint i = 0;\n\n"
+			"\t// fixme: check b\n"
+			"\tif (a > qLimit)\n\t\treturn (-1);\n"
+			"\tfor (i = 0; b[i] != '\\0'; ++i)\n\t{\n"
+			"\t\ta += b[i] == '\\'' ? 1 : 2;\n\t}\n"
+			"\treturn (a + i);\n}\n\n");
+		++count;
+	}
+	return count;
+}
+
+/**
+	@internal
+
+	Functions with deeply nested blocks.
+
+	@param[in,out] 	sink 	receives the corpus
+	@param[in] 		size 	the approximate size to generate
+
+	@return the number of functions generated
+*/
+static size_t genNested(tSink *sink, size_t size)
+{
+	size_t	count = 0;
+	int		depth, i;
+	char	line[80];
+
+	while (sink->length < size)
+	{
+		sinkPuts(sink, "void nested(int *p)\n{\n");
+		depth = 1 + nextRandom(40);
+		for (i = 1; i <= depth; ++i)
+		{
+			indent(sink, i);
+			sprintf(line, "if (p[%d] != %d) {\n", i, nextRandom(1000));
+			sinkPuts(sink, line);
+		}
+		indent(sink, depth + 1);
+		sinkPuts(sink, "*p = 0;\n");
+		for (i = depth; i >= 1; --i)
+		{
+			indent(sink, i);
+			sinkPuts(sink, "}\n");
+		}
+		sinkPuts(sink, "}\n\n");
+		++count;
+	}
+	return count;
+}
+
+/**
+	@internal
+
+	A few enormous functions, much larger than the
+	initial size of a tBuffer.
+
+	@param[in,out] 	sink 	receives the corpus
+	@param[in] 		size 	the approximate size to generate
+
+	@return the number of functions generated
+*/
+static size_t genGigantic(tSink *sink, size_t size)
+{
+	size_t	count = 0;
+	size_t	limit;
+	char	line[80];
+
+	while (sink->length < size)
+	{
+		limit = sink->length + 1024 * 1024;
+		sinkPuts(sink, "/* generated */\nlong gigantic(long x, long *y)\n{\n");
+		while (sink->length < limit)
+		{
+			sprintf(line, "\tx = (x * %u) ^ y[%u]; /* mix */\n",
+					nextRandom(30000), nextRandom(64));
+			sinkPuts(sink, line);
+		}
+		sinkPuts(sink, "\treturn x;\n}\n\n");
+		++count;
+	}
+	return count;
+}
+
+/**
+	@internal
+
+	Functions with long comments, both before and inside them.
+
+	@param[in,out] 	sink 	receives the corpus
+	@param[in] 		size 	the approximate size to generate
+
+	@return the number of functions generated
+*/
+static size_t genComments(tSink *sink, size_t size)
+{
+	size_t	count = 0;
+	int		lines;
+
+	while (sink->length < size)
+	{
+		sinkPuts(sink, "/*\n");
+		for (lines = 10 + nextRandom(50); lines > 0; --lines)
+			sinkPuts(sink, " * Lorem ipsum dolor sit amet, consectetur adipiscing "
+						   "elit, sed do eiusmod tempor incididunt ut labore.\n");
+		sinkPuts(sink, " */\nint commented(void)\n{\n");
+		for (lines = 5 + nextRandom(20); lines > 0; --lines)
+			sinkPuts(sink, "\t// note: the quick brown fox jumps over the lazy dog\n"
+						   "\t/* todo: the quick brown fox jumps over the lazy dog */\n");
+		sinkPuts(sink, "\treturn 0;\n}\n\n");
+		++count;
+	}
+	return count;
+}
+
+/**
+	@internal
+
+	Functions with many return statements.
+
+	@param[in,out] 	sink 	receives the corpus
+	@param[in] 		size 	the approximate size to generate
+
+	@return the number of functions generated
+*/
+static size_t genReturns(tSink *sink, size_t size)
+{
+	size_t	count = 0;
+	int		returns;
+	char	line[80];
+
+	while (sink->length < size)
+	{
+		sinkPuts(sink, "int returns(int code)\n{\n\tswitch (code)\n\t{\n");
+		for (returns = 10 + nextRandom(90); returns > 0; --returns)
+		{
+			sprintf(line, "\tcase %d:\n\t\treturn (%d);\n",
+					nextRandom(10000), (int)nextRandom(5) - 2);
+			sinkPuts(sink, line);
+		}
+		sinkPuts(sink, "\t}\n\treturn -1;\n}\n\n");
+		++count;
+	}
+	return count;
+}
+
+/**
+	@internal
+
+	Converts the line endings of a corpus to CR/LF pairs.
+
+	@param[in,out] 	sink 	the corpus to convert
+*/
+static void toCrLf(tSink *sink)
+{
+	tSink	converted;
+	size_t	i;
+
+	if (initSink(&converted, NULL) == 0)
+	{
+		for (i = 0; i < sink->length; ++i)
+		{
+			if (sink->data[i] == '\n')
+				sinkChar(&converted, '\r');
+			sinkChar(&converted, sink->data[i]);
+		}
+		freeSink(sink);
+		*sink = converted;
+	}
+}
+
+/**
+	@internal
+
+	@return the current time, in seconds
+*/
+static double now(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+	@internal
+
+	@return the peak resident set size of the process so far, in kilobytes
+			(which is why each corpus gets a process of its own)
+*/
+static long peakRSS(void)
+{
+	struct rusage	usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+/**
+	@internal
+
+	Generates a corpus, processes it 'runs' times and reports
+	the fastest run.
+
+	@param[in] 	corpus 		the corpus to benchmark
+	@param[in] 	size 		the approximate size of the corpus
+	@param[in] 	runs 		how many times to process it
+	@param[in] 	nullFile 	where to send the output
+
+	@return the result of processMemory()
+*/
+static int runCorpus(const tCorpus *corpus, size_t size, int runs, FILE *nullFile)
+{
+	tSink	text, out;
+	size_t	functions;
+	double	start, elapsed, best;
+	int		result = 0;
+	int		i;
+
+	if (initSink(&text, NULL) != 0)
+		return (-108);
+
+	sSeed = 1;
+	functions = corpus->generate(&text, size);
+	if (corpus->crlf)
+		toCrLf(&text);
+
+	best = 0;
+	for (i = 0; i < runs && result == 0; ++i)
+	{
+		start = now();
+		result = initSink(&out, nullFile);
+		if (result == 0)
+		{
+			result = processMemory(&out, text.data, text.length, "bench.c");
+			freeSink(&out);
+		}
+		elapsed = now() - start;
+		if (i == 0 || elapsed < best)
+			best = elapsed;
+	}
+
+	if (result != 0)
+		fprintf(stderr, "### error: %s failed (%d)\n", corpus->name, result);
+	else
+	{
+		if (best <= 0)
+			best = 1e-9;
+		printf("%-10s %9.2f %9.3f %10.1f %12.0f %10ld\n",
+			corpus->name, text.length / 1048576.0, best,
+			text.length / 1048576.0 / best, functions / best, peakRSS());
+	}
+
+	freeSink(&text);
+
+	return result;
+}
+
+/**
+	The benchmark's entry point.
+
+	@param[in] 	argc 	count of arguments on command line
+	@param[in] 	argv 	'-s <megabytes>' sets the size of each corpus,
+						'-n <count>' the number of runs of each
+
+	@return int
+	@retval 0	everything went smoothly
+	@retval 1	a corpus couldn't be processed
+*/
+int main(int argc, char *argv[])
+{
+	FILE	*nullFile;
+	pid_t	child;
+	size_t	size = qDefaultSize;
+	int		runs = qDefaultRuns;
+	int		result = 0;
+	size_t	i;
+	int		arg, status;
+
+	for (arg = 1; arg + 1 < argc; arg += 2)
+	{
+		if (strcmp(argv[arg], "-s") == 0)
+			size = atoi(argv[arg + 1]);
+		else if (strcmp(argv[arg], "-n") == 0)
+			runs = atoi(argv[arg + 1]);
+	}
+	if (size < 1) size = 1;
+	if (runs < 1) runs = 1;
+
+	if (initKeywords() != 0)
+	{
+		fprintf(stderr, "### error: unable to allocate memory\n");
+		return 1;
+	}
+
+	nullFile = fopen(qNullDevice, "w");
+	if (nullFile == NULL)
+	{
+		fprintf(stderr, "### error: unable to open '%s'\n", qNullDevice);
+		return 1;
+	}
+
+	printf("insertdox %s benchmark, best of %d runs\n", qVersion, runs);
+	printf("%-10s %9s %9s %10s %12s %10s\n",
+		"corpus", "MB", "seconds", "MB/s", "functions/s", "peak RSS K");
+
+	for (i = 0; i < sizeof(sCorpora) / sizeof(sCorpora[0]); ++i)
+	{
+		/* so the child doesn't write out the same buffered output again */
+		fflush(stdout);
+
+		child = fork();
+		if (child == 0)
+		{
+			status = runCorpus(&sCorpora[i], size * 1048576, runs, nullFile);
+			fflush(stdout);
+			_exit(status != 0 ? 1 : 0);
+		}
+
+		if (child < 0)
+		{
+			fprintf(stderr, "### error: unable to start a process for %s\n",
+					sCorpora[i].name);
+			result = 1;
+		}
+		else if (waitpid(child, &status, 0) != child
+			  || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		{
+			result = 1;
+		}
+	}
+
+	fclose(nullFile);
+	freeKeywords();
+	forgetTypes();
+
+	return result;
+}
@@ -1 +1 @@
-/**	@file bufferutils.c	Functions that support the tBuffer structure.		tBuffer is an object that maintains all the state associated with	the stream being processed. The parser stuffs the incoming stream	into the tBuffer, and flushes it when it encounters certain syntax	boundaries as it does so. 	@version 0.9	@author Paul Chambers	@date 2005-2006*//* $Header$ */#include "common.h"#include <stdio.h>#include "stringutils.h"#include "bufferutils.h"#include "parser.h"static void initRange(tRange *rng);/*	private functions*//**	@internal	shorthand to zero a tRange	@param[out] 	rng 	a pointer to tRange*/static void initRange(tRange *rng){	rng->count	= 0;	rng->start	= NULL;	rng->end 	= NULL;}/*	public functions*//**	Clears a tBuffer back to the 'empty' state.	@note should not be used to initialize a tBuffer - see initBuffer()	@param[out] 	buf 	the tBuffer to clear*/void clearBuffer(tBuffer *buf){	buf->ptr = &buf->data[0];		buf->commentStart = NULL;	buf->statementStart = NULL;	if (buf->todos != NULL)		freeStringList(&(buf->todos));	if (buf->notes != NULL)		freeStringList(&(buf->notes));	if (buf->retvals != NULL)		freeStringList(&(buf->retvals));	buf->fileComment = false;		initRange(&buf->description);	initRange(&buf->function);	initRange(&buf->arglist);	initRange(&buf->body);}/**	Initialize a tBuffer object.	@param[out] 	buf 	the tBuffer to initialize	@param[in]	 	file 	the output file*/void initBuffer(tBuffer *buf, FILE *file){	buf->end = &buf->data[qBufferSize];	buf->file = file;	buf->commentStart = NULL;	buf->statementStart = NULL;	buf->todos = NULL;	buf->notes = NULL;	buf->retvals = NULL;	clearBuffer(buf);}/**	output a block of characters within a tBuffer.	Typically used to output a range of characters	within a tBuffer.	@param[in] 	buf 	used to identify the output file	@param[in] 	start 	the first character to output	@param[in] 	end 	points just after the last character to output*/void dumpBlock(tBuffer *buf, const char *start, const char *end){	size_t count = (end - start);	if (count > 0)		fwrite(start, sizeof(char), count, buf->file);}/**	Brief description needed.	Followed by a more complete description.	@param[in,out] 	buf 	a pointer to tBuffer	@param[in] 	c 	int	@return int	@retval	0	all is well	@retval 1	buffer full*/int emitChar(tBuffer *buf, int c){	*(buf->ptr) = (char)c;	++(buf->ptr);		return (buf->ptr >= buf->end);}
\ No newline at end of file
+/**	@file bufferutils.c	Functions that support the tBuffer structure.		tBuffer is an object that maintains all the state associated with	the stream being processed. The parser stuffs the incoming stream	into the tBuffer, and flushes it when it encounters certain syntax	boundaries as it does so. 	@version 0.9	@author Paul Chambers	@date 2005-2006*//* $Header$ */#include "common.h"#include <stdlib.h>#include <stdio.h>#include <string.h>#include "arenautils.h"#include "sinkutils.h"#include "stringutils.h"#include "bufferutils.h"#include "parser.h"static void initRange(tRange *rng);static void rebasePointer(char **p, char *oldData, char *newData);static void rebaseRange(tRange *rng, char *oldData, char *newData);/*	private functions*//**	@internal	shorthand to zero a tRange	@param[out] 	rng 	a pointer to tRange*/static void initRange(tRange *rng){	rng->count	= 0;	rng->start	= NULL;	rng->end 	= NULL;}/**	@internal	moves a pointer into a tBuffer's storage to the	same position in the storage's new location.	@param[in,out] 	p 		the pointer to adjust (may be NULL)	@param[in] 		oldData the previous location of the storage	@param[in] 		newData the new location of the storage*/static void rebasePointer(char **p, char *oldData, char *newData){	if (*p != NULL)		*p = &newData[*p - oldData];}/**	@internal	shorthand to rebase both ends of a tRange	@param[in,out] 	rng 	the tRange to adjust	@param[in] 		oldData the previous location of the storage	@param[in] 		newData the new location of the storage*/static void rebaseRange(tRange *rng, char *oldData, char *newData){	rebasePointer(&rng->start, oldData, newData);	rebasePointer(&rng->end, oldData, newData);}/*	public functions*//**	Clears a tBuffer back to the 'empty' state.	@note should not be used to initialize a tBuffer - see initBuffer()	@param[out] 	buf 	the tBuffer to clear*/void clearBuffer(tBuffer *buf){	buf->ptr = &buf->data[0];		buf->commentStart = NULL;	buf->statementStart = NULL;	/* the lists were allocated from the arena */	buf->todos = NULL;	buf->notes = NULL;	clearSliceSet(&buf->retvals);	resetArena(&buf->arena);	buf->fileComment = false;	buf->spilling = false;		initRange(&buf->description);	initRange(&buf->function);	initRange(&buf->arglist);	initRange(&buf->body);}/**	Initialize a tBuffer object.	@param[out] 	buf 	the tBuffer to initialize	@param[in]	 	out 	where to write the output	@param[in]	 	filename 	the name of the file being processed								(NULL if stdin)	@return int	@retval 0		all is well	@retval -108	unable to allocate the buffer's storage*/int initBuffer(tBuffer *buf, tSink *out, const char *filename){	buf->data = (char *)malloc(qBufferSize);	if (buf->data == NULL)		return (-108);	buf->end = &buf->data[qBufferSize];	buf->limit = 0;	buf->out = out;	buf->filename = filename;	buf->symbols = NULL;	buf->path = NULL;	buf->commentStart = NULL;	buf->statementStart = NULL;	buf->todos = NULL;	buf->notes = NULL;	clearSliceSet(&buf->retvals);	initArena(&buf->arena);	initBuilder(&buf->type);	initBuilder(&buf->argType);	buf->functions = 0;	buf->documented = 0;	buf->overflows = 0;	buf->missing = 0;	buf->line = 1;	buf->afterCR = false;	clearBuffer(buf);	return 0;}/**	Releases everything a tBuffer holds.	@param[in,out] 	buf 	the tBuffer to free*/void freeBuffer(tBuffer *buf){	clearBuffer(buf);	freeArena(&buf->arena);	freeBuilder(&buf->type);	freeBuilder(&buf->argType);	free(buf->data);	buf->data = NULL;	buf->ptr = NULL;	buf->end = NULL;}/**	Doubles the storage of a tBuffer.	Every pointer the tBuffer holds into its storage is moved	along with it, so the ranges found so far remain valid.	Since the storage doubles each time, the cost of growing	is amortized to a constant per character.	The storage never grows past the tBuffer's limit, if it has one.	@param[in,out] 	buf 	the tBuffer to grow	@return int	@retval	0		all is well	@retval -108	unable to allocate more memory, or it would be					over the limit (buf is unchanged)*/int growBuffer(tBuffer *buf){	char	*oldData = buf->data;	char	*newData;	size_t	size = (buf->end - buf->data) * 2;	if (buf->limit != 0 && size > buf->limit)		return (-108);	newData = (char *)malloc(size);	if (newData == NULL)		return (-108);	memcpy(newData, oldData, buf->ptr - oldData);	rebaseRange(&buf->description, oldData, newData);	rebaseRange(&buf->function, oldData, newData);	rebaseRange(&buf->arglist, oldData, newData);	rebaseRange(&buf->body, oldData, newData);	rebasePointer(&buf->commentStart, oldData, newData);	rebasePointer(&buf->statementStart, oldData, newData);	rebasePointer(&buf->ptr, oldData, newData);	buf->data = newData;	buf->end = &newData[size];	free(oldData);	return 0;}/**	Writes out what a tBuffer holds, and empties the storage,	without forgetting where the parser is. Only used when the	contents can't be a function (see tBuffer::spilling), so they	would be written out unchanged anyway, and nothing needs to	look back at them. With -p, they're just dropped, and with	--check, they're only counted (as they are with symbols, too).	@param[in,out] 	buf 	the tBuffer to spill*/void spillBuffer(tBuffer *buf){	if (gOptions.check || buf->symbols != NULL)		countLines(buf, buf->data, buf->ptr);	if (!gOptions.check && !gOptions.onlyPrototypes)		dumpBlock(buf, buf->data, buf->ptr);	buf->ptr = buf->data;	buf->commentStart = NULL;	buf->statementStart = NULL;	/* the counts stay, so the rest is still written out unchanged */	buf->description.start = buf->description.end = NULL;	buf->function.start = buf->function.end = NULL;	buf->arglist.start = buf->arglist.end = NULL;	buf->body.start = buf->body.end = NULL;}/**	output a block of characters within a tBuffer.	Typically used to output a range of characters	within a tBuffer.	@param[in] 	buf 	used to identify the output file	@param[in] 	start 	the first character to output	@param[in] 	end 	points just after the last character to output*/void dumpBlock(tBuffer *buf, const char *start, const char *end){	if (end > start)		sinkWrite(buf->out, start, end - start);}/**	Counts the lines in a block of characters that's been	dealt with, to keep track of which line the tBuffer's	storage starts on. A line may end with a newline, a	carriage return, or both (which only count once).	@param[in,out] 	buf 	the tBuffer the characters came from	@param[in] 	start 	the first character to count	@param[in] 	end 	points just after the last character to count*/void countLines(tBuffer *buf, const char *start, const char *end){	const char	*p;	for (p = start; p < end; ++p)	{		if (*p == '\r' || (*p == '\n' && !buf->afterCR))			++buf->line;		buf->afterCR = (bool)(*p == '\r');	}}/**	Appends a block of characters to a tBuffer.	The storage is grown as needed to hold the whole block, and	left with room for at least one more character, as emitChar()	would have. If the buffer is spilling, it's written out instead	of growing, along with the block if that still wouldn't fit.	@param[in,out] 	buf 	a pointer to tBuffer	@param[in] 	start 	the first character to append	@param[in] 	count 	the number of characters to append	@return int	@retval	0	all is well	@retval 1	not enough memory (nothing was appended)*/int emitBlock(tBuffer *buf, const char *start, size_t count){	if (buf->spilling && (size_t)(buf->end - buf->ptr) <= count)	{		spillBuffer(buf);		if ((size_t)(buf->end - buf->ptr) <= count)		{			if (gOptions.check || buf->symbols != NULL)				countLines(buf, start, start + count);			if (!gOptions.check && !gOptions.onlyPrototypes)				sinkWrite(buf->out, start, count);			return 0;		}	}	while ((size_t)(buf->end - buf->ptr) <= count)	{		if (growBuffer(buf) != 0)			return 1;	}	memcpy(buf->ptr, start, count);	buf->ptr += count;	return 0;}/**	Appends a character to a tBuffer.	The storage is grown when it fills up (or spilled, if the	buffer is spilling), so this only reports 'full' if there's no	memory left to grow it, or it's reached the buffer's limit.	@param[in,out] 	buf 	a pointer to tBuffer	@param[in] 	c 	int	@return int	@retval	0	all is well	@retval 1	buffer full*/int emitChar(tBuffer *buf, int c){	*(buf->ptr) = (char)c;	++(buf->ptr);	if (buf->ptr >= buf->end && buf->spilling)	{		spillBuffer(buf);		return 0;	}		return (buf->ptr >= buf->end && growBuffer(buf) != 0);}
\ No newline at end of file
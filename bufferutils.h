@@ -1 +1 @@
-/**	@file bufferutils.h	Public interface for bufferutils.c	@version 0.91	@author Paul Chambers	@date 2005-2006*//* $Header$ *//**	The maximum 'chunk' that can be processed.	Single functions larger than this will be output	as multiple chunks, and so won't be	processed	completely (though they'll still be copied to	the output).		Though if this limitation affects you, it's	probably the least of your worries...*/#define qBufferSize	65000/**	a pair of pointers that defines a 'run' of characters.*/typedef struct {	char *start;/**< points at the first character in the range */	char *end;	/**< points just past the last character in the range */	int	count;	/**< not a character count - a count of occurances */} tRange;/**	Contains accumulated characters and state from parser.	This is the main structure for the parser. It accumulates a block of	characters, and the various state information that the parser's	state machine determines is significant.	Output is generated when a buffer is flushed using flushBuffer(),	which uses the state to determine if special processing is needed	to output the buffer's contents.	@see processFile()	@see flushBuffer()*/typedef struct {	/* the final destination */	FILE *file;				/**< output file */	bool	fileComment;	/**< only set if first non-whitespace in input is a comment */	/* the following are at depthCurly 0 */	tRange	description;	/**< last comment */	tRange	function;		/**< last statement->round bracket */ 	tRange	arglist;		/**< ( to ) at depthRound 0 */	tRange	body;			/**< { to } at depthCurly 0 */	/* the following are only below depthCurly 0 */	char *commentStart;		/**< used to parse comments */	char *statementStart;	/**< used to parse statements */	tStringList	*notes;		/**< 'notes' pulled from comments */	tStringList	*todos;		/**< 'todos' pulled from comments */	tStringList *retvals;	/**< return values pulled from return statements */	char *ptr; /**< our 'place' in the buffer */	char *end; /**< speeds up boundary checking (i.e only compute it once) */	/** storage for the raw characters we accumulate as we're parsing */	char data[qBufferSize];} tBuffer;void initBuffer(tBuffer *buf, FILE *file);void clearBuffer(tBuffer *buf);void dumpBlock(tBuffer *buf, const char *start, const char *end);int emitChar(tBuffer *buf, int c);
\ No newline at end of file
+/**	@file bufferutils.h	Public interface for bufferutils.c	@version 0.91	@author Paul Chambers	@date 2005-2006*//* $Header$ *//**	The initial size of a tBuffer's storage.	The storage doubles whenever it fills up, so single	functions larger than this are still processed	completely. Only if memory runs out is the buffer	output as multiple chunks (which won't be processed).*/#define qBufferSize	65536/**	a pair of pointers that defines a 'run' of characters.*/typedef struct {	char *start;/**< points at the first character in the range */	char *end;	/**< points just past the last character in the range */	int	count;	/**< not a character count - a count of occurances */} tRange;/**	Contains accumulated characters and state from parser.	This is the main structure for the parser. It accumulates a block of	characters, and the various state information that the parser's	state machine determines is significant.	Output is generated when a buffer is flushed using flushBuffer(),	which uses the state to determine if special processing is needed	to output the buffer's contents.	@see processFile()	@see flushBuffer()*/typedef struct {	/* the final destination */	tSink	*out;			/**< buffers the output on its way to the file */	const char *filename;	/**< the filename being processed (NULL if stdin) */	tSink	*symbols;		/**< receives a record of each function (NULL if								 they aren't wanted, see --symbols) */	const char *path;		/**< the path to give in each record */	bool	fileComment;	/**< only set if first non-whitespace in input is a comment */	bool	spilling;		/**< can't be a function, so rather than grow,								 the buffer is written out (see spillBuffer()) */	/* the following are at depthCurly 0 */	tRange	description;	/**< last comment */	tRange	function;		/**< last statement->round bracket */ 	tRange	arglist;		/**< ( to ) at depthRound 0 */	tRange	body;			/**< { to } at depthCurly 0 */	/* the following are only below depthCurly 0 */	char *commentStart;		/**< used to parse comments */	char *statementStart;	/**< used to parse statements */	tSliceList	*notes;		/**< 'notes' pulled from comments */	tSliceList	*todos;		/**< 'todos' pulled from comments */	tSliceSet	retvals;	/**< return values pulled from return statements,								 in source order, without repeats */	tArena	arena;			/**< holds the lists above until the next flush */	/* where processTyped() describes types, kept to reuse the storage */	tBuilder	type;		/**< the function's (return) type */	tBuilder	argType;	/**< the type of one of its arguments */	/* counted for --stats, and not reset by clearBuffer() */	size_t	functions;		/**< functions annotated */	size_t	documented;		/**< functions passed through, already documented */	size_t	overflows;		/**< flushes forced by running out of memory */	size_t	missing;		/**< functions found without a Doxygen comment (--check) */	/* only kept up to date with --check, or with symbols */	long	line;			/**< the line that data starts on */	bool	afterCR;		/**< the last character counted was a '\r' */	char *ptr; /**< our 'place' in the buffer */	char *end; /**< speeds up boundary checking (i.e only compute it once) */	size_t limit; /**< the most storage to grow to (0 if there's no limit) */	/** storage for the raw characters we accumulate as we're parsing.		may be moved by growBuffer(), which adjusts the pointers above */	char *data;} tBuffer;int initBuffer(tBuffer *buf, tSink *out, const char *filename);void freeBuffer(tBuffer *buf);void clearBuffer(tBuffer *buf);int growBuffer(tBuffer *buf);void spillBuffer(tBuffer *buf);void dumpBlock(tBuffer *buf, const char *start, const char *end);void countLines(tBuffer *buf, const char *start, const char *end);int emitChar(tBuffer *buf, int c);int emitBlock(tBuffer *buf, const char *start, size_t count);
\ No newline at end of file
@@ -0,0 +1,441 @@
+/**
+	@file cacheutils.c
+
+	A persistent record of the files that have already been processed.
+
+	For each file, the cache remembers the size and modification time
+	the file had after insertdox last wrote (or checked) it, and a hash
+	of what insertdox wrote. A file that still has the same size and
+	modification time doesn't need to be read again, and one whose
+	contents hash to the same value is still insertdox's output, even
+	if something has touched it since.
+
+	The cache is a text file, one file per line:
+	@verbatim <size> <seconds> <nanoseconds> <hash> <path> @endverbatim
+
+	Its first line holds a hash of everything besides the file itself
+	that decides what insertdox writes: its version, the options that
+	change the output, and the contents of the boilerplate and keyword
+	files. A cache written with anything different is ignored (and
+	replaced), so changing an option, or upgrading, processes every
+	file again rather than skipping files with the wrong output.
+
+	Lookups and updates may come from several worker threads at once.
+
+	@version 0.92
+	@author Paul Chambers
+	@date 2005-2006
+*/
+/* $Header$ */
+
+#include "common.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "fileutils.h"
+#include "cacheutils.h"
+
+#ifdef qHaveThreads
+#include <pthread.h>
+#endif
+
+/** the initial number of slots in the cache's hash table */
+#define qCacheSlots	1024
+
+/**
+	what the cache knows about one file.
+*/
+typedef struct tCacheEntry
+{
+	struct tCacheEntry	*next;	/**< the next entry in the same slot */
+	tHash		key;			/**< hash of the path, to speed up lookups */
+	tFileStamp	stamp;			/**< the file's size and modification time */
+	tHash		hash;			/**< hash of the file's contents */
+	char		path[1];		/**< the path, extends past the end of the struct */
+} tCacheEntry;
+
+/**
+	the whole cache, as a hash table keyed by path.
+*/
+struct tCache
+{
+	char	*filename;		/**< where the cache is kept */
+	tHash	options;		/**< what the entries were written with */
+	tCacheEntry	**slots;	/**< the hash table */
+	size_t	slotCount;		/**< the number of slots in the table */
+	size_t	entryCount;		/**< the number of entries in the table */
+	bool	changed;		/**< needs to be saved */
+#ifdef qHaveThreads
+	pthread_mutex_t	lock;	/**< protects the table */
+#endif
+};
+
+static tCacheEntry **findEntry(tCache *cache, const char *path, tHash key);
+static void growCache(tCache *cache);
+static void addEntry(tCache *cache, const char *path,
+					 const tFileStamp *stamp, tHash hash);
+
+/*
+	private functions
+*/
+
+/**
+	@internal
+
+	Finds the link that points at a path's entry.
+
+	@param[in] 	cache 	the cache to search
+	@param[in] 	path 	the path to look for
+	@param[in] 	key 	the hash of the path
+
+	@return the link to the entry, or the empty link at the end
+			of the slot's chain if the path isn't in the cache
+*/
+static tCacheEntry **findEntry(tCache *cache, const char *path, tHash key)
+{
+	tCacheEntry	**link = &cache->slots[key % cache->slotCount];
+
+	while (*link != NULL
+		&& ((*link)->key != key || strcmp((*link)->path, path) != 0))
+	{
+		link = &(*link)->next;
+	}
+
+	return link;
+}
+
+/**
+	@internal
+
+	Doubles the number of slots in the hash table. If there
+	isn't enough memory, the table just gets more crowded.
+
+	@param[in,out] 	cache 	the cache to grow
+*/
+static void growCache(tCache *cache)
+{
+	tCacheEntry	**slots, *entry;
+	size_t	count = cache->slotCount * 2;
+	size_t	i;
+
+	slots = (tCacheEntry **)calloc(count, sizeof(tCacheEntry *));
+	if (slots != NULL)
+	{
+		for (i = 0; i < cache->slotCount; ++i)
+		{
+			while ((entry = cache->slots[i]) != NULL)
+			{
+				cache->slots[i] = entry->next;
+				entry->next = slots[entry->key % count];
+				slots[entry->key % count] = entry;
+			}
+		}
+		free(cache->slots);
+		cache->slots = slots;
+		cache->slotCount = count;
+	}
+}
+
+/**
+	@internal
+
+	Adds or replaces a path's entry. The caller holds the lock.
+
+	@param[in,out] 	cache 	the cache to update
+	@param[in] 		path 	the path of the file
+	@param[in] 		stamp 	the file's size and modification time
+	@param[in] 		hash 	the hash of the file's contents
+*/
+static void addEntry(tCache *cache, const char *path,
+					 const tFileStamp *stamp, tHash hash)
+{
+	tCacheEntry	**link, *entry;
+	tHash	key = hashBlock(path, strlen(path));
+
+	link = findEntry(cache, path, key);
+	entry = *link;
+	if (entry == NULL)
+	{
+		entry = (tCacheEntry *)malloc(sizeof(tCacheEntry) + strlen(path));
+		if (entry == NULL)
+			return;
+
+		entry->next = NULL;
+		entry->key = key;
+		strcpy(entry->path, path);
+		*link = entry;
+
+		if (++cache->entryCount > cache->slotCount)
+			growCache(cache);
+	}
+	entry->stamp = *stamp;
+	entry->hash = hash;
+}
+
+/*
+	public functions
+*/
+
+/**
+	Hashes a block of characters (64-bit FNV-1a).
+
+	@param[in] 	data 	the characters to hash
+	@param[in] 	length 	the number of characters
+
+	@return tHash
+*/
+tHash hashBlock(const char *data, size_t length)
+{
+	return continueHash(qHashStart, data, length);
+}
+
+/**
+	Adds a block of characters to a hash, so something that
+	arrives in pieces hashes the same as it would in one go.
+
+	@param[in] 	hash 	the hash of everything before the block
+						(qHashStart if there's nothing before it)
+	@param[in] 	data 	the characters to hash
+	@param[in] 	length 	the number of characters
+
+	@return tHash
+*/
+tHash continueHash(tHash hash, const char *data, size_t length)
+{
+	const byte	*p = (const byte *)data;
+	const byte	*end = p + length;
+
+	while (p < end)
+	{
+		hash ^= *p++;
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+/**
+	Loads a cache from a file.
+
+	A missing file isn't an error - it just means starting with
+	an empty cache, as does one written with different options.
+	Lines that can't be understood are ignored.
+
+	@param[in] 	filename 	where the cache is kept
+	@param[in] 	options 	a hash of the version, options and files
+							that decide the output
+
+	@return the cache
+	@retval NULL	unable to allocate memory
+*/
+tCache *loadCache(const char *filename, tHash options)
+{
+	tCache		*cache;
+	FILE		*file;
+	tFileStamp	stamp;
+	tHash		hash, written;
+	char		line[4096];
+	int			pathStart;
+	size_t		len;
+
+	cache = (tCache *)malloc(sizeof(tCache));
+	if (cache == NULL)
+		return NULL;
+
+	cache->filename = (char *)malloc(strlen(filename) + 1);
+	cache->slotCount = qCacheSlots;
+	cache->slots = (tCacheEntry **)calloc(qCacheSlots, sizeof(tCacheEntry *));
+	if (cache->filename == NULL || cache->slots == NULL)
+	{
+		free(cache->filename);
+		free(cache->slots);
+		free(cache);
+		return NULL;
+	}
+	strcpy(cache->filename, filename);
+	cache->options = options;
+	cache->entryCount = 0;
+	cache->changed = false;
+#ifdef qHaveThreads
+	pthread_mutex_init(&cache->lock, NULL);
+#endif
+
+	file = fopen(filename, "r");
+	if (file != NULL)
+	{
+		written = 0;
+		if (fgets(line, sizeof(line), file) == NULL
+		 || strncmp(line, qCacheSignature, strlen(qCacheSignature)) != 0
+		 || sscanf(&line[strlen(qCacheSignature)], " %llx", &written) != 1
+		 || written != options)
+		{
+			/* from an older insertdox, or other options */
+			cache->changed = true;
+		}
+		else
+		{
+			while (fgets(line, sizeof(line), file) != NULL)
+			{
+				len = strlen(line);
+				if (len > 0 && line[len - 1] == '\n')
+					line[--len] = '\0';
+
+				pathStart = 0;
+				if (sscanf(line, "%lld %lld %ld %llx %n",
+						   &stamp.size, &stamp.mtime, &stamp.mtimeNsec,
+						   &hash, &pathStart) >= 4
+				 && pathStart > 0 && line[pathStart] != '\0')
+				{
+					addEntry(cache, &line[pathStart], &stamp, hash);
+				}
+			}
+		}
+		fclose(file);
+	}
+
+	return cache;
+}
+
+/**
+	Writes a cache back to its file, if anything has changed.
+
+	The cache is written to a temporary file first, which then
+	replaces the original, so a crash can't leave it half-written.
+
+	@param[in,out] 	cache 	the cache to save
+
+	@return int
+	@retval 0	all is well
+	@retval -2	unable to write the cache
+*/
+int saveCache(tCache *cache)
+{
+	FILE		*file;
+	tCacheEntry	*entry;
+	char		*tmpname;
+	size_t		i;
+	int			result = 0;
+
+	if (!cache->changed)
+		return 0;
+
+	tmpname = (char *)malloc(strlen(cache->filename) + 5);
+	if (tmpname == NULL)
+		return (-2);
+	strcpy(tmpname, cache->filename);
+	strcat(tmpname, ".tmp");
+
+	file = fopen(tmpname, "w");
+	if (file == NULL)
+		result = -2;
+	else
+	{
+		fprintf(file, "%s %llx\n", qCacheSignature, cache->options);
+		for (i = 0; i < cache->slotCount; ++i)
+		{
+			for (entry = cache->slots[i]; entry != NULL; entry = entry->next)
+			{
+				/* a path with a line ending in it can't be read back */
+				if (strpbrk(entry->path, "\r\n") == NULL)
+					fprintf(file, "%lld %lld %ld %llx %s\n",
+							entry->stamp.size, entry->stamp.mtime,
+							entry->stamp.mtimeNsec, entry->hash, entry->path);
+			}
+		}
+		if (ferror(file))
+			result = -2;
+		if (fclose(file) != 0)
+			result = -2;
+
+		if (result == 0 && rename(tmpname, cache->filename) != 0)
+			result = -2;
+		if (result != 0)
+			remove(tmpname);
+	}
+	free(tmpname);
+
+	if (result == 0)
+		cache->changed = false;
+
+	return result;
+}
+
+/**
+	Releases a cache, without saving it.
+
+	@param[in] 	cache 	the cache to free
+*/
+void freeCache(tCache *cache)
+{
+	tCacheEntry	*entry;
+	size_t		i;
+
+	for (i = 0; i < cache->slotCount; ++i)
+	{
+		while ((entry = cache->slots[i]) != NULL)
+		{
+			cache->slots[i] = entry->next;
+			free(entry);
+		}
+	}
+#ifdef qHaveThreads
+	pthread_mutex_destroy(&cache->lock);
+#endif
+	free(cache->slots);
+	free(cache->filename);
+	free(cache);
+}
+
+/**
+	Finds what the cache knows about a file.
+
+	@param[in] 	cache 	the cache to search
+	@param[in] 	path 	the path of the file
+	@param[out] stamp 	receives the file's size and modification time
+	@param[out] hash 	receives the hash of the file's contents
+
+	@return true if the file is in the cache
+*/
+bool lookupCache(tCache *cache, const char *path,
+				 tFileStamp *stamp, tHash *hash)
+{
+	tCacheEntry	*entry;
+
+#ifdef qHaveThreads
+	pthread_mutex_lock(&cache->lock);
+#endif
+	entry = *findEntry(cache, path, hashBlock(path, strlen(path)));
+	if (entry != NULL)
+	{
+		*stamp = entry->stamp;
+		*hash = entry->hash;
+	}
+#ifdef qHaveThreads
+	pthread_mutex_unlock(&cache->lock);
+#endif
+
+	return (bool)(entry != NULL);
+}
+
+/**
+	Records what a file looks like after processing it.
+
+	@param[in,out] 	cache 	the cache to update
+	@param[in] 		path 	the path of the file
+	@param[in] 		stamp 	the file's size and modification time
+	@param[in] 		hash 	the hash of the file's contents
+*/
+void updateCache(tCache *cache, const char *path,
+				 const tFileStamp *stamp, tHash hash)
+{
+#ifdef qHaveThreads
+	pthread_mutex_lock(&cache->lock);
+#endif
+	addEntry(cache, path, stamp, hash);
+	cache->changed = true;
+#ifdef qHaveThreads
+	pthread_mutex_unlock(&cache->lock);
+#endif
+}
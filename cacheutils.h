@@ -0,0 +1,33 @@
+/**
+	@file cacheutils.h
+
+	Public interface for cacheutils.c
+
+	@version 0.92
+	@author Paul Chambers
+	@date 2005-2006
+*/
+/* $Header$ */
+
+/** the start of the first line of a cache file, identifying its format */
+#define qCacheSignature	"insertdox-cache 2"
+
+/** a hash of a file's contents */
+typedef unsigned long long tHash;
+
+/** the hash of nothing at all (see continueHash()) */
+#define qHashStart	14695981039346656037ULL
+
+typedef struct tCache tCache;
+
+tHash hashBlock(const char *data, size_t length);
+tHash continueHash(tHash hash, const char *data, size_t length);
+
+tCache *loadCache(const char *filename, tHash options);
+int saveCache(tCache *cache);
+void freeCache(tCache *cache);
+
+bool lookupCache(tCache *cache, const char *path,
+				 tFileStamp *stamp, tHash *hash);
+void updateCache(tCache *cache, const char *path,
+				 const tFileStamp *stamp, tHash hash);
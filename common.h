@@ -1 +1 @@
-/**	@file common.h		Included by every source file. Contains a few	declarations that are used throughout insertdox.		@version 0.9	@author Paul Chambers	@date 2005-2006*/#define qVersion	"0.9"	/**< current version. putting it here means everything								 is rebuilt when it is changed. */typedef unsigned char byte;	/**< a handy contraction *//** useful for type safety and readability */typedef enum {	false = 0,	/**< not true */	true = 1	/**< is true */} bool;/**	Contains global settings that control the application's behavior.	These options may be modified by command line options.*/typedef struct {	char *filename;		 /**< the filename being processed (NULL if stdin) */	char *boilerplate;	 /**< filename of a file to insert in new file comments 							  (NULL if one isn't available) */	bool onlyPrototypes; /**< only emit the file and function comments,							  and function declaration. */} tAppOptions;extern tAppOptions gOptions;
\ No newline at end of file
+/**	@file common.h		Included by every source file. Contains a few	declarations that are used throughout insertdox.		@version 0.9	@author Paul Chambers	@date 2005-2006*/#define qVersion	"0.92"	/**< current version. putting it here means everything								 is rebuilt when it is changed. *//**	Microsoft builds don't have pthreads, so	they always process files one at a time.*/#ifndef WIN32#define qHaveThreads#endiftypedef unsigned char byte;	/**< a handy contraction *//** useful for type safety and readability */typedef enum {	false = 0,	/**< not true */	true = 1	/**< is true */} bool;/**	Contains global settings that control the application's behavior.	These options may be modified by command line options.*/typedef struct {	char *boilerplate;	 /**< filename of a file to insert in new file comments 							  (NULL if one isn't available) */	bool onlyPrototypes; /**< only emit the file and function comments,							  and function declaration. */	int	 threads;		 /**< how many files to process at once */	int	 prefetch;		 /**< how many files to read ahead of the threads							  processing them (0 for none) */	char *cache;		 /**< filename of the cache of files already processed							  (NULL if there isn't one) */	bool noBackup;		 /**< don't keep the original of each file as a							  '.bak' file */	char *stats;		 /**< where to write statistics ('-' for stdout,							  NULL if they aren't wanted) */	unsigned long maxMemory; /**< the most memory to use for each file,							  in bytes (0 if there's no limit) */	bool check;			 /**< only report the functions without a Doxygen							  comment, rather than writing anything */	char *server;		 /**< the socket to answer requests on ('-' for							  stdin, NULL if it isn't a server) */	char *symbols;		 /**< where to write a record of each function ('-'							  for stdout, NULL if they aren't wanted) */} tAppOptions;extern tAppOptions gOptions;
\ No newline at end of file
@@ -0,0 +1,917 @@
+/**
+	@file difftest.c
+	@brief A differential test of the parser's faster paths.
+
+	Runs the parser over the same input in every way that insertdox
+	does, and reports any output that differs from the output of the
+	reference: the parser fed a single character at a time, with the
+	fast path through the state machine turned off (see plainParser()),
+	so every character takes the plain path. The other ways are the
+	whole input at once, random pieces, blocks (as from a file), parts
+	split at boundaries (as with -j), every boundary, a --max-memory
+	limit and --lines. Each input is also tried with its line endings
+	changed to CR/LF and to CR alone, and with -p.
+
+	Since every way shares the parser, a change to what the parser
+	makes of an input doesn't show here; 'make golden' checks the
+	output for the files in golden/ against what version 0.9 made
+	of them, for that.
+
+	Run it with 'make difftest' (which runs 'make golden' first), over
+	synthetic inputs, or over the files named on the command line.
+	'make difftest' also writes the table of results to
+	difftest-results.txt (see -o), so it can be kept along with the
+	results of 'make bench'.
+
+	Built with qFuzzTarget defined, it's a libFuzzer target instead
+	(or an AFL++ one, with afl-clang-fast), which aborts on the first
+	difference. Run it with 'make fuzz'.
+
+	@version 0.92
+	@author Paul Chambers
+	@date 2005-2006
+*/
+/* $Header$ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "arenautils.h"
+#include "sinkutils.h"
+#include "stringutils.h"
+#include "bufferutils.h"
+#include "fileutils.h"
+#include "parser.h"
+#include "keywordutils.h"
+#include "typeutils.h"
+
+/** the parser expects these to exist */
+tAppOptions gOptions;
+
+/** the name given to the parser, for the file comment */
+#define qFilename		"difftest.c"
+
+/** the default number of synthetic inputs */
+#define qDefaultCount	200
+
+/** the limit used for --max-memory (its smallest, qMinMemory) */
+#define qMemoryLimit	(2 * qBufferSize)
+
+/** the most parts an input is split into, as with -j */
+#define qMaxParts		8
+
+/** convert line endings (see changeEndings()) */
+#define qEndingsAsIs	0	/**< leave them alone */
+#define qEndingsCrLf	1	/**< to CR/LF */
+#define qEndingsCr		2	/**< to CR alone */
+#define qEndingsKinds	3
+
+/** skipped, rather than compared (see runLimited()) */
+#define qIncomparable	1
+
+/** a boundary where the parser isn't at one (see runBoundaries()) */
+#define qMisplaced		2
+
+/**
+	one way of running the parser over an input. Returns what
+	finishParser() did, or qIncomparable if there's nothing to
+	compare.
+*/
+typedef int (*tRunner)(tSink *out, const char *data, size_t length);
+
+/**
+	a way of running the parser, and how it's fared.
+*/
+typedef struct
+{
+	const char	*name;			/**< shown in the report */
+	tRunner		run;			/**< runs it */
+	size_t		inputs;			/**< inputs compared */
+	size_t		skipped;		/**< inputs that couldn't be compared */
+	size_t		differences;	/**< inputs that came out differently */
+} tMode;
+
+static unsigned long sSeed = 1;
+
+static unsigned int nextRandom(unsigned int range);
+#ifndef qFuzzTarget
+static void genInput(tSink *sink);
+#endif
+static void changeEndings(tSink *sink, const char *data, size_t length,
+						  int endings);
+static int runReference(tSink *out, const char *data, size_t length);
+static int runWhole(tSink *out, const char *data, size_t length);
+static int runPieces(tSink *out, const char *data, size_t length);
+static int runBlocks(tSink *out, const char *data, size_t length);
+static int runShards(tSink *out, const char *data, size_t length);
+static int runBoundaries(tSink *out, const char *data, size_t length);
+static int runLimited(tSink *out, const char *data, size_t length);
+static int runLines(tSink *out, const char *data, size_t length);
+static int runParts(tSink *out, const char *data, size_t length,
+					const size_t *ends, const tBoundary *starts, int count);
+static size_t compareModes(const char *data, size_t length, const char *label);
+#ifndef qFuzzTarget
+static void writeResults(FILE *file, size_t inputs, const char *from);
+#endif
+
+/** the ways compared with runReference(), in the order they're reported */
+static tMode sModes[] = {
+	{ "whole",		runWhole,		0, 0, 0 },
+	{ "pieces",		runPieces,		0, 0, 0 },
+	{ "blocks",		runBlocks,		0, 0, 0 },
+	{ "shards",		runShards,		0, 0, 0 },
+	{ "boundaries",	runBoundaries,	0, 0, 0 },
+	{ "max-memory",	runLimited,		0, 0, 0 },
+	{ "lines",		runLines,		0, 0, 0 }
+};
+
+/** the names of the line endings, for the report */
+static const char *sEndingNames[qEndingsKinds] = { "as is", "CR/LF", "CR" };
+
+#ifndef qFuzzTarget
+
+/**
+	the pieces synthetic inputs are made of: ordinary code, and
+	the awkward corners of it (see genInput()).
+*/
+static const char *sFragments[] = {
+	"int main(int argc, char *argv[])\n{\n\treturn 0;\n}\n",
+	"static void f(void)\n{\n}\n",
+	"char *s(const char *p, size_t n)\n{\n\tif (n == 0)\n\t\treturn NULL;\n"
+		"\tswitch (n) { case 1: return (char *)p; }\n\treturn (-1);\n}\n",
+	"int k(a, b)\n\tint a;\n\tchar *b;\n{\n\treturn a;\n}\n",
+	"unsigned long **g(volatile int *a, struct tFoo b, int (*fn)(int))\n"
+		"{\n\t/* @todo check a */\n\treturn b.x ? 0 : 1;\n}\n",
+	"/* a comment */", "/** a Doxygen comment */\n", "/*\n\tnote: this one\n*/\n",
+	"// a line comment\n", "// continued \\\n on this line\n", "//",
+	"\"a string with \\\" and { braces }\"", "'\\''", "'{'", "'\\\\'", "'\"'",
+	"#include <stdio.h>\n", "#define M(a) { a }\n", "#if 0\n{\n#endif\n",
+	"#ifdef X\nint g(int a) {\n#else\nint g(int b) {\n#endif\n\treturn 0;\n}\n",
+	"#define LONG \\\n\t1\n", "#", "# pragma once\n",
+	"#define MAKE_TABLE(name, n) \\\n    unsigned int name(int n) \\\n"
+		"    { return n; }\n",
+	"#ifdef __cplusplus\nextern \"C\" {\n#endif\n",
+	"#ifdef __cplusplus\n}\n#endif\n",
+	"struct tFoo { int a; };\n", "typedef int (*tFn)(int);\n",
+	"enum { A = 1, B = 2 };\n", "int x[] = { 1, 2 };\n", "int y;\n",
+	"extern \"C\" {\n", "namespace n {\n",
+	"class C : public B {\npublic:\n\tC() : m(0) {}\n\t~C();\n"
+		"\tint &get(const int &a) const;\nprivate:\n\tint m;\n};\n",
+	"template <typename T> T max(T a, T b) { return a > b ? a : b; }\n",
+	"bool operator==(const C &a, const C &b) { return true; }\n",
+	"void C::set(std::map<int, int> &v) noexcept { m = v; }\n",
+	"{", "}", "(", ")", "[", "]", ";", ",", "<", ">", ":", "*", "/", "\\",
+	"\\\n", "\n", "\r", "\t", "  ", "\n\n",
+	"int f(void) { /* unterminated", "\"unterminated", "/* nested /* */"
+};
+
+#endif
+
+/**
+	@internal
+
+	A small, repeatable pseudo-random number generator, so
+	an input can be made again from its seed.
+
+	@param[in] 	range 	the result is less than this
+
+	@return unsigned int
+*/
+static unsigned int nextRandom(unsigned int range)
+{
+	sSeed = sSeed * 1103515245UL + 12345UL;
+	return (unsigned int)((sSeed >> 16) & 0x7FFF) % range;
+}
+
+#ifndef qFuzzTarget
+
+/**
+	@internal
+
+	A synthetic input: fragments of code strung together in
+	no particular order, some of them cut short, with the odd
+	stray character. Now and then there's a huge function as
+	well, too big for --max-memory.
+
+	@param[in,out] 	sink 	receives the input
+*/
+static void genInput(tSink *sink)
+{
+	const char	*fragment;
+	unsigned int	count, length;
+	unsigned int	i, j;
+
+	count = 1 + nextRandom(64);
+	for (i = 0; i < count; ++i)
+	{
+		fragment = sFragments[nextRandom(sizeof(sFragments) / sizeof(sFragments[0]))];
+		length = strlen(fragment);
+		if (length > 1 && nextRandom(8) == 0)
+			length = 1 + nextRandom(length - 1);
+		sinkWrite(sink, fragment, length);
+
+		if (nextRandom(4) == 0)
+			sinkChar(sink, "\n \t{}();,\"'\\/*#<>:&\r"[nextRandom(20)]);
+	}
+
+	if (nextRandom(32) == 0)
+	{
+		sinkPuts(sink, "static int huge(int a)\n{\n");
+		for (j = 0; j < 4096; ++j)
+			sinkPuts(sink, "\ta += (a << 1) ^ 0x5A5A; /* { */\n");
+		sinkPuts(sink, "\treturn a;\n}\n");
+	}
+}
+
+#endif
+
+/**
+	@internal
+
+	Copies an input, converting its line endings.
+
+	@param[out] 	sink 	 	receives the converted input
+	@param[in] 		data 	 	the input
+	@param[in] 		length 	 	the number of characters in data
+	@param[in] 		endings  	what to convert them to (e.g. qEndingsCrLf)
+*/
+static void changeEndings(tSink *sink, const char *data, size_t length,
+						  int endings)
+{
+	size_t	i;
+
+	for (i = 0; i < length; ++i)
+	{
+		if (data[i] != '\n' || endings == qEndingsAsIs)
+			sinkChar(sink, data[i]);
+		else
+		{
+			sinkChar(sink, '\r');
+			if (endings == qEndingsCrLf)
+				sinkChar(sink, '\n');
+		}
+	}
+}
+
+/**
+	@internal
+
+	The reference: feeds the parser a single character at a time,
+	with its fast path turned off, so that nothing it does depends
+	on the code being tested.
+
+	@param[out] 	out 	 	receives the output
+	@param[in] 		data 	 	the input
+	@param[in] 		length 	 	the number of characters in data
+
+	@return what finishParser() did
+	@retval -108	unable to allocate memory
+*/
+static int runReference(tSink *out, const char *data, size_t length)
+{
+	tParser	*parser;
+	size_t	i;
+	int		result;
+
+	parser = createParser();
+	if (parser == NULL)
+		return (-108);
+
+	plainParser(parser, true);
+	resetParser(parser, out, qFilename);
+	for (i = 0; i < length; ++i)
+		feedParser(parser, &data[i], 1);
+	result = finishParser(parser);
+	destroyParser(parser);
+
+	return result;
+}
+
+/**
+	@internal
+
+	Feeds the parser the whole input at once (see processMemory()).
+
+	@param[out] 	out 	 	receives the output
+	@param[in] 		data 	 	the input
+	@param[in] 		length 	 	the number of characters in data
+
+	@return what processMemory() did
+*/
+static int runWhole(tSink *out, const char *data, size_t length)
+{
+	return processMemory(out, data, length, qFilename);
+}
+
+/**
+	@internal
+
+	Feeds the parser pieces of random sizes, mostly small
+	but some of them a good deal bigger.
+
+	@param[out] 	out 	 	receives the output
+	@param[in] 		data 	 	the input
+	@param[in] 		length 	 	the number of characters in data
+
+	@return what finishParser() did
+	@retval -108	unable to allocate memory
+*/
+static int runPieces(tSink *out, const char *data, size_t length)
+{
+	tParser	*parser;
+	size_t	offset, count;
+	int		result;
+
+	parser = createParser();
+	if (parser == NULL)
+		return (-108);
+
+	resetParser(parser, out, qFilename);
+	for (offset = 0; offset < length; offset += count)
+	{
+		count = (nextRandom(4) == 0) ? 1 + nextRandom(4096) : 1 + nextRandom(16);
+		if (count > length - offset)
+			count = length - offset;
+		feedParser(parser, &data[offset], count);
+	}
+	result = finishParser(parser);
+	destroyParser(parser);
+
+	return result;
+}
+
+/**
+	@internal
+
+	Feeds the parser a block at a time, as processFile() does.
+
+	@param[out] 	out 	 	receives the output
+	@param[in] 		data 	 	the input
+	@param[in] 		length 	 	the number of characters in data
+
+	@return what finishParser() did
+	@retval -108	unable to allocate memory
+*/
+static int runBlocks(tSink *out, const char *data, size_t length)
+{
+	tParser	*parser;
+	size_t	offset, count;
+	int		result;
+
+	parser = createParser();
+	if (parser == NULL)
+		return (-108);
+
+	resetParser(parser, out, qFilename);
+	for (offset = 0; offset < length; offset += count)
+	{
+		count = length - offset;
+		if (count > qReadBlockSize)
+			count = qReadBlockSize;
+		feedParser(parser, &data[offset], count);
+	}
+	result = finishParser(parser);
+	destroyParser(parser);
+
+	return result;
+}
+
+/**
+	@internal
+
+	Parses each part of an input with a parser of its own, picking
+	up from the boundary it starts at, and strings the outputs
+	together, as parseShards() does.
+
+	@param[out] 	out 	 	receives the output
+	@param[in] 		data 	 	the input
+	@param[in] 		length 	 	the number of characters in data
+	@param[in] 		ends 	 	where each part ends
+	@param[in] 		starts 	 	the boundary each part starts at
+	@param[in] 		count 	 	the number of parts
+
+	@return the first result that wasn't 0 (or 0)
+	@retval -108	unable to allocate memory
+*/
+static int runParts(tSink *out, const char *data, size_t length,
+					const size_t *ends, const tBoundary *starts, int count)
+{
+	tParser	*parser;
+	tSink	part;
+	int		i, result, partResult;
+
+	(void)length;
+
+	parser = createParser();
+	if (parser == NULL || initSink(&part, NULL) != 0)
+	{
+		if (parser != NULL)
+			destroyParser(parser);
+		return (-108);
+	}
+
+	result = 0;
+	for (i = 0; i < count; ++i)
+	{
+		resetSink(&part, NULL);
+		resumeParser(parser, &part, qFilename, &starts[i]);
+		feedParser(parser, &data[starts[i].offset], ends[i] - starts[i].offset);
+		partResult = finishParser(parser);
+		if (result == 0)
+			result = partResult;
+		sinkWrite(out, part.data, part.length);
+	}
+	if (result == 0 && (part.failed || out->failed))
+		result = -108;
+
+	freeSink(&part);
+	destroyParser(parser);
+
+	return result;
+}
+
+/**
+	@internal
+
+	Splits the input between 2 to qMaxParts parsers, as evenly as
+	the boundaries allow, as -j does for a big file (see
+	parseShards()).
+
+	@param[out] 	out 	 	receives the output
+	@param[in] 		data 	 	the input
+	@param[in] 		length 	 	the number of characters in data
+
+	@return what runParts() did
+*/
+static int runShards(tSink *out, const char *data, size_t length)
+{
+	tBoundary	starts[qMaxParts];
+	size_t	ends[qMaxParts];
+	tBoundary	at;
+	bool	more;
+	int		count, target;
+
+	target = 2 + nextRandom(qMaxParts - 1);
+
+	firstBoundary(&at);
+	more = true;
+	count = 0;
+	do {
+		starts[count] = at;
+		while (more && at.offset < length / target * (count + 1))
+			more = nextBoundary(data, length, &at);
+
+		++count;
+		ends[count - 1] = (more && count < target) ? at.offset : length;
+	} while (ends[count - 1] < length);
+
+	return runParts(out, data, length, ends, starts, count);
+}
+
+/**
+	@internal
+
+	Splits the input at every boundary, with a parser for each
+	part, to check that nextBoundary() and the parser agree on
+	every one of them. The state at each boundary is also checked
+	against the state of the reference parser at the same place
+	(see atBoundary()), as a difference there needn't show in
+	the output.
+
+	@param[out] 	out 	 	receives the output
+	@param[in] 		data 	 	the input
+	@param[in] 		length 	 	the number of characters in data
+
+	@return what runParts() did
+	@retval qMisplaced	the parser isn't at one of the boundaries
+	@retval -108		unable to allocate memory
+*/
+static int runBoundaries(tSink *out, const char *data, size_t length)
+{
+	tBoundary	*starts;
+	size_t	*ends;
+	tBoundary	at;
+	tParser	*parser;
+	tSink	scratch;
+	size_t	size, fed;
+	int		count, result;
+
+	size = 16;
+	starts = (tBoundary *)malloc(size * sizeof(tBoundary));
+	ends = (size_t *)malloc(size * sizeof(size_t));
+
+	parser = createParser();
+	if (parser == NULL || initSink(&scratch, NULL) != 0)
+	{
+		if (parser != NULL)
+			destroyParser(parser);
+		free(starts);
+		free(ends);
+		return (-108);
+	}
+	plainParser(parser, true);
+	resetParser(parser, &scratch, qFilename);
+	fed = 0;
+	result = 0;
+
+	firstBoundary(&at);
+	count = 0;
+	while (starts != NULL && ends != NULL)
+	{
+		if ((size_t)count == size)
+		{
+			size *= 2;
+			starts = (tBoundary *)realloc(starts, size * sizeof(tBoundary));
+			ends = (size_t *)realloc(ends, size * sizeof(size_t));
+			if (starts == NULL || ends == NULL)
+				break;
+		}
+
+		starts[count] = at;
+		if (!nextBoundary(data, length, &at))
+		{
+			ends[count++] = length;
+			break;
+		}
+		ends[count++] = at.offset;
+
+		/* as far as the character after it, which is left pending */
+		if (at.offset < length)
+		{
+			feedParser(parser, &data[fed], at.offset + 1 - fed);
+			fed = at.offset + 1;
+			if (!atBoundary(parser, &at) && result == 0)
+			{
+				fprintf(stderr, "### difference: nextBoundary() stopped at "
+						"offset %lu, where the parser isn't at a boundary\n",
+						(unsigned long)at.offset);
+				result = qMisplaced;
+			}
+		}
+	}
+
+	if (starts == NULL || ends == NULL)
+		result = -108;
+	else if (result == 0)
+		result = runParts(out, data, length, ends, starts, count);
+	free(starts);
+	free(ends);
+	freeSink(&scratch);
+	destroyParser(parser);
+
+	return result;
+}
+
+/**
+	@internal
+
+	Feeds the parser a block at a time with the smallest
+	--max-memory limit, passing on the output after each block,
+	as writeStream() does. If a function is too big for the
+	limit, it's passed through unchanged, so the output is
+	expected to differ, and isn't compared.
+
+	@param[out] 	out 	 	receives the output
+	@param[in] 		data 	 	the input
+	@param[in] 		length 	 	the number of characters in data
+
+	@return what finishParser() did
+	@retval qIncomparable	part of the input was too big for the limit
+	@retval -108			unable to allocate memory
+*/
+static int runLimited(tSink *out, const char *data, size_t length)
+{
+	tParserCounts	counts;
+	tParser	*parser;
+	tSink	sink;
+	size_t	offset, count;
+	int		result;
+
+	gOptions.maxMemory = qMemoryLimit;
+	parser = createParser();
+	gOptions.maxMemory = 0;
+	if (parser == NULL || initSink(&sink, NULL) != 0)
+	{
+		if (parser != NULL)
+			destroyParser(parser);
+		return (-108);
+	}
+
+	resetParser(parser, &sink, qFilename);
+	for (offset = 0; offset < length; offset += count)
+	{
+		count = length - offset;
+		if (count > qReadBlockSize)
+			count = qReadBlockSize;
+		feedParser(parser, &data[offset], count);
+
+		sinkWrite(out, sink.data, sink.length);
+		sink.length = 0;
+	}
+	result = finishParser(parser);
+	sinkWrite(out, sink.data, sink.length);
+
+	countParser(parser, &counts);
+	if (counts.overflows > 0)
+		result = qIncomparable;
+
+	freeSink(&sink);
+	destroyParser(parser);
+
+	return result;
+}
+
+/**
+	@internal
+
+	Reprocesses every line of the input, as --lines does.
+
+	@param[out] 	out 	 	receives the output
+	@param[in] 		data 	 	the input
+	@param[in] 		length 	 	the number of characters in data
+
+	@return what processChanges() did
+	@retval -108	unable to allocate memory
+*/
+static int runLines(tSink *out, const char *data, size_t length)
+{
+	tLineRange	all;
+	tParser	*parser;
+	int		result;
+
+	parser = createParser();
+	if (parser == NULL)
+		return (-108);
+
+	all.first = 1;
+	all.last = LONG_MAX;
+	result = processChanges(parser, out, data, length, qFilename, &all, 1);
+	destroyParser(parser);
+
+	return result;
+}
+
+/**
+	@internal
+
+	Runs every mode over an input, with each kind of line
+	ending and with and without -p, and compares the output
+	of each with the output of runReference().
+
+	@param[in] 	data 	 	the input
+	@param[in] 	length 	 	the number of characters in data
+	@param[in] 	label 	 	identifies the input, in the report
+
+	@return the number of differences found
+*/
+static size_t compareModes(const char *data, size_t length, const char *label)
+{
+	tSink	input, expected, actual;
+	size_t	differences = 0;
+	size_t	i, at;
+	int		endings, prototypes;
+	int		result, wanted;
+
+	if (initSink(&input, NULL) != 0
+	 || initSink(&expected, NULL) != 0
+	 || initSink(&actual, NULL) != 0)
+	{
+		fprintf(stderr, "### error: unable to allocate memory\n");
+		return 1;
+	}
+
+	for (endings = 0; endings < qEndingsKinds; ++endings)
+	{
+		resetSink(&input, NULL);
+		changeEndings(&input, data, length, endings);
+
+		for (prototypes = 0; prototypes < 2; ++prototypes)
+		{
+			gOptions.onlyPrototypes = (bool)prototypes;
+
+			resetSink(&expected, NULL);
+			wanted = runReference(&expected, input.data, input.length);
+
+			for (i = 0; i < sizeof(sModes) / sizeof(sModes[0]); ++i)
+			{
+				resetSink(&actual, NULL);
+				result = sModes[i].run(&actual, input.data, input.length);
+				if (result == qIncomparable)
+				{
+					++sModes[i].skipped;
+					continue;
+				}
+
+				++sModes[i].inputs;
+				if (result == wanted && actual.length == expected.length
+				 && memcmp(actual.data, expected.data, actual.length) == 0)
+				{
+					continue;
+				}
+
+				for (at = 0; at < actual.length && at < expected.length
+							 && actual.data[at] == expected.data[at]; ++at)
+					;
+				fprintf(stderr,
+						"### difference: %s (%s%s), %s: result %d rather "
+						"than %d, output differs from offset %lu\n",
+						label, sEndingNames[endings],
+						prototypes ? ", -p" : "", sModes[i].name,
+						result, wanted, (unsigned long)at);
+				++sModes[i].differences;
+				++differences;
+			}
+		}
+	}
+	gOptions.onlyPrototypes = false;
+
+	freeSink(&actual);
+	freeSink(&expected);
+	freeSink(&input);
+
+	return differences;
+}
+
+#ifdef qFuzzTarget
+
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size);
+
+/**
+	The fuzzer's entry point, called with each input it tries.
+
+	The pieces are sized from the input itself, so a failure
+	can be reproduced from the input alone.
+
+	@param[in] 	data 	the input
+	@param[in] 	size 	the number of characters in data
+
+	@return always 0 (it aborts on a difference instead)
+*/
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size)
+{
+	static bool	initialized = false;
+	size_t	i;
+
+	if (!initialized)
+	{
+		if (initKeywords() != 0)
+			abort();
+		initialized = true;
+	}
+
+	sSeed = 1;
+	for (i = 0; i < size; ++i)
+		sSeed = sSeed * 31 + data[i];
+
+	if (compareModes((const char *)data, size, "the input") != 0)
+		abort();
+
+	return 0;
+}
+
+#else
+
+/**
+	@internal
+
+	Writes the table of results.
+
+	@param[in] 	file 	where to write it
+	@param[in] 	inputs 	the number of inputs tested
+	@param[in] 	from 	where the inputs came from
+*/
+static void writeResults(FILE *file, size_t inputs, const char *from)
+{
+	size_t	i;
+
+	fprintf(file, "insertdox %s differential test, %lu inputs (%s)\n",
+			qVersion, (unsigned long)inputs, from);
+	fprintf(file, "%-12s %8s %8s %12s\n",
+			"mode", "compared", "skipped", "differences");
+	for (i = 0; i < sizeof(sModes) / sizeof(sModes[0]); ++i)
+	{
+		fprintf(file, "%-12s %8lu %8lu %12lu\n", sModes[i].name,
+				(unsigned long)sModes[i].inputs,
+				(unsigned long)sModes[i].skipped,
+				(unsigned long)sModes[i].differences);
+	}
+}
+
+/**
+	The differential test's entry point.
+
+	@param[in] 	argc 	count of arguments on command line
+	@param[in] 	argv 	'-n <count>' sets the number of synthetic inputs,
+						'-s <seed>' the first one's seed (input i is made
+						from seed + i), '-o <filename>' where to write
+						the table of results as well as stdout, and any
+						files named are tested instead of synthetic inputs
+
+	@return int
+	@retval 0	everything went smoothly
+	@retval 1	an output differed, or an input couldn't be read
+*/
+int main(int argc, char *argv[])
+{
+	tSink	input;
+	tSource	src;
+	FILE	*inFile, *resultFile;
+	char	label[64], from[64];
+	char	*resultName = NULL;
+	unsigned long	seed = 1;
+	size_t	differences = 0;
+	size_t	i, inputs;
+	int		count = qDefaultCount;
+	int		result = 0;
+	int		arg;
+
+	for (arg = 1; arg + 1 < argc; arg += 2)
+	{
+		if (strcmp(argv[arg], "-n") == 0)
+			count = atoi(argv[arg + 1]);
+		else if (strcmp(argv[arg], "-s") == 0)
+			seed = strtoul(argv[arg + 1], NULL, 10);
+		else if (strcmp(argv[arg], "-o") == 0)
+			resultName = argv[arg + 1];
+		else
+			break;
+	}
+	if (count < 1) count = 1;
+
+	if (initKeywords() != 0 || initSink(&input, NULL) != 0)
+	{
+		fprintf(stderr, "### error: unable to allocate memory\n");
+		return 1;
+	}
+	initSource(&src);
+
+	if (arg < argc)
+		sprintf(from, "%d files", argc - arg);
+	else
+		sprintf(from, "seeds %lu to %lu", seed, seed + count - 1);
+
+	if (arg < argc)
+	{
+		inputs = argc - arg;
+		for (; arg < argc; ++arg)
+		{
+			inFile = fopen(argv[arg], "rb");
+			if (inFile == NULL || readSource(&src, inFile) != 0)
+			{
+				fprintf(stderr, "### error: unable to read '%s'\n", argv[arg]);
+				result = 1;
+			}
+			else
+			{
+				sSeed = seed;
+				differences += compareModes(src.data, src.length, argv[arg]);
+			}
+			if (inFile != NULL)
+				fclose(inFile);
+		}
+	}
+	else
+	{
+		inputs = count;
+		for (i = 0; i < (size_t)count; ++i)
+		{
+			sSeed = seed + i;
+			resetSink(&input, NULL);
+			genInput(&input);
+			sprintf(label, "seed %lu", seed + i);
+			differences += compareModes(input.data, input.length, label);
+		}
+	}
+
+	writeResults(stdout, inputs, from);
+	if (resultName != NULL)
+	{
+		resultFile = fopen(resultName, "w");
+		if (resultFile != NULL)
+		{
+			writeResults(resultFile, inputs, from);
+			if (fclose(resultFile) != 0)
+				resultFile = NULL;
+		}
+		if (resultFile == NULL)
+		{
+			fprintf(stderr, "### error: unable to write '%s'\n", resultName);
+			result = 1;
+		}
+	}
+
+	freeSource(&src);
+	freeSink(&input);
+	freeKeywords();
+	forgetTypes();
+
+	return (result != 0 || differences > 0) ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,587 @@
+/**
+	@file diffutils.c
+
+	Describes the changes between two versions of a file as a
+	unified diff, like 'diff -u' would, so they can be reviewed
+	or applied with 'patch'.
+
+	The lines are compared using Myers' O(ND) algorithm, in its
+	linear space form: the 'middle snake' of the two files is
+	found by searching forwards from the start and backwards
+	from the end at the same time, and the parts either side of
+	it are compared in the same way. What insertdox changes is
+	mostly a few comments inserted here and there, so D (the
+	number of lines inserted or removed) is usually small.
+
+	Before that, as 'diff' does, lines that don't appear anywhere
+	in the other file are set aside as changed, which makes D much
+	smaller still - most of the lines of a new comment are unique.
+
+	@version 0.92
+	@author Paul Chambers
+	@date 2005-2006
+*/
+/* $Header$ */
+
+#include "common.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sinkutils.h"
+#include "diffutils.h"
+
+/**
+	one line of a file, including its newline (if it has one).
+*/
+typedef struct {
+	const char	*start;		/**< the first character of the line */
+	size_t		length;		/**< the number of characters in it */
+	unsigned long	hash;	/**< a hash of the characters, to speed up comparisons */
+} tLine;
+
+/**
+	a path through the comparison, as found by findMidpoint():
+	one line inserted or removed, then any number that are the same.
+*/
+typedef struct {
+	long	x1, y1;		/**< where it starts, in the old and new files */
+	long	x2, y2;		/**< where it ends */
+} tSnake;
+
+/**
+	everything needed while comparing two files.
+*/
+typedef struct {
+	tLine	*oldLines;		/**< the lines of the old file */
+	tLine	*newLines;		/**< the lines of the new file */
+	long	oldCount;		/**< the number of lines in the old file */
+	long	newCount;		/**< the number of lines in the new file */
+	byte	*removed;		/**< flags each line of the old file that was removed */
+	byte	*inserted;		/**< flags each line of the new file that was inserted */
+
+	/* the lines that are compared, skipping the ones set aside */
+	long	*oldMap;		/**< the line of the old file for each one compared */
+	long	*newMap;		/**< the line of the new file for each one compared */
+	long	oldKept;		/**< the number of lines of the old file compared */
+	long	newKept;		/**< the number of lines of the new file compared */
+	long	*forward;		/**< furthest x reached on each diagonal, going forwards */
+	long	*backward;		/**< furthest y reached on each diagonal, going backwards */
+} tDiff;
+
+static tLine *splitLines(const char *data, size_t length, long *count);
+static long *keepShared(const tLine *lines, long count,
+						const tLine *other, long otherCount,
+						byte *changed, long *kept);
+static bool sameLine(const tDiff *diff, long x, long y);
+static bool findMidpoint(tDiff *diff, long left, long top,
+						 long right, long bottom, tSnake *snake);
+static void compareLines(tDiff *diff, long left, long top,
+						 long right, long bottom);
+static void writeRange(tSink *out, char prefix, long start, long count);
+static void writeLine(tSink *out, char prefix, const tLine *line);
+static void writeHunk(tSink *out, const tDiff *diff,
+					  long x, long y, long xEnd, long yEnd);
+
+/*
+	private functions
+*/
+
+/**
+	@internal
+
+	Finds the lines in a file.
+
+	@param[in] 	data 	the contents of the file
+	@param[in] 	length 	the number of characters in it
+	@param[out] count 	receives the number of lines
+
+	@return the lines
+	@retval NULL	unable to allocate memory
+*/
+static tLine *splitLines(const char *data, size_t length, long *count)
+{
+	tLine		*lines;
+	const char	*p = data;
+	const char	*end = data + length;
+	const char	*eol;
+	long		n = 0;
+
+	for (eol = p; eol < end; ++eol)
+	{
+		if (*eol == '\n')
+			++n;
+	}
+	if (length > 0 && end[-1] != '\n')
+		++n;
+
+	lines = (tLine *)malloc((n + 1) * sizeof(tLine));
+	if (lines == NULL)
+		return NULL;
+
+	n = 0;
+	while (p < end)
+	{
+		eol = (const char *)memchr(p, '\n', end - p);
+		eol = (eol != NULL) ? eol + 1 : end;
+
+		lines[n].start = p;
+		lines[n].length = eol - p;
+		lines[n].hash = 5381;
+		while (p < eol)
+			lines[n].hash = lines[n].hash * 33 + (byte)*p++;
+		++n;
+	}
+	*count = n;
+
+	return lines;
+}
+
+/**
+	@internal
+
+	Sets aside the lines of one file that can't be in the other,
+	since they're not the same as any line of it (or at least,
+	don't hash the same), and lists the rest.
+
+	@param[in] 	lines 		the lines of the file
+	@param[in] 	count 		the number of lines
+	@param[in] 	other 		the lines of the other file
+	@param[in] 	otherCount 	the number of lines in the other file
+	@param[out] changed 	flags each line set aside
+	@param[out] kept 		receives the number of lines listed
+
+	@return the number of each line that wasn't set aside
+	@retval NULL	unable to allocate memory
+*/
+static long *keepShared(const tLine *lines, long count,
+						const tLine *other, long otherCount,
+						byte *changed, long *kept)
+{
+	unsigned long	*table;
+	unsigned long	hash;
+	size_t	size, slot;
+	long	*map;
+	long	i, n;
+
+	/* an open hash table of the other file's hashes (0 is empty) */
+	for (size = 64; size < 2 * (size_t)otherCount; size *= 2)
+		;
+	table = (unsigned long *)calloc(size, sizeof(unsigned long));
+	map = (long *)malloc((count + 1) * sizeof(long));
+	if (table == NULL || map == NULL)
+	{
+		free(table);
+		free(map);
+		return NULL;
+	}
+
+	for (i = 0; i < otherCount; ++i)
+	{
+		hash = other[i].hash | 1;
+		for (slot = hash & (size - 1); table[slot] != 0 && table[slot] != hash;
+			 slot = (slot + 1) & (size - 1))
+			;
+		table[slot] = hash;
+	}
+
+	n = 0;
+	for (i = 0; i < count; ++i)
+	{
+		hash = lines[i].hash | 1;
+		for (slot = hash & (size - 1); table[slot] != 0 && table[slot] != hash;
+			 slot = (slot + 1) & (size - 1))
+			;
+		if (table[slot] == 0)
+			changed[i] = true;
+		else
+			map[n++] = i;
+	}
+	*kept = n;
+
+	free(table);
+	return map;
+}
+
+/**
+	@internal
+
+	Compares a line of the old file with a line of the new one.
+
+	@param[in] 	diff 	the comparison
+	@param[in] 	x 		the line of the old file, among those compared
+	@param[in] 	y 		the line of the new file, among those compared
+
+	@return true if they're the same
+*/
+static bool sameLine(const tDiff *diff, long x, long y)
+{
+	const tLine	*a = &diff->oldLines[diff->oldMap[x]];
+	const tLine	*b = &diff->newLines[diff->newMap[y]];
+
+	return (bool)(a->hash == b->hash && a->length == b->length
+				  && memcmp(a->start, b->start, a->length) == 0);
+}
+
+/**
+	@internal
+
+	Finds the middle snake: the part of a shortest path
+	through the comparison of two ranges of lines that's
+	halfway along it.
+
+	@param[in,out] 	diff 	the comparison
+	@param[in] 		left 	the start of the range in the old file
+	@param[in] 		top 	the start of the range in the new file
+	@param[in] 		right 	the end of the range in the old file
+	@param[in] 		bottom 	the end of the range in the new file
+	@param[out] 	snake 	receives the middle snake
+
+	@return true if there is one (false if both ranges are empty)
+*/
+static bool findMidpoint(tDiff *diff, long left, long top,
+						 long right, long bottom, tSnake *snake)
+{
+	long	width = right - left;
+	long	height = bottom - top;
+	long	delta = width - height;
+	long	most = (width + height + 1) / 2;
+	long	*forward = diff->forward;
+	long	*backward = diff->backward;
+	long	depth, k, c, x, y, px, py;
+
+	forward[1] = left;
+	backward[1] = bottom;
+
+	for (depth = 0; depth <= most; ++depth)
+	{
+		/* extend each forward path by one more change */
+		for (k = depth; k >= -depth; k -= 2)
+		{
+			c = k - delta;
+			if (k == -depth || (k != depth && forward[k - 1] < forward[k + 1]))
+			{
+				px = x = forward[k + 1];
+			}
+			else
+			{
+				px = forward[k - 1];
+				x = px + 1;
+			}
+			y = top + (x - left) - k;
+			py = (depth == 0 || x != px) ? y : y - 1;
+
+			while (x < right && y < bottom && sameLine(diff, x, y))
+			{
+				++x;
+				++y;
+			}
+			forward[k] = x;
+
+			if ((delta & 1) != 0 && c >= -(depth - 1) && c <= depth - 1
+			 && y >= backward[c])
+			{
+				snake->x1 = px;
+				snake->y1 = py;
+				snake->x2 = x;
+				snake->y2 = y;
+				return true;
+			}
+		}
+
+		/* and each backward path */
+		for (c = depth; c >= -depth; c -= 2)
+		{
+			k = c + delta;
+			if (c == -depth || (c != depth && backward[c - 1] > backward[c + 1]))
+			{
+				py = y = backward[c + 1];
+			}
+			else
+			{
+				py = backward[c - 1];
+				y = py - 1;
+			}
+			x = left + (y - top) + k;
+			px = (depth == 0 || y != py) ? x : x + 1;
+
+			while (x > left && y > top && sameLine(diff, x - 1, y - 1))
+			{
+				--x;
+				--y;
+			}
+			backward[c] = y;
+
+			if ((delta & 1) == 0 && k >= -depth && k <= depth
+			 && x <= forward[k])
+			{
+				snake->x1 = x;
+				snake->y1 = y;
+				snake->x2 = px;
+				snake->y2 = py;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+/**
+	@internal
+
+	Compares two ranges of the lines being compared, flagging the
+	lines that were removed from the old file and inserted in the new.
+
+	@param[in,out] 	diff 	the comparison
+	@param[in] 		left 	the start of the range in the old file
+	@param[in] 		top 	the start of the range in the new file
+	@param[in] 		right 	the end of the range in the old file
+	@param[in] 		bottom 	the end of the range in the new file
+*/
+static void compareLines(tDiff *diff, long left, long top,
+						 long right, long bottom)
+{
+	tSnake	snake;
+
+	/* the same at the start and the end needs no searching */
+	while (left < right && top < bottom && sameLine(diff, left, top))
+	{
+		++left;
+		++top;
+	}
+	while (right > left && bottom > top && sameLine(diff, right - 1, bottom - 1))
+	{
+		--right;
+		--bottom;
+	}
+
+	if (left == right)
+	{
+		while (top < bottom)
+			diff->inserted[diff->newMap[top++]] = true;
+	}
+	else if (top == bottom)
+	{
+		while (left < right)
+			diff->removed[diff->oldMap[left++]] = true;
+	}
+	else if (findMidpoint(diff, left, top, right, bottom, &snake))
+	{
+		compareLines(diff, left, top, snake.x1, snake.y1);
+		compareLines(diff, snake.x1, snake.y1, snake.x2, snake.y2);
+		compareLines(diff, snake.x2, snake.y2, right, bottom);
+	}
+}
+
+/**
+	@internal
+
+	Writes one side of a hunk's header, e.g. '-12,7'.
+
+	@param[in,out] 	out 	where to write it
+	@param[in] 		prefix 	'-' for the old file, '+' for the new one
+	@param[in] 		start 	the first line of the hunk, counting from 0
+	@param[in] 		count 	the number of lines in the hunk
+*/
+static void writeRange(tSink *out, char prefix, long start, long count)
+{
+	char	range[48];
+
+	/* an empty range is given as the line before it */
+	if (count == 1)
+		sprintf(range, "%c%ld", prefix, start + 1);
+	else
+		sprintf(range, "%c%ld,%ld", prefix, (count > 0) ? start + 1 : start, count);
+	sinkPuts(out, range);
+}
+
+/**
+	@internal
+
+	Writes one line of a hunk.
+
+	@param[in,out] 	out 	where to write it
+	@param[in] 		prefix 	' ', '-' or '+'
+	@param[in] 		line 	the line
+*/
+static void writeLine(tSink *out, char prefix, const tLine *line)
+{
+	sinkChar(out, prefix);
+	sinkWrite(out, line->start, line->length);
+	if (line->length == 0 || line->start[line->length - 1] != '\n')
+		sinkPuts(out, "\n\\ No newline at end of file\n");
+}
+
+/**
+	@internal
+
+	Writes a hunk: a run of changes, and the lines around them.
+
+	@param[in,out] 	out 	where to write it
+	@param[in] 		diff 	the comparison
+	@param[in] 		x 		the first line of the hunk in the old file
+	@param[in] 		y 		the first line of the hunk in the new file
+	@param[in] 		xEnd 	just past the last line in the old file
+	@param[in] 		yEnd 	just past the last line in the new file
+*/
+static void writeHunk(tSink *out, const tDiff *diff,
+					  long x, long y, long xEnd, long yEnd)
+{
+	sinkPuts(out, "@@ ");
+	writeRange(out, '-', x, xEnd - x);
+	sinkChar(out, ' ');
+	writeRange(out, '+', y, yEnd - y);
+	sinkPuts(out, " @@\n");
+
+	while (x < xEnd || y < yEnd)
+	{
+		if (x < xEnd && diff->removed[x])
+			writeLine(out, '-', &diff->oldLines[x++]);
+		else if (y < yEnd && diff->inserted[y])
+			writeLine(out, '+', &diff->newLines[y++]);
+		else
+		{
+			writeLine(out, ' ', &diff->oldLines[x++]);
+			++y;
+		}
+	}
+}
+
+/*
+	public functions
+*/
+
+/**
+	Writes a unified diff of two versions of a file. Nothing
+	is written if they're the same.
+
+	@param[in,out] 	out 		where to write the diff
+	@param[in] 		name 		the name of the file, for the diff's header
+	@param[in] 		oldData 	the original contents of the file
+	@param[in] 		oldLength 	the number of characters in oldData
+	@param[in] 		newData 	the new contents of the file
+	@param[in] 		newLength 	the number of characters in newData
+
+	@return int
+	@retval 0		all is well
+	@retval -108	unable to allocate memory
+*/
+int writeDiff(tSink *out, const char *name,
+			  const char *oldData, size_t oldLength,
+			  const char *newData, size_t newLength)
+{
+	tDiff	diff;
+	long	x, y, hunkX, hunkY, lastX, run, before;
+	long	most;
+	int		result = 0;
+
+	if (oldLength == newLength && memcmp(oldData, newData, oldLength) == 0)
+		return 0;
+
+	diff.oldMap = diff.newMap = NULL;
+	diff.forward = diff.backward = NULL;
+	diff.oldLines = splitLines(oldData, oldLength, &diff.oldCount);
+	diff.newLines = splitLines(newData, newLength, &diff.newCount);
+	diff.removed = (byte *)calloc(diff.oldCount + 1, sizeof(byte));
+	diff.inserted = (byte *)calloc(diff.newCount + 1, sizeof(byte));
+	if (diff.oldLines != NULL && diff.newLines != NULL
+	 && diff.removed != NULL && diff.inserted != NULL)
+	{
+		diff.oldMap = keepShared(diff.oldLines, diff.oldCount,
+								 diff.newLines, diff.newCount,
+								 diff.removed, &diff.oldKept);
+		diff.newMap = keepShared(diff.newLines, diff.newCount,
+								 diff.oldLines, diff.oldCount,
+								 diff.inserted, &diff.newKept);
+
+		most = (diff.oldKept + diff.newKept + 1) / 2;
+		diff.forward = (long *)malloc((2 * most + 3) * sizeof(long));
+		diff.backward = (long *)malloc((2 * most + 3) * sizeof(long));
+	}
+
+	if (diff.oldMap == NULL || diff.newMap == NULL
+	 || diff.forward == NULL || diff.backward == NULL)
+	{
+		result = -108;
+	}
+	else
+	{
+		/* so the diagonals can be indexed from -(most + 1) to most + 1 */
+		diff.forward += most + 1;
+		diff.backward += most + 1;
+		compareLines(&diff, 0, 0, diff.oldKept, diff.newKept);
+		diff.forward -= most + 1;
+		diff.backward -= most + 1;
+
+		sinkPuts(out, "--- ");
+		sinkPuts(out, name);
+		sinkPuts(out, "\n+++ ");
+		sinkPuts(out, name);
+		sinkChar(out, '\n');
+
+		x = y = lastX = 0;
+		for (;;)
+		{
+			/* find the next change */
+			while (x < diff.oldCount && y < diff.newCount
+				&& !diff.removed[x] && !diff.inserted[y])
+			{
+				++x;
+				++y;
+			}
+			if (x >= diff.oldCount && y >= diff.newCount)
+				break;
+
+			/* the hunk starts with the unchanged lines before it */
+			before = x - lastX;
+			if (before > qDiffContext)
+				before = qDiffContext;
+			hunkX = x - before;
+			hunkY = y - before;
+
+			/* and takes in any changes that are close enough after it */
+			for (;;)
+			{
+				while (x < diff.oldCount && diff.removed[x])
+					++x;
+				while (y < diff.newCount && diff.inserted[y])
+					++y;
+
+				run = 0;
+				while (x + run < diff.oldCount && y + run < diff.newCount
+					&& !diff.removed[x + run] && !diff.inserted[y + run])
+				{
+					++run;
+				}
+
+				if ((x + run == diff.oldCount && y + run == diff.newCount)
+				 || run > 2 * qDiffContext)
+				{
+					if (run > qDiffContext)
+						run = qDiffContext;
+					x += run;
+					y += run;
+					break;
+				}
+				x += run;
+				y += run;
+			}
+
+			writeHunk(out, &diff, hunkX, hunkY, x, y);
+			lastX = x;
+		}
+	}
+
+	free(diff.oldLines);
+	free(diff.newLines);
+	free(diff.removed);
+	free(diff.inserted);
+	free(diff.oldMap);
+	free(diff.newMap);
+	free(diff.forward);
+	free(diff.backward);
+
+	return result;
+}
@@ -0,0 +1,17 @@
+/**
+	@file diffutils.h
+
+	Public interface for diffutils.c
+
+	@version 0.92
+	@author Paul Chambers
+	@date 2005-2006
+*/
+/* $Header$ */
+
+/** the number of unchanged lines shown around each change */
+#define qDiffContext	3
+
+int writeDiff(tSink *out, const char *name,
+			  const char *oldData, size_t oldLength,
+			  const char *newData, size_t newLength);
@@ -0,0 +1,566 @@
+/**
+	@file fileutils.c
+
+	Functions that move whole files in and out of memory.
+
+	Reading a file a character at a time through stdio is expensive,
+	so the parser works on an in-memory copy of each input instead.
+	The copy is read in large blocks, which works equally well for
+	regular files and for pipes (i.e. stdin).
+
+	Also finds the files to process, and puts the results in place.
+
+	@version 0.92
+	@author Paul Chambers
+	@date 2005-2006
+*/
+/* $Header$ */
+
+#define _POSIX_C_SOURCE 200809L
+#ifdef __linux__
+#define _GNU_SOURCE		/* for renameat2() and d_type */
+#endif
+
+#include "common.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#ifdef __linux__
+#include <fcntl.h>
+#endif
+#ifndef WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "fileutils.h"
+
+#ifndef WIN32
+/**
+	one entry read from a directory.
+*/
+typedef struct {
+	char	*name;		/**< the entry's name */
+	int		kind;		/**< qWalkFile, qWalkDirectory, 0 for anything
+							 else, or -1 if it needs a closer look */
+} tEntry;
+
+static int compareEntries(const void *a, const void *b);
+static tEntry *readEntries(const char *path, size_t *count);
+static int walkDirectory(char **path, size_t *size, size_t length,
+						 tWalkHandler handler, void *context);
+#endif
+
+/*
+	private functions
+*/
+
+#ifndef WIN32
+/**
+	@internal
+
+	qsort() comparison function, to sort entries alphabetically.
+
+	@param[in] 	a 	points to one tEntry
+	@param[in] 	b 	points to the other tEntry
+
+	@return int
+*/
+static int compareEntries(const void *a, const void *b)
+{
+	return strcmp(((const tEntry *)a)->name, ((const tEntry *)b)->name);
+}
+
+/**
+	@internal
+
+	Reads the entries of a directory, other than '.' and '..',
+	sorted so the order doesn't depend on the file system.
+
+	Where the file system says what kind of thing each entry is,
+	that's noted, saving a separate stat() of each one later.
+
+	@param[in] 	path 	the directory to read
+	@param[out] count 	receives the number of entries
+
+	@return an array of entries, to be freed (with each name)
+			by the caller, or NULL if there's a problem
+*/
+static tEntry *readEntries(const char *path, size_t *count)
+{
+	DIR		*dir;
+	struct dirent	*de;
+	tEntry	*entries, *more;
+	size_t	size;
+
+	dir = opendir(path);
+	if (dir == NULL)
+		return NULL;
+
+	*count = 0;
+	size = 64;
+	entries = (tEntry *)malloc(size * sizeof(tEntry));
+
+	while (entries != NULL && (de = readdir(dir)) != NULL)
+	{
+		if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+			continue;
+
+		if (*count == size)
+		{
+			size *= 2;
+			more = (tEntry *)realloc(entries, size * sizeof(tEntry));
+			if (more == NULL)
+				break;
+			entries = more;
+		}
+		entries[*count].name = (char *)malloc(strlen(de->d_name) + 1);
+		if (entries[*count].name == NULL)
+			break;
+		strcpy(entries[*count].name, de->d_name);
+
+		entries[*count].kind = -1;
+#ifdef _DIRENT_HAVE_D_TYPE
+		switch (de->d_type)
+		{
+		case DT_REG:	entries[*count].kind = qWalkFile;		break;
+		case DT_DIR:	entries[*count].kind = qWalkDirectory;	break;
+		case DT_UNKNOWN:										break;
+		default:		entries[*count].kind = 0;				break;
+		}
+#endif
+		++*count;
+	}
+	closedir(dir);
+
+	/* stopped early, because memory ran out */
+	if (entries != NULL && de != NULL)
+	{
+		while (*count > 0)
+			free(entries[--*count].name);
+		free(entries);
+		entries = NULL;
+	}
+
+	if (entries != NULL)
+		qsort(entries, *count, sizeof(tEntry), compareEntries);
+
+	return entries;
+}
+
+/**
+	@internal
+
+	Walks the contents of a directory, and those of any directories
+	within it. Symbolic links are ignored, so there's no danger of
+	walking in circles, or replacing a link with a file.
+
+	@param[in,out] 	path 	 	the directory's path, in a buffer that
+								is extended (and may be reallocated) with
+								the name of each entry in turn
+	@param[in,out] 	size 	 	the size of the path buffer
+	@param[in] 		length 	 	the length of the directory's path
+	@param[in] 		handler  	called for each entry
+	@param[in] 		context  	passed to the handler
+
+	@return int
+	@retval 0		all is well
+	@retval -108	unable to allocate memory
+	@retval <0		the handler stopped the walk
+*/
+static int walkDirectory(char **path, size_t *size, size_t length,
+						 tWalkHandler handler, void *context)
+{
+	tEntry	*entries;
+	char	*more;
+	size_t	count, i, nameLength;
+	struct stat	info;
+	int		kind, result;
+
+	errno = 0;
+	entries = readEntries(*path, &count);
+	if (entries == NULL)
+		return (errno == ENOMEM) ? -108 : handler(*path, qWalkError, context);
+
+	result = 0;
+	for (i = 0; i < count; ++i)
+	{
+		nameLength = strlen(entries[i].name);
+		if (result == 0 && length + nameLength + 2 > *size)
+		{
+			more = (char *)realloc(*path, (length + nameLength) * 2 + 2);
+			if (more == NULL)
+				result = -108;
+			else
+			{
+				*path = more;
+				*size = (length + nameLength) * 2 + 2;
+			}
+		}
+
+		if (result == 0)
+		{
+			(*path)[length] = '/';
+			strcpy(&(*path)[length + 1], entries[i].name);
+
+			kind = entries[i].kind;
+			if (kind < 0)
+			{
+				if (lstat(*path, &info) != 0)
+					kind = qWalkError;
+				else if (S_ISDIR(info.st_mode))
+					kind = qWalkDirectory;
+				else if (S_ISREG(info.st_mode))
+					kind = qWalkFile;
+				else
+					kind = 0;	/* links, devices, etc. */
+			}
+
+			if (kind != 0)
+				result = handler(*path, kind, context);
+
+			/* the handler returns 1 to skip a directory */
+			if (result == 0 && kind == qWalkDirectory)
+				result = walkDirectory(path, size, length + 1 + nameLength,
+									   handler, context);
+			else if (result > 0)
+				result = 0;
+
+			(*path)[length] = '\0';
+		}
+		free(entries[i].name);
+	}
+	free(entries);
+
+	return result;
+}
+#endif
+
+/*
+	public functions
+*/
+
+/**
+	Initialize a tSource object to the 'empty' state.
+
+	@param[out] 	src 	the tSource to initialize
+*/
+void initSource(tSource *src)
+{
+	src->data = NULL;
+	src->length = 0;
+	src->size = 0;
+}
+
+/**
+	Frees the memory held by a tSource, and returns it
+	to the 'empty' state.
+
+	@param[in,out] 	src 	the tSource to free
+*/
+void freeSource(tSource *src)
+{
+	if (src->data != NULL)
+		free(src->data);
+
+	initSource(src);
+}
+
+/**
+	Reads the remainder of a stream into a tSource.
+
+	The data is read in blocks of at least qReadBlockSize, doubling
+	the allocation whenever it fills up, so the number of reads and
+	reallocations is logarithmic in the size of the stream.
+
+	@param[in,out] 	src 	receives the contents of the stream
+	@param[in] 		file 	the stream to read
+
+	@return int
+	@retval 0		everything went smoothly
+	@retval -36		an error occurred while reading the stream
+	@retval -108	unable to allocate memory
+*/
+int readSource(tSource *src, FILE *file)
+{
+	char	*data;
+	size_t	size, count;
+
+	src->length = 0;
+
+	do {
+		if (src->length == src->size)
+		{
+			size = (src->size < qReadBlockSize) ? qReadBlockSize : src->size * 2;
+			data = (char *)realloc(src->data, size);
+			if (data == NULL)
+				return (-108);
+
+			src->data = data;
+			src->size = size;
+		}
+		count = fread(&src->data[src->length], sizeof(char),
+					  src->size - src->length, file);
+		src->length += count;
+	} while (count > 0);
+
+	return (ferror(file) ? -36 : 0);
+}
+
+/**
+	Finds the size and modification time of a file.
+
+	@param[in] 	path 	the file to examine
+	@param[out] stamp 	receives the file's size and modification time
+
+	@return int
+	@retval 0	all is well
+	@retval -43	the file doesn't exist, or can't be examined
+*/
+int stampFile(const char *path, tFileStamp *stamp)
+{
+	struct stat	info;
+
+	if (stat(path, &info) != 0)
+		return (-43);
+
+	stamp->size = info.st_size;
+	stamp->mtime = info.st_mtime;
+#ifdef WIN32
+	stamp->mtimeNsec = 0;
+#else
+	stamp->mtimeNsec = info.st_mtim.tv_nsec;
+#endif
+
+	return 0;
+}
+
+/**
+	Compares two tFileStamps.
+
+	@param[in] 	a 	one tFileStamp
+	@param[in] 	b 	the other tFileStamp
+
+	@return true if they describe the same version of a file
+*/
+bool sameStamp(const tFileStamp *a, const tFileStamp *b)
+{
+	return (bool)(a->size == b->size
+			   && a->mtime == b->mtime
+			   && a->mtimeNsec == b->mtimeNsec);
+}
+
+/**
+	Makes sure everything written to a file is on the disk, not just
+	in the stdio or system buffers, so a crash can't leave it empty
+	or partly written once it has been renamed into place.
+
+	@param[in] 	file 	the file, which is still open for writing
+
+	@return int
+	@retval 0	all is well
+	@retval -20	unable to write the file
+*/
+int syncFile(FILE *file)
+{
+	if (fflush(file) != 0)
+		return (-20);
+#ifndef WIN32
+	if (fsync(fileno(file)) != 0)
+		return (-20);
+#endif
+	return 0;
+}
+
+/**
+	Makes sure the renames within the directory holding a file are
+	on the disk. Not every system can do this (and some file systems
+	refuse), so it's done where possible, and failures are ignored.
+
+	@param[in] 	path 	a file within the directory
+*/
+void syncDirectory(const char *path)
+{
+#ifndef WIN32
+	char	*dir, *slash;
+	int		fd;
+
+	dir = (char *)malloc(strlen(path) + 2);
+	if (dir == NULL)
+		return;
+	strcpy(dir, path);
+	slash = strrchr(dir, '/');
+	if (slash == NULL)
+		strcpy(dir, ".");
+	else
+		slash[(slash == dir) ? 1 : 0] = '\0';
+
+	fd = open(dir, O_RDONLY);
+	if (fd >= 0)
+	{
+		fsync(fd);
+		close(fd);
+	}
+	free(dir);
+#else
+	(void)path;
+#endif
+}
+
+/**
+	Writes a block of memory to a file, replacing
+	whatever the file contained before. The file is
+	on the disk by the time this returns (see syncFile()).
+
+	@param[in] 	path 	the file to write
+	@param[in] 	data 	the new contents of the file
+	@param[in] 	length 	the number of characters in data
+
+	@return int
+	@retval 0	all is well
+	@retval -20	unable to write the file
+	@retval -43	unable to create the file
+*/
+int writeFile(const char *path, const char *data, size_t length)
+{
+	FILE	*file;
+	int		result = 0;
+
+	file = fopen(path, "w");
+	if (file == NULL)
+		return (-43);
+
+	if (fwrite(data, sizeof(char), length, file) != length)
+		result = -20;
+	if (syncFile(file) != 0)
+		result = -20;
+	if (fclose(file) != 0)
+		result = -20;
+
+	return result;
+}
+
+/**
+	Compares the contents of two files.
+
+	@param[in] 	a 	one file
+	@param[in] 	b 	the other file
+
+	@return true if both could be read, and they're the same
+*/
+bool sameFiles(const char *a, const char *b)
+{
+	FILE	*fileA, *fileB;
+	char	blockA[4096], blockB[4096];
+	size_t	count;
+	bool	same;
+
+	fileA = fopen(a, "r");
+	fileB = fopen(b, "r");
+	same = (bool)(fileA != NULL && fileB != NULL);
+	while (same)
+	{
+		count = fread(blockA, sizeof(char), sizeof(blockA), fileA);
+		same = (bool)(fread(blockB, sizeof(char), sizeof(blockB), fileB) == count
+				   && memcmp(blockA, blockB, count) == 0
+				   && !ferror(fileA) && !ferror(fileB));
+		if (count == 0)
+			break;
+	}
+	if (fileA != NULL)
+		fclose(fileA);
+	if (fileB != NULL)
+		fclose(fileB);
+
+	return same;
+}
+
+/**
+	Swaps two files, atomically, in a single step. Used to put
+	a new version of a file in place, while keeping the old one.
+
+	This needs renameat2(), which is Linux-specific, and isn't
+	supported by every file system (e.g. NFS).
+
+	@param[in] 	a 	one file
+	@param[in] 	b 	the other file
+
+	@return int
+	@retval 0	all is well
+	@retval 1	swapping files isn't supported here
+	@retval -1	unable to swap the files
+*/
+int exchangeFiles(const char *a, const char *b)
+{
+#ifdef RENAME_EXCHANGE
+	if (renameat2(AT_FDCWD, a, AT_FDCWD, b, RENAME_EXCHANGE) == 0)
+		return 0;
+
+	return (errno == ENOSYS || errno == EINVAL || errno == ENOTSUP) ? 1 : -1;
+#else
+	(void)a;
+	(void)b;
+	return 1;
+#endif
+}
+
+/**
+	Finds every file in a directory tree, calling a handler for
+	each file and directory found. The contents of each directory
+	are visited in alphabetical order.
+
+	If the root is a file rather than a directory, the handler is
+	just called for that file.
+
+	@param[in] 	root 	 	the directory to walk
+	@param[in] 	handler  	called for each file and directory
+	@param[in] 	context  	passed to the handler
+
+	@return int
+	@retval 0		all is well
+	@retval -43		the root doesn't exist, or walking directories
+					isn't supported here
+	@retval -108	unable to allocate memory
+	@retval <0		the handler stopped the walk
+*/
+int walkTree(const char *root, tWalkHandler handler, void *context)
+{
+#ifndef WIN32
+	struct stat	info;
+	char	*path;
+	size_t	size, length;
+	int		result;
+
+	if (stat(root, &info) != 0)
+		return (-43);
+	if (!S_ISDIR(info.st_mode))
+		return handler(root, qWalkFile, context);
+
+	/* 'dir/' and 'dir' are the same directory */
+	length = strlen(root);
+	while (length > 1 && root[length - 1] == '/')
+		--length;
+
+	size = length * 2 + 256;
+	path = (char *)malloc(size);
+	if (path == NULL)
+		return (-108);
+	memcpy(path, root, length);
+	path[length] = '\0';
+
+	result = walkDirectory(&path, &size, length, handler, context);
+	free(path);
+
+	return result;
+#else
+	(void)root;
+	(void)handler;
+	(void)context;
+	return (-43);
+#endif
+}
@@ -0,0 +1,62 @@
+/**
+	@file fileutils.h
+
+	Public interface for fileutils.c
+
+	@version 0.92
+	@author Paul Chambers
+	@date 2005-2006
+*/
+/* $Header$ */
+
+/**
+	the size of each block read from an input file.
+	The source buffer grows geometrically from here.
+*/
+#define qReadBlockSize	65536
+
+/**
+	an in-memory copy of an input stream.
+*/
+typedef struct {
+	char	*data;		/**< the bytes read from the stream */
+	size_t	length;		/**< the number of bytes in data */
+	size_t	size;		/**< the number of bytes allocated to data */
+} tSource;
+
+/**
+	identifies a version of a file, without reading it.
+*/
+typedef struct {
+	long long	size;		/**< the file's size, in bytes */
+	long long	mtime;		/**< when it was last modified, in seconds */
+	long		mtimeNsec;	/**< and nanoseconds, where that's available */
+} tFileStamp;
+
+/*
+	what walkTree() has found
+*/
+#define qWalkFile		1	/**< a regular file */
+#define qWalkDirectory	2	/**< a directory (return 1 to skip its contents) */
+#define qWalkError		3	/**< something that couldn't be examined or read */
+
+/**
+	called by walkTree() for each thing it finds. Returns 0 to carry
+	on, 1 to skip a directory, or a negative value to stop the walk.
+*/
+typedef int (*tWalkHandler)(const char *path, int kind, void *context);
+
+void initSource(tSource *src);
+void freeSource(tSource *src);
+int readSource(tSource *src, FILE *file);
+
+int stampFile(const char *path, tFileStamp *stamp);
+bool sameStamp(const tFileStamp *a, const tFileStamp *b);
+
+int syncFile(FILE *file);
+void syncDirectory(const char *path);
+int writeFile(const char *path, const char *data, size_t length);
+bool sameFiles(const char *a, const char *b);
+int exchangeFiles(const char *a, const char *b);
+
+int walkTree(const char *root, tWalkHandler handler, void *context);
@@ -0,0 +1,11 @@
+#include <string.h>
+
+int length(const char *s)
+{
+	return (int)strlen(s);
+}
+
+void copy(char *to, const char *from)
+{
+	strcpy(to, from);
+}
@@ -0,0 +1,28 @@
+#include <stdlib.h>
+
+struct tPoint {
+	int x;
+	int y;
+};
+
+typedef struct tPoint tPoint;
+
+enum { qRed = 1, qGreen = 2, qBlue = 4 };
+
+static int sTable[] = { 1, 2, 3, 5, 8 };
+
+tPoint *makePoint(int x, int y)
+{
+	tPoint *p = (tPoint *)malloc(sizeof(tPoint));
+
+	if (p == NULL)
+		return NULL;
+	p->x = x;
+	p->y = y;
+	return p;
+}
+
+int lookup(int i)
+{
+	return sTable[i];
+}
@@ -0,0 +1,24 @@
+#include <stdio.h>
+#include "local.h"
+
+#define qLimit	10
+#define SQUARE(x)	((x) * (x))
+
+#ifdef DEBUG
+static int debugging = 1;
+#else
+static int debugging = 0;
+#endif
+
+int limited(int n)
+{
+	return n > qLimit;
+}
+
+int square(int n)
+{
+#ifdef DEBUG
+	printf("%d\n", n);
+#endif
+	return SQUARE(n);
+}
@@ -0,0 +1,20 @@
+#include <stdio.h>
+
+static int count;
+
+/* adds two numbers */
+int add(int a, int b)
+{
+	return a + b;
+}
+
+static char *find(const char *s, int c)
+{
+	while (*s != '\0')
+	{
+		if (*s == c)
+			return (char *)s;
+		++s;
+	}
+	return NULL;
+}
@@ -0,0 +1,21 @@
+/* a file with braces where they don't count */
+
+static const char *open = "{ not a body }";
+static const char close = '}';
+
+int braces(void)
+{
+	/* { in a comment */
+	const char *s = "}\"{";	// } in a line comment
+
+	if (s[0] == '{')
+		return 1;
+	return 0;
+}
+
+int escaped(char c)
+{
+	if (c == '\'')
+		return -1;
+	return c == '\\';
+}
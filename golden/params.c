@@ -0,0 +1,25 @@
+#include <stddef.h>
+
+void clear(char *buf, size_t length)
+{
+	while (length-- > 0)
+		*buf++ = '\0';
+}
+
+int sum(const int *values, int count)
+{
+	int total = 0;
+
+	while (count-- > 0)
+		total += *values++;
+	return total;
+}
+
+unsigned long
+hash(const char *s,
+	 unsigned long seed)
+{
+	while (*s != '\0')
+		seed = seed * 31 + (unsigned char)*s++;
+	return seed;
+}
@@ -0,0 +1,23 @@
+#include <errno.h>
+
+int check(int value)
+{
+	if (value < 0)
+		return -1;
+	if (value == 0)
+		return 0;
+	if (value > 100)
+		return (EINVAL);
+	return 1;
+}
+
+static void nothing(int *out)
+{
+	*out = 0;
+	return;
+}
+
+double half(double d)
+{
+	return d / 2.0;
+}
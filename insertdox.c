@@ -15,62 +15,1782 @@
 #include <string.h>
 #include <ctype.h>
 
+#include "arenautils.h"
+#include "sinkutils.h"
 #include "stringutils.h"
 #include "bufferutils.h"
+#include "fileutils.h"
+#include "cacheutils.h"
+#include "jobutils.h"
 #include "parser.h"
+#include "statsutils.h"
+#include "keywordutils.h"
+#include "diffutils.h"
+#include "serverutils.h"
+#include "typeutils.h"
+#include "macroutils.h"
+
+#ifdef qHaveThreads
+#include <pthread.h>
+#endif
+#ifndef WIN32
+#include <fnmatch.h>
+#endif
 
 
 /** global options parsed from command line */
 tAppOptions gOptions;
 
+/** the application's name (argv[0]), used in error messages */
+static const char *gAppName;
+
+/** the files already processed (NULL if there's no --cache) */
+static tCache *sCache;
+
+/** a hash of the options that change the output, so a cache
+	written with different ones can be ignored (see addOption()) */
+static tHash sOptions = qHashStart;
+
+/**
+	what a job needs to process a file. These are kept and
+	reused by later jobs, rather than allocated for each file.
+*/
+typedef struct {
+	tSource	input;		/**< the contents of the file */
+	tParser	*parser;	/**< processes the contents */
+	tSink	output;		/**< collects the result in memory */
+	tSink	symbols;	/**< collects the record of each function (see --symbols) */
+} tWorkspace;
+
+/** workspaces not currently in use by any job */
+static tWorkspace *sIdle[qMaxThreads];
+
+/** the number of workspaces in sIdle */
+static int sIdleCount;
+
+#ifdef qHaveThreads
+/** protects sIdle and sIdleCount */
+static pthread_mutex_t sIdleLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/** where --symbols writes the records (NULL if there's no --symbols) */
+static FILE *sSymbolFile;
+
+#ifdef qHaveThreads
+/** protects sSymbolFile, so each file's records are kept together */
+static pthread_mutex_t sSymbolLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/**
+	what --check has found, in all of the files so far.
+*/
+typedef struct {
+	int		files;			/**< the files checked */
+	int		failed;			/**< the files with functions that need a comment */
+	size_t	functions;		/**< the functions found */
+	size_t	missing;		/**< the functions without a comment */
+} tChecked;
+
+/** what --check has found */
+static tChecked sChecked;
+
+#ifdef qHaveThreads
+/** protects sChecked */
+static pthread_mutex_t sCheckLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/**
+	the least that --max-memory may be set to: enough for the
+	parser's buffer, at its smallest, and the same again for output
+*/
+#define qMinMemory	(2 * qBufferSize)
+
+/**
+	the least each thread is given of a file that's big enough
+	to be split between several threads (see parseShards())
+*/
+#define qShardSize	(4 * 1024 * 1024)
+
+/**
+	one part of a file that's been split between several
+	threads. Each part starts and ends at a boundary.
+*/
+typedef struct {
+	const char	*data;		/**< the whole file */
+	const char	*filename;	/**< the name to use in a new file comment */
+	tBoundary	from;		/**< where the part starts */
+	size_t		end;		/**< where it ends */
+	tWorkspace	*ws;		/**< holds the result */
+	int			result;		/**< the value returned by finishParser() */
+} tShard;
+
+/**
+	writes the new contents of a file (see replaceFile()). Returns 0
+	if all is well, 1 if the contents are the same as the original,
+	or (like writeFile()) -43 if it can't create the file, or another
+	error code if something else goes wrong.
+*/
+typedef int (*tWriter)(const char *path, void *context);
+
+/**
+	a file being processed a block at a time (see --max-memory).
+*/
+typedef struct {
+	tJob	*job;		/**< the file's job */
+	FILE	*inFile;	/**< the file, open for reading */
+	tWorkspace	*ws;	/**< holds the parser, and each block of output */
+	size_t	bytes;		/**< the number of characters read */
+	tHash	hash;		/**< the hash of the output written */
+} tStream;
+
+/**
+	set once it's found that files can't be swapped (see
+	exchangeFiles()).
+*/
+static bool sNoExchange;
+
+#ifdef qHaveThreads
+/** protects sNoExchange */
+static pthread_mutex_t sExchangeLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/**
+	a list of arguments given with one of the options that
+	may be repeated.
+*/
+typedef struct {
+	char	**items;	/**< the arguments */
+	int		count;		/**< the number of arguments */
+} tArgList;
+
+/** the directories given with -r */
+static tArgList sRoots;
+
+/** the patterns given with --include */
+static tArgList sIncludes;
+
+/** the patterns given with --exclude */
+static tArgList sExcludes;
+
+/** the files -r processes if there's no --include: C and C++ sources */
+static char *sSourcePatterns[] = {
+	"*.c", "*.h", "*.cpp", "*.cc", "*.cxx", "*.hpp", "*.hh"
+};
+
+/** sSourcePatterns, as a list */
+static const tArgList sSources = {
+	sSourcePatterns, sizeof(sSourcePatterns) / sizeof(sSourcePatterns[0])
+};
+
+/** the lines given with --lines, in order, without overlaps */
+static tLineRange *sLines;
+
+/** the number of ranges in sLines */
+static int sLineCount;
+
+/**
+	the state of a walk through one of the -r directories.
+*/
+typedef struct {
+	tJobQueue	*queue;		/**< where to add the files found */
+	size_t	rootLength;		/**< the length of the directory's path */
+	bool	failed;			/**< some of the tree couldn't be read */
+} tWalk;
+
+
+/*
+	prototypes
+*/
+static void printVersion(const char *appName);
+static void printUsage(const char *appName);
+static void reportResult(tJob *job, const char *name, int result);
+static tWorkspace *takeWorkspace(void);
+static void freeWorkspace(tWorkspace *ws);
+static void returnWorkspace(tWorkspace *ws);
+static int moveFile(tJob *job, const char *from, const char *to, int failure);
+static int writeMemory(const char *path, void *context);
+static int writeStream(const char *path, void *context);
+static int replaceFile(tJob *job, const char *path,
+					   tWriter writer, void *context);
+static void endPhase(int phase, tTimestamp *mark);
+static int countShards(size_t length);
+static void *parseShard(void *arg);
+static int parseShards(tWorkspace *ws, const char *path);
+static void writeSymbols(const tSink *symbols);
+static int readAhead(tJob *job);
+static int rewriteFile(tJob *job, int *outcome, size_t *bytes);
+static int convertFile(tJob *job);
+static int checkFile(tJob *job);
+static bool matchPattern(const char *pattern, const char *path);
+static bool matchAny(const tArgList *patterns, const char *path);
+static int visitPath(const char *path, int kind, void *context);
+static int addLines(const char *arg);
+static int compareLines(const void *a, const void *b);
+static void sortLines(void);
+static int changeStream(FILE *outFile, FILE *inFile);
+static unsigned long parseSize(const char *arg);
+static void addOption(const char *name, const char *value);
+static void addOptionFile(const char *name, const char *filename);
+static int serveRequest(tSink *out, const char *data, size_t length,
+						char *path);
+
+/**
+	@internal
+
+	Prints version information to stderr.	
+
+	@param[in] 	appName 	the application's name (argv[0])
+*/
+static void printVersion(const char *appName)
+{
+	fprintf(stderr, "%s, version %s\n", appName, qVersion);
+	fprintf(stderr, "  Copyright (c) Paul Chambers, 2005-06\n");
+}
+
+/**
+@page Usage
+@verbatim
+ insertdox [-v|-h] [-p] [-b <filename>] [-j <count>] [--cache <filename>]
+           [--no-backup] [-r <dir> [--include <glob>] [--exclude <glob>]]
+           [--lines <ranges>] [--stats <filename>] [--max-memory <size>]
+           [-k <kind>=<words>] [--keywords <filename>] [--check]
+           [--server <socket>] [--symbols <filename>] [--prefetch <count>]
+           [-D <name>[=<value>]] [-U <name>] <file list>
+     -v, --version    print version message
+     -h, --help       print usage message
+     -p               only emit function comments and prototypes
+     -b <filename>    provide a 'boilerplate' file for the file comment
+     -j <count>       process up to <count> files at once, and split
+                      very big files between <count> threads
+     --prefetch <count>  read up to <count> files into memory ahead of the
+                      threads processing them, e.g. for a slow network
+                      file system
+     --cache <filename>  skip files that haven't changed since they
+                      were last processed, remembering them in <filename>
+     --no-backup      don't keep the original of each file as a '.bak' file
+     -r <dir>         also process the files in <dir>, and in the directories
+                      within it (by default, C and C++ files)
+     --include <glob> only process files in <dir> that match <glob>
+     --exclude <glob> don't process files in <dir> that match <glob>. A <glob>
+                      without a '/' matches file names, e.g. '*.c', otherwise
+                      it matches paths within <dir>, e.g. 'test/unit*'
+     --lines <ranges> only reprocess the functions within the given lines,
+                      e.g. '12-30,45', copying the rest of the file as it is
+                      (for files that have been processed before)
+     --stats <filename>  write statistics about the run to <filename>
+                      (or stdout, for '-'), as JSON
+     --max-memory <size>  use no more than about <size> bytes for each file,
+                      e.g. '64M', reading and writing it a block at a time.
+                      A function too big to fit is passed through unchanged
+     -k <kind>=<words>  also recognize the words in <words>, separated by
+                      commas, e.g. 'todo=REVIEW,TBD'. <kind> is one of:
+                        todo, note   a comment starting with one of the words
+                                     becomes a @todo or a @note
+                        return       a statement returning a value
+                        static       makes a function @internal
+                        const        makes an argument input only
+                        qualifier    kept in a type, like 'volatile'
+                        ignore       left out of a type, like 'inline'
+                        scope        opens a block of declarations, like
+                                     'namespace' or 'class'
+                        access       a label in a class, like 'public'
+                        template     starts a template's parameters
+                        operator     names an operator, like 'operator'
+                        trailing     may follow an argument list, with
+                                     brackets of its own, like 'noexcept'
+     --keywords <filename>  read more keywords from <filename>, one
+                      '<kind>=<words>' per line ('#' starts a comment)
+     --check          don't change anything, just list the functions that
+                      don't have a Doxygen comment, and exit with 1 if any
+                      are found
+     --server <socket>  answer requests on the Unix domain socket <socket>
+                      (or stdin, for '-') until asked to shut down, rather
+                      than processing any files. One request per line:
+                        file <path>       reply with the file processed
+                        data <length> [<name>]  the same for the <length>
+                                          bytes that follow
+                        file-diff <path>, data-diff <length> [<name>]
+                                          reply with a diff instead
+                        quit, shutdown    end the connection, or the server
+                      Each reply is 'ok <length>' and <length> bytes,
+                      or 'error <code> <why>'
+     --symbols <filename>  also write a record of each function found to
+                      <filename> (or stdout, for '-'), one line of JSON each,
+                      giving its name, line, return type, parameters, return
+                      values, todos and notes. Not with --cache, which
+                      would leave out the files it skips
+     -D <name>[=<value>], -U <name>  take the macro <name> to be defined
+                      (as <value>, or 1), or not. A branch of an #if, #ifdef
+                      or the like that's certainly compiled out, given those
+                      macros, is copied through as it is, rather than parsed.
+                      A condition that depends on other macros is parsed, as
+                      it is without -D or -U
+ if <file list> is empty, process stdin to stdout. @endverbatim
+*/
+/**
+	@internal
+
+	Prints version and usage information to stderr.	
+
+	@param[in] 	appName 	the application's name (argv[0])
+*/
+static void printUsage(const char *appName)
+{
+	printVersion(appName);
+	fprintf(stderr,
+		"Usage: %s [-v|-h] [-p] [-b <filename>] [-j <count>] [--cache <filename>]\n"
+		"           [--no-backup] [-r <dir> [--include <glob>] [--exclude <glob>]]\n"
+		"           [--lines <ranges>] [--stats <filename>] [--max-memory <size>]\n"
+		"           [-k <kind>=<words>] [--keywords <filename>] [--check]\n"
+		"           [--server <socket>] [--symbols <filename>] [--prefetch <count>]\n"
+		"           [-D <name>[=<value>]] [-U <name>] <file list>\n"
+		"    -v, --version    print version message\n"
+		"    -h, --help       print usage message\n"
+		"    -p               only emit function comments and prototypes\n"
+		"    -b <filename>    provide a 'boilerplate' file for the file comment\n"
+		"    -j <count>       process up to <count> files at once, and split\n"
+		"                     very big files between <count> threads\n"
+		"    --prefetch <count>  read up to <count> files into memory ahead of the\n"
+		"                     threads processing them, e.g. for a slow network\n"
+		"                     file system\n"
+		"    --cache <filename>  skip files that haven't changed since they\n"
+		"                     were last processed, remembering them in <filename>\n"
+		"    --no-backup      don't keep the original of each file as a '.bak' file\n"
+		"    -r <dir>         also process the files in <dir>, and in the directories\n"
+		"                     within it (by default, C and C++ files)\n"
+		"    --include <glob> only process files in <dir> that match <glob>\n"
+		"    --exclude <glob> don't process files in <dir> that match <glob>. A <glob>\n"
+		"                     without a '/' matches file names, e.g. '*.c', otherwise\n"
+		"                     it matches paths within <dir>, e.g. 'test/unit*'\n"
+		"    --lines <ranges> only reprocess the functions within the given lines,\n"
+		"                     e.g. '12-30,45', copying the rest of the file as it is\n"
+		"                     (for files that have been processed before)\n"
+		"    --stats <filename>  write statistics about the run to <filename>\n"
+		"                     (or stdout, for '-'), as JSON\n"
+		"    --max-memory <size>  use no more than about <size> bytes for each file,\n"
+		"                     e.g. '64M', reading and writing it a block at a time.\n"
+		"                     A function too big to fit is passed through unchanged\n"
+		, appName );
+	fprintf(stderr,
+		"    -k <kind>=<words>  also recognize the words in <words>, separated by\n"
+		"                     commas, e.g. 'todo=REVIEW,TBD'. <kind> is one of:\n"
+		"                       todo, note   a comment starting with one of the words\n"
+		"                                    becomes a @todo or a @note\n"
+		"                       return       a statement returning a value\n"
+		"                       static       makes a function @internal\n"
+		"                       const        makes an argument input only\n"
+		"                       qualifier    kept in a type, like 'volatile'\n"
+		"                       ignore       left out of a type, like 'inline'\n"
+		"                       scope        opens a block of declarations, like\n"
+		"                                    'namespace' or 'class'\n"
+		"                       access       a label in a class, like 'public'\n"
+		"                       template     starts a template's parameters\n"
+		"                       operator     names an operator, like 'operator'\n"
+		"                       trailing     may follow an argument list, with\n"
+		"                                    brackets of its own, like 'noexcept'\n"
+		"    --keywords <filename>  read more keywords from <filename>, one\n"
+		"                     '<kind>=<words>' per line ('#' starts a comment)\n"
+		"    --check          don't change anything, just list the functions that\n"
+		"                     don't have a Doxygen comment, and exit with 1 if any\n"
+		"                     are found\n"
+		"    --server <socket>  answer requests on the Unix domain socket <socket>\n"
+		"                     (or stdin, for '-') until asked to shut down, rather\n"
+		"                     than processing any files. One request per line:\n"
+		"                       file <path>       reply with the file processed\n"
+		"                       data <length> [<name>]  the same for the <length>\n"
+		"                                         bytes that follow\n"
+		"                       file-diff <path>, data-diff <length> [<name>]\n"
+		"                                         reply with a diff instead\n"
+		"                       quit, shutdown    end the connection, or the server\n"
+		"                     Each reply is 'ok <length>' and <length> bytes,\n"
+		"                     or 'error <code> <why>'\n"
+		"    --symbols <filename>  also write a record of each function found to\n"
+		"                     <filename> (or stdout, for '-'), one line of JSON each,\n"
+		"                     giving its name, line, return type, parameters, return\n"
+		"                     values, todos and notes. Not with --cache, which\n"
+		"                     would leave out the files it skips\n" );
+	fprintf(stderr,
+		"    -D <name>[=<value>], -U <name>  take the macro <name> to be defined\n"
+		"                     (as <value>, or 1), or not. A branch of an #if, #ifdef\n"
+		"                     or the like that's certainly compiled out, given those\n"
+		"                     macros, is copied through as it is, rather than parsed.\n"
+		"                     A condition that depends on other macros is parsed, as\n"
+		"                     it is without -D or -U\n"
+		"if <file list> is empty, process stdin to stdout.\n" );
+}
+
+/**
+	@internal
+
+	Reports an error returned by the parser, if there was one.
+
+	@param[in,out] 	job 	where to record the message (NULL for stderr)
+	@param[in] 		name 	the input being processed
+	@param[in] 		result 	the value returned by processFile()
+*/
+static void reportResult(tJob *job, const char *name, int result)
+{
+	const char *why;
+
+	switch (result)
+	{
+	case 0:
+		return;
+
+	case -20:
+		why = "unable to write the output of";
+		break;
+
+	case -36:
+		why = "unable to read";
+		break;
+
+	case -108:
+		why = "ran out of memory processing";
+		break;
+
+	default:
+		why = "unable to process";
+		break;
+	}
+
+	if (job != NULL)
+		jobError(job, "### error: %s '%s' (in %s)\n", why, name, gAppName);
+	else
+		fprintf(stderr, "### error: %s '%s' (in %s)\n", why, name, gAppName);
+}
+
+/**
+	@internal
+
+	Finds a workspace for a job to use, creating one
+	if all the existing ones are in use.
+
+	@return the workspace
+	@retval NULL	unable to allocate memory
+*/
+static tWorkspace *takeWorkspace(void)
+{
+	tWorkspace	*ws = NULL;
+
+#ifdef qHaveThreads
+	pthread_mutex_lock(&sIdleLock);
+#endif
+	if (sIdleCount > 0)
+		ws = sIdle[--sIdleCount];
+#ifdef qHaveThreads
+	pthread_mutex_unlock(&sIdleLock);
+#endif
+
+	if (ws == NULL)
+	{
+		ws = (tWorkspace *)malloc(sizeof(tWorkspace));
+		if (ws == NULL)
+			return NULL;
+
+		initSource(&ws->input);
+		ws->parser = createParser();
+		if (ws->parser == NULL || initSink(&ws->output, NULL) != 0)
+		{
+			if (ws->parser != NULL)
+				destroyParser(ws->parser);
+			free(ws);
+			return NULL;
+		}
+		if (initSink(&ws->symbols, NULL) != 0)
+		{
+			freeSink(&ws->output);
+			destroyParser(ws->parser);
+			free(ws);
+			return NULL;
+		}
+	}
+
+	return ws;
+}
+
+/**
+	@internal
+
+	Frees a workspace, first adding up what its parser
+	has done, if there's --stats.
+
+	@param[in] 	ws 	the workspace to free
+*/
+static void freeWorkspace(tWorkspace *ws)
+{
+	tParserCounts	counts;
+
+	if (gOptions.stats != NULL)
+	{
+		countParser(ws->parser, &counts);
+		addCounts(&counts);
+	}
+	freeSource(&ws->input);
+	freeSink(&ws->output);
+	freeSink(&ws->symbols);
+	destroyParser(ws->parser);
+	free(ws);
+}
+
+/**
+	@internal
+
+	Puts a workspace back, for the next job to use.
+
+	@param[in] 	ws 	the workspace, no longer in use
+*/
+static void returnWorkspace(tWorkspace *ws)
+{
+#ifdef qHaveThreads
+	pthread_mutex_lock(&sIdleLock);
+#endif
+	if (sIdleCount < qMaxThreads)
+	{
+		sIdle[sIdleCount++] = ws;
+		ws = NULL;
+	}
+#ifdef qHaveThreads
+	pthread_mutex_unlock(&sIdleLock);
+#endif
+
+	/* there can't be more in use than there are workers */
+	if (ws != NULL)
+		freeWorkspace(ws);
+}
+
+/**
+	@internal
+
+	Renames a file, recording an error if that fails.
+
+	@param[in,out] 	job 	where to record any error
+	@param[in] 		from 	the file's current name
+	@param[in] 		to 		the file's new name
+	@param[in] 		failure the value to return if it fails
+
+	@return 0 if all is well, otherwise failure
+*/
+static int moveFile(tJob *job, const char *from, const char *to, int failure)
+{
+	if (rename(from, to) == 0)
+		return 0;
+
+	jobError(job,
+			"### error: unable to rename '%s' to '%s' (in %s)\n",
+			from, to, gAppName);
+	return failure;
+}
+
+/**
+	@internal
+
+	Writes the new contents of a file from memory
+	(a tWriter, see replaceFile()).
+
+	@param[in] 	path 	 	the file to write
+	@param[in] 	context  	the tSink holding the new contents
+
+	@return int
+	@retval 0	all is well
+	@retval -20	unable to write the file
+	@retval -43	unable to create the file
+*/
+static int writeMemory(const char *path, void *context)
+{
+	tSink	*sink = (tSink *)context;
+
+	return writeFile(path, sink->data, sink->length);
+}
+
+/**
+	@internal
+
+	Processes a file a block at a time, writing the output as it
+	goes (a tWriter, see replaceFile()), so the file is never held
+	in memory. Used with --max-memory.
+
+	Anything too big for the parser's buffer is passed through
+	without a comment, with a warning.
+
+	@param[in] 		path 	 	the file to write
+	@param[in,out] 	context  	the tStream to process
+
+	@return int
+	@retval 0		all is well
+	@retval 1		the output is the same as the original file
+	@retval -20		unable to write the file
+	@retval -36		unable to read the original file
+	@retval -43		unable to create the file
+	@retval -108	unable to allocate memory
+*/
+static int writeStream(const char *path, void *context)
+{
+	tStream	*stream = (tStream *)context;
+	tParser	*parser = stream->ws->parser;
+	tSink	*sink = &stream->ws->output;
+	tParserCounts	before, after;
+	FILE	*outFile;
+	char	*block;
+	size_t	count, written;
+	int		result;
+
+	block = (char *)malloc(qReadBlockSize);
+	if (block == NULL)
+		return (-108);
+
+	outFile = fopen(path, "w");
+	if (outFile == NULL)
+	{
+		free(block);
+		return (-43);
+	}
+
+	countParser(parser, &before);
+	resetSink(sink, NULL);
+	resetParser(parser, sink, filenameFromPath(stream->job->path));
+
+	written = 0;
+	result = 0;
+	do {
+		count = fread(block, sizeof(char), qReadBlockSize, stream->inFile);
+		stream->bytes += count;
+		if (count > 0)
+			feedParser(parser, block, count);
+		else if (ferror(stream->inFile))
+			result = -36;
+		else
+			finishParser(parser);
+
+		if (sink->failed && result == 0)
+			result = -108;
+
+		/* pass on whatever that block produced */
+		stream->hash = continueHash(stream->hash, sink->data, sink->length);
+		if (fwrite(sink->data, sizeof(char), sink->length, outFile)
+			!= sink->length && result == 0)
+		{
+			result = -20;
+		}
+		written += sink->length;
+		sink->length = 0;
+	} while (count > 0 && result == 0);
+
+	if (result == 0 && syncFile(outFile) != 0)
+		result = -20;
+	if (fclose(outFile) != 0 && result == 0)
+		result = -20;
+	free(block);
+
+	countParser(parser, &after);
+	if (after.overflows != before.overflows)
+		jobError(stream->job,
+				"### warning: part of '%s' was too big for --max-memory, "
+				"so it was passed through unchanged (in %s)\n",
+				stream->job->path, gAppName);
+
+	/* leave the file alone if nothing's changed */
+	if (result == 0 && written == stream->bytes
+	 && sameFiles(path, stream->job->path))
+	{
+		result = 1;
+	}
+
+	return result;
+}
+
+/**
+	@internal
+
+	Replaces the contents of a file.
+
+	The original is never modified; the new contents are written
+	to a '.tmp' file and flushed to the disk, which is then put in
+	the original's place in a single step. So whenever the system
+	stops, the file holds either all of the old contents or all of
+	the new, and a '.tmp' file left behind is only ever a partial
+	or complete new version.
+
+	Normally the original is kept with a '.bak' suffix. Where the
+	system supports swapping files, the '.tmp' file is swapped with
+	the original, and the original (now '.tmp') is then renamed to
+	'.bak'. Otherwise, the original is renamed to '.bak', and then
+	the '.tmp' file to the original's name, which leaves a moment
+	when only the '.bak' file exists. Either way, the '.bak' file
+	only ever holds an original.
+
+	With --no-backup, the '.tmp' file simply replaces the original.
+
+	Once the files are renamed, the directory is flushed to the
+	disk as well, where the system allows it.
+
+	That makes three changes to the directory for each file
+	(creating the '.tmp' file and two renames or a swap and a
+	rename), or two with --no-backup, plus the two flushes: it
+	trades speed for safety, which a network file system feels.
+
+	@param[in,out] 	job 	 	where to record any errors
+	@param[in] 		path 	 	the file to replace
+	@param[in] 		writer 	 	writes the new contents of the file
+	@param[in] 		context  	passed to the writer
+
+	@return int
+	@retval 0	everything went smoothly
+	@retval 1	the new contents were the same as the
+				original, so it wasn't replaced
+	@retval -2	couldn't write the new file
+	@retval -3	couldn't rename (or swap) the original file
+	@retval -4	couldn't rename the new file
+	@retval -108	ran out of memory
+*/
+static int replaceFile(tJob *job, const char *path,
+					   tWriter writer, void *context)
+{
+	int		result;
+	char	*tmpname, *bakname;
+	bool	noExchange;
+
+	tmpname = cpycat(path,".tmp");
+	bakname = cpycat(path,".bak");
+	if (tmpname == NULL || bakname == NULL)
+	{
+		free(tmpname);
+		free(bakname);
+		return (-108);
+	}
+
+	result = writer(tmpname, context);
+	if (result == 1)
+	{
+		remove(tmpname);
+	}
+	else if (result != 0)
+	{
+		if (result == -43)
+			jobError(job,
+					"### error: unable to open '%s' for writing (in %s)\n",
+					tmpname, gAppName);
+		else
+		{
+			reportResult(job, path, result);
+			remove(tmpname);
+		}
+		result = -2;
+	}
+	else if (gOptions.noBackup)
+	{
+		result = moveFile(job, tmpname, path, -4);
+	}
+	else
+	{
+#ifdef qHaveThreads
+		pthread_mutex_lock(&sExchangeLock);
+#endif
+		noExchange = sNoExchange;
+#ifdef qHaveThreads
+		pthread_mutex_unlock(&sExchangeLock);
+#endif
+
+		result = noExchange ? 1 : exchangeFiles(path, tmpname);
+		if (result == 0)
+		{
+			/* the original is now the '.tmp' file */
+			result = moveFile(job, tmpname, bakname, -3);
+		}
+		else if (result == 1)
+		{
+			/* can't swap files here, so rename them as usual */
+#ifdef qHaveThreads
+			pthread_mutex_lock(&sExchangeLock);
+#endif
+			sNoExchange = true;
+#ifdef qHaveThreads
+			pthread_mutex_unlock(&sExchangeLock);
+#endif
+			result = moveFile(job, path, bakname, -3);
+			if (result == 0)
+				result = moveFile(job, tmpname, path, -4);
+		}
+		else
+		{
+			jobError(job,
+					"### error: unable to swap '%s' with '%s' (in %s)\n",
+					path, tmpname, gAppName);
+			remove(tmpname);
+			result = -3;
+		}
+	}
+
+	if (result == 0)
+		syncDirectory(path);
+
+	free(bakname);
+	free(tmpname);
+
+	return result;
+}
+
+/**
+	@internal
+
+	Marks the end of one phase of processing a file, and the
+	start of the next, if the time spent is being recorded
+	(see --stats).
+
+	@param[in] 		phase 	the phase that's ended (e.g. qPhaseRead)
+	@param[in,out] 	mark 	when the phase started; updated to now
+*/
+static void endPhase(int phase, tTimestamp *mark)
+{
+	tTimestamp	now;
+
+	if (gOptions.stats != NULL)
+	{
+		takeTimestamp(&now);
+		addPhase(phase, mark, &now);
+		*mark = now;
+	}
+}
+
+/**
+	@internal
+
+	Decides how many threads a file should be split between (see
+	parseShards()). Only files that are big enough to be worth the
+	trouble are split.
+
+	@param[in] 	length 	the size of the file
+
+	@return the number of parts to split the file into
+*/
+static int countShards(size_t length)
+{
+#ifdef qHaveThreads
+	size_t	count = length / qShardSize;
+
+	if (count > (size_t)gOptions.threads)
+		count = gOptions.threads;
+
+	return (count > 1) ? (int)count : 1;
+#else
+	(void)length;
+	return 1;
+#endif
+}
+
+/**
+	@internal
+
+	Processes one part of a file (see parseShards()). It's the
+	body of a thread, if there are threads.
+
+	@param[in,out] 	arg 	the tShard to process
+
+	@return always NULL
+*/
+static void *parseShard(void *arg)
+{
+	tShard	*shard = (tShard *)arg;
+	tParser	*parser = shard->ws->parser;
+
+	resumeParser(parser, &shard->ws->output, shard->filename, &shard->from);
+	feedParser(parser, &shard->data[shard->from.offset],
+			   shard->end - shard->from.offset);
+	shard->result = finishParser(parser);
+
+	return NULL;
+}
+
+/**
+	@internal
+
+	Processes a big file by splitting it into parts, and giving
+	each one to a different thread. The parts are split at
+	boundaries (see nextBoundary()), so the output is the same
+	as if the whole file had been processed in one go.
+
+	The file is in the workspace's input, and the result is left
+	in the workspace's output (and its symbols, with --symbols). The
+	other parts are processed in workspaces of their own, and added
+	on the end.
+
+	@param[in,out] 	ws 	 		holds the file, and receives the result
+	@param[in] 		path 		the file's path
+
+	@return int
+	@retval 0		everything went smoothly
+	@retval -20		unable to write the output
+	@retval -108	unable to allocate memory
+*/
+static int parseShards(tWorkspace *ws, const char *path)
+{
+	tShard	shards[qMaxThreads];
+#ifdef qHaveThreads
+	pthread_t	threads[qMaxThreads];
+	bool	started[qMaxThreads];
+#endif
+	tBoundary	at;
+	const char	*data = ws->input.data;
+	size_t	length = ws->input.length;
+	const char	*filename = filenameFromPath((char *)path);
+	bool	more;
+	int		i, count, target, result;
+
+	target = countShards(length);
+
+	/* split it as evenly as the boundaries allow */
+	firstBoundary(&at);
+	more = true;
+	count = 0;
+	result = 0;
+	do {
+		shards[count].data = data;
+		shards[count].filename = filename;
+		shards[count].from = at;
+		shards[count].ws = (count == 0) ? ws : takeWorkspace();
+		if (shards[count].ws == NULL)
+		{
+			result = -108;
+			break;
+		}
+
+		while (more && at.offset < length / target * (count + 1))
+			more = nextBoundary(data, length, &at);
+
+		++count;
+		shards[count - 1].end = (more && count < target) ? at.offset : length;
+	} while (shards[count - 1].end < length);
+
+	if (result == 0)
+	{
+		for (i = 1; i < count; ++i)
+		{
+			resetSink(&shards[i].ws->output, NULL);
+			resetSink(&shards[i].ws->symbols, NULL);
+			exportParser(shards[i].ws->parser,
+						 (sSymbolFile != NULL) ? &shards[i].ws->symbols : NULL,
+						 path);
+#ifdef qHaveThreads
+			started[i] = (bool)(pthread_create(&threads[i], NULL,
+											  parseShard, &shards[i]) == 0);
+#endif
+		}
+
+		/* this thread takes the first part */
+		parseShard(&shards[0]);
+
+		for (i = 1; i < count; ++i)
+		{
+#ifdef qHaveThreads
+			if (started[i])
+				pthread_join(threads[i], NULL);
+			else
+#endif
+				parseShard(&shards[i]);
+		}
+
+		for (i = 0; i < count; ++i)
+		{
+			if (result == 0)
+				result = shards[i].result;
+			if (i > 0)
+			{
+				sinkWrite(&ws->output, shards[i].ws->output.data,
+						  shards[i].ws->output.length);
+				sinkWrite(&ws->symbols, shards[i].ws->symbols.data,
+						  shards[i].ws->symbols.length);
+			}
+		}
+		if (result == 0 && (ws->output.failed || ws->symbols.failed))
+			result = -108;
+	}
+
+	for (i = 1; i < count; ++i)
+		returnWorkspace(shards[i].ws);
+
+	return result;
+}
+
+/**
+	@internal
+
+	Writes the records of the functions in a file to the
+	--symbols file, all together.
+
+	@param[in] 	symbols 	the records
+*/
+static void writeSymbols(const tSink *symbols)
+{
+#ifdef qHaveThreads
+	pthread_mutex_lock(&sSymbolLock);
+#endif
+	fwrite(symbols->data, sizeof(char), symbols->length, sSymbolFile);
+#ifdef qHaveThreads
+	pthread_mutex_unlock(&sSymbolLock);
+#endif
+}
+
+/**
+	@internal
+
+	Reads a job's file into memory ahead of its worker (see
+	--prefetch), recording the version that was read. Nothing is
+	read if the file is going to be read a block at a time (with
+	--max-memory) or skipped (with --cache) anyway.
+
+	May be called from the reader thread. Nothing is reported if
+	the file can't be read, as the worker will try again, and
+	report that itself.
+
+	@param[in,out] 	job 	identifies the file to read
+
+	@return always 0
+*/
+static int readAhead(tJob *job)
+{
+	FILE	*inFile;
+	tFileStamp	cachedStamp;
+	tHash	cachedHash;
+
+	if (gOptions.maxMemory != 0 || stampFile(job->path, &job->stamp) != 0)
+		return 0;
+	if (sCache != NULL
+	 && lookupCache(sCache, job->path, &cachedStamp, &cachedHash)
+	 && sameStamp(&job->stamp, &cachedStamp))
+	{
+		return 0;
+	}
+
+	inFile = fopen(job->path, "r");
+	if (inFile != NULL)
+	{
+		job->fetched = (bool)(readSource(&job->input, inFile) == 0);
+		fclose(inFile);
+	}
+
+	return 0;
+}
+
+/**
+	@internal
+
+	Processes a single file in place.
+
+	The file is only rewritten if processing it changed something,
+	so running over the same files twice leaves them untouched.
+
+	If there's a cache (see --cache), a file that still has the size
+	and modification time it had when it was last processed isn't
+	even read, and afterwards the cache is updated with the file's
+	new size, modification time and a hash of its contents.
+
+	If the file was read ahead (see readAhead()), and hasn't
+	changed since, its contents are used rather than reading
+	it again.
+
+	@param[in,out] 	job 	 	identifies the file to process
+	@param[out] 	outcome  	receives what became of the file
+								(e.g. qFileRewritten), if all is well
+	@param[out] 	bytes 	 	receives the size of the file, if it was read
+
+	@return int
+	@retval 0	everything went smoothly
+	@retval -1	couldn't read the input file
+	@retval -2	couldn't write to the output file
+	@retval -3	couldn't rename the input file
+	@retval -4	couldn't rename the output file
+*/
+static int rewriteFile(tJob *job, int *outcome, size_t *bytes)
+{
+	int		result;
+	FILE	*inFile;
+	tWorkspace	*ws;
+	tSource	*src, spare;
+	tSink	*sink;
+	tFileStamp	stamp, cachedStamp;
+	tHash	hash, cachedHash;
+	bool	cached;
+	char	*path = job->path;
+	tTimestamp	mark;
+	tStream	stream;
+
+	if (gOptions.stats != NULL)
+		takeTimestamp(&mark);
+
+	*outcome = qFileUnchanged;
+	cached = false;
+	if (sCache != NULL && stampFile(path, &stamp) == 0)
+	{
+		cached = lookupCache(sCache, path, &cachedStamp, &cachedHash);
+		if (cached && sameStamp(&stamp, &cachedStamp))
+		{
+			*outcome = qFileSkipped;
+			return 0;	/* hasn't changed since it was processed */
+		}
+	}
+
+	if (job->fetched
+	 && (stampFile(path, &stamp) != 0 || !sameStamp(&stamp, &job->stamp)))
+	{
+		job->fetched = false;	/* it's changed since it was read */
+	}
+
+	inFile = NULL;
+	if (!job->fetched)
+	{
+		inFile = fopen(path,"r");
+		if (inFile == NULL)
+		{
+			jobError(job,
+					"### error: unable to open '%s' for reading (in %s)\n",
+					path, gAppName);
+			return (-1);
+		}
+	}
+
+	ws = takeWorkspace();
+	if (ws == NULL)
+	{
+		if (inFile != NULL)
+			fclose(inFile);
+		reportResult(job, path, -108);
+		return (-108);
+	}
+	src = &ws->input;
+	sink = &ws->output;
+	resetSink(&ws->symbols, NULL);
+	exportParser(ws->parser, (sSymbolFile != NULL) ? &ws->symbols : NULL, path);
+
+	if (gOptions.maxMemory != 0)
+	{
+		/* never holds more than a block of it (see --max-memory) */
+		stream.job = job;
+		stream.inFile = inFile;
+		stream.ws = ws;
+		stream.bytes = 0;
+		stream.hash = qHashStart;
+		result = replaceFile(job, path, writeStream, &stream);
+		fclose(inFile);
+		*bytes = stream.bytes;
+		hash = stream.hash;
+		endPhase(qPhaseParse, &mark);
+
+		if (result == 0)
+			*outcome = qFileRewritten;
+		else if (result == 1)
+			result = 0;		/* it was already up to date */
+	}
+	else
+	{
+		if (job->fetched)
+		{
+			/* trade buffers, rather than copying the contents */
+			spare = *src;
+			*src = job->input;
+			job->input = spare;
+			result = 0;
+		}
+		else
+		{
+			result = readSource(src, inFile);
+			fclose(inFile);
+		}
+		*bytes = src->length;
+		endPhase(qPhaseRead, &mark);
+
+		if (result != 0)
+			reportResult(job, path, result);
+		else
+		{
+			hash = hashBlock(src->data, src->length);
+
+			/* if the contents still match, it was only touched */
+			if (!cached || hash != cachedHash)
+			{
+				resetSink(sink, NULL);
+				if (sLineCount > 0)
+				{
+					result = processChanges(ws->parser, sink, src->data,
+											src->length, filenameFromPath(path),
+											sLines, sLineCount);
+				}
+				else if (countShards(src->length) > 1)
+				{
+					result = parseShards(ws, path);
+				}
+				else
+				{
+					resetParser(ws->parser, sink, filenameFromPath(path));
+
+					/* this performs the actual processing */
+					feedParser(ws->parser, src->data, src->length);
+					result = finishParser(ws->parser);
+				}
+				reportResult(job, path, result);
+				if (result == 0)
+				{
+					hash = hashBlock(sink->data, sink->length);
+					endPhase(qPhaseParse, &mark);
+					if (sink->length != src->length
+					 || memcmp(sink->data, src->data, src->length) != 0)
+					{
+						result = replaceFile(job, path, writeMemory, sink);
+						*outcome = qFileRewritten;
+					}
+				}
+			}
+		}
+	}
+
+	if (result == 0 && sSymbolFile != NULL)
+	{
+		if (ws->symbols.failed)
+		{
+			result = -108;
+			reportResult(job, path, result);
+		}
+		else
+			writeSymbols(&ws->symbols);
+	}
+
+	if (result == 0 && sCache != NULL && stampFile(path, &stamp) == 0)
+		updateCache(sCache, path, &stamp, hash);
+	endPhase(qPhaseCommit, &mark);
+
+	returnWorkspace(ws);
+
+	return result;
+}
+
+/**
+	@internal
+
+	Processes a single file in place (see rewriteFile()), and
+	if there's --stats, records how long that took.
+
+	May be called from a worker thread, so any errors are
+	recorded against the job rather than written to stderr.
+
+	@param[in,out] 	job 	identifies the file to process
+
+	@return int
+	@retval 0	everything went smoothly
+	@retval -1	couldn't read the input file
+	@retval -2	couldn't write to the output file
+	@retval -3	couldn't rename the input file
+	@retval -4	couldn't rename the output file
+*/
+static int convertFile(tJob *job)
+{
+	tTimestamp	start, end;
+	size_t	bytes = 0;
+	int		result, outcome;
+
+	if (gOptions.stats == NULL)
+		return rewriteFile(job, &outcome, &bytes);
+
+	takeTimestamp(&start);
+	result = rewriteFile(job, &outcome, &bytes);
+	takeTimestamp(&end);
+
+	addFile(job->path, (result != 0) ? qFileFailed : outcome,
+			bytes, &start, &end);
+
+	return result;
+}
+
+/**
+	@internal
+
+	Lists the functions in a file that don't have a Doxygen
+	comment, followed by a summary if there are any (--check).
+	The file is read a block at a time (unless it was read
+	ahead, see readAhead()), and left as it is.
+
+	May be called from a worker thread, so the list is recorded
+	against the job rather than written to stdout.
+
+	@param[in,out] 	job 	identifies the file to check
+
+	@return int
+	@retval 0		everything went smoothly
+	@retval -1		couldn't read the file
+	@retval -108	unable to allocate memory
+*/
+static int checkFile(tJob *job)
+{
+	tWorkspace	*ws;
+	tSink	*sink;
+	tParserCounts	before, after;
+	FILE	*inFile;
+	char	*block;
+	char	summary[80];
+	size_t	count;
+	int		result = 0;
+
+	inFile = NULL;
+	block = NULL;
+	if (!job->fetched)
+	{
+		inFile = fopen(job->path, "r");
+		if (inFile == NULL)
+		{
+			jobError(job,
+					"### error: unable to open '%s' for reading (in %s)\n",
+					job->path, gAppName);
+			return (-1);
+		}
+		block = (char *)malloc(qReadBlockSize);
+	}
+
+	ws = takeWorkspace();
+	if (ws == NULL || (inFile != NULL && block == NULL))
+	{
+		if (ws != NULL)
+			returnWorkspace(ws);
+		free(block);
+		if (inFile != NULL)
+			fclose(inFile);
+		reportResult(job, job->path, -108);
+		return (-108);
+	}
+	sink = &ws->output;
+
+	countParser(ws->parser, &before);
+	resetSink(sink, NULL);
+	resetParser(ws->parser, sink, job->path);
+	if (job->fetched)
+	{
+		feedParser(ws->parser, job->input.data, job->input.length);
+		finishParser(ws->parser);
+	}
+	else
+	{
+		do {
+			count = fread(block, sizeof(char), qReadBlockSize, inFile);
+			if (count > 0)
+				feedParser(ws->parser, block, count);
+			else if (ferror(inFile))
+				result = -1;
+			else
+				finishParser(ws->parser);
+		} while (count > 0);
+		fclose(inFile);
+		free(block);
+	}
+	countParser(ws->parser, &after);
+
+	after.missing -= before.missing;
+	after.documented -= before.documented;
+	if (result == 0 && sink->failed)
+		result = -108;
+	if (result == 0 && after.missing > 0)
+	{
+		sprintf(summary, ": %lu of %lu functions need a comment\n",
+				(unsigned long)after.missing,
+				(unsigned long)(after.missing + after.documented));
+		if (jobOutput(job, sink->data, sink->length) != 0
+		 || jobOutput(job, job->path, strlen(job->path)) != 0
+		 || jobOutput(job, summary, strlen(summary)) != 0)
+		{
+			result = -108;
+		}
+	}
+	returnWorkspace(ws);
+
+	if (result == -1)
+		jobError(job, "### error: unable to read '%s' (in %s)\n",
+				 job->path, gAppName);
+	else
+		reportResult(job, job->path, result);
+
+#ifdef qHaveThreads
+	pthread_mutex_lock(&sCheckLock);
+#endif
+	++sChecked.files;
+	if (after.missing > 0)
+		++sChecked.failed;
+	sChecked.functions += after.missing + after.documented;
+	sChecked.missing += after.missing;
+#ifdef qHaveThreads
+	pthread_mutex_unlock(&sCheckLock);
+#endif
+
+	return result;
+}
+
+/**
+	@internal
+
+	Checks a path found by -r against a glob pattern.
+
+	A pattern without a '/' is matched against just the file's name
+	(e.g. '*.c'); otherwise it's matched against the path from the
+	top of the tree, where '*' matches across directories as well,
+	so 'test/unit*' covers everything in 'test' whose path starts
+	with 'unit', however deep.
+
+	@param[in] 	pattern 	the pattern to match
+	@param[in] 	path 		the path, relative to the top of the tree
+
+	@return true if the pattern matches
+*/
+static bool matchPattern(const char *pattern, const char *path)
+{
+	const char	*name;
+
+	if (strchr(pattern, '/') == NULL)
+	{
+		name = strrchr(path, '/');
+		if (name != NULL)
+			path = name + 1;
+	}
+#ifdef WIN32
+	return (bool)(strcmp(pattern, path) == 0);
+#else
+	return (bool)(fnmatch(pattern, path, 0) == 0);
+#endif
+}
+
+/**
+	@internal
+
+	Checks a path against a list of patterns.
+
+	@param[in] 	patterns 	the patterns to check
+	@param[in] 	path 		the path, relative to the top of the tree
+
+	@return true if any of the patterns match
+*/
+static bool matchAny(const tArgList *patterns, const char *path)
+{
+	int	i;
+
+	for (i = 0; i < patterns->count; ++i)
+	{
+		if (matchPattern(patterns->items[i], path))
+			return true;
+	}
+	return false;
+}
+
+/**
+	@internal
+
+	Called by walkTree() for each file and directory found by -r.
+	Files that pass the --include and --exclude patterns are added
+	to the queue straight away, so the workers start on them while
+	the walk carries on.
+
+	@param[in] 	path 	 	the file or directory found
+	@param[in] 	kind 	 	what it is (see walkTree())
+	@param[in] 	context 	the tWalk for this tree
+
+	@return int
+	@retval 0		carry on
+	@retval 1		skip this directory
+	@retval -108	unable to allocate memory
+*/
+static int visitPath(const char *path, int kind, void *context)
+{
+	tWalk	*walk = (tWalk *)context;
+	const char	*relative;
+	char	*dirname;
+	bool	excluded;
+
+	/* the path within the tree */
+	relative = path;
+	if (strlen(path) > walk->rootLength)
+		relative = &path[walk->rootLength + 1];
+
+	switch (kind)
+	{
+	case qWalkFile:
+		if (matchAny(sIncludes.count == 0 ? &sSources : &sIncludes, relative))
+		{
+			if (!matchAny(&sExcludes, relative)
+			 && addJob(walk->queue, path) != 0)
+			{
+				return (-108);
+			}
+		}
+		break;
+
+	case qWalkDirectory:
+		/* so a pattern for everything in a directory
+			excludes the directory itself, too */
+		dirname = cpycat(relative, "/");
+		if (dirname == NULL)
+			return (-108);
+		excluded = (bool)(matchAny(&sExcludes, relative)
+						|| matchAny(&sExcludes, dirname));
+		free(dirname);
+		return excluded;
+
+	case qWalkError:
+		fprintf(stderr,
+				"### error: unable to read '%s' (in %s)\n",
+				path, gAppName);
+		walk->failed = true;
+		break;
+	}
+	return 0;
+}
+
+/**
+	@internal
+
+	Adds the lines given with --lines, e.g. '12-30,45'.
+
+	@param[in] 	arg 	the ranges of lines
+
+	@return int
+	@retval 0		all is well
+	@retval -1		the ranges can't be understood
+	@retval -108	unable to allocate memory
+*/
+static int addLines(const char *arg)
+{
+	tLineRange	*more;
+	const char	*p;
+	char	*end;
+	int		count;
+
+	count = 1;
+	for (p = arg; *p != '\0'; ++p)
+	{
+		if (*p == ',')
+			++count;
+	}
+
+	more = (tLineRange *)realloc(sLines,
+								 (sLineCount + count) * sizeof(tLineRange));
+	if (more == NULL)
+		return (-108);
+	sLines = more;
+
+	p = arg;
+	while (count-- > 0)
+	{
+		more = &sLines[sLineCount];
+		more->first = strtol(p, &end, 10);
+		if (end == p || more->first < 1)
+			return (-1);
+
+		more->last = more->first;
+		if (*end == '-')
+		{
+			p = end + 1;
+			more->last = strtol(p, &end, 10);
+			if (end == p || more->last < more->first)
+				return (-1);
+		}
+
+		if (*end != (count > 0 ? ',' : '\0'))
+			return (-1);
+		p = end + 1;
+		++sLineCount;
+	}
+
+	return 0;
+}
+
+/**
+	@internal
+
+	qsort() comparison function, to put ranges of lines in order.
+
+	@param[in] 	a 	points to one tLineRange
+	@param[in] 	b 	points to the other tLineRange
+
+	@return int
+*/
+static int compareLines(const void *a, const void *b)
+{
+	long	first = ((const tLineRange *)a)->first;
+	long	other = ((const tLineRange *)b)->first;
+
+	return (first > other) - (first < other);
+}
+
+/**
+	@internal
+
+	Puts the lines given with --lines in order, and
+	merges any ranges that overlap or touch.
+*/
+static void sortLines(void)
+{
+	int		i, count;
+
+	qsort(sLines, sLineCount, sizeof(tLineRange), compareLines);
+
+	count = 0;
+	for (i = 0; i < sLineCount; ++i)
+	{
+		if (count > 0 && sLines[i].first <= sLines[count - 1].last + 1)
+		{
+			if (sLines[count - 1].last < sLines[i].last)
+				sLines[count - 1].last = sLines[i].last;
+		}
+		else
+			sLines[count++] = sLines[i];
+	}
+	sLineCount = count;
+}
+
+/**
+	@internal
+
+	Processes just the lines given with --lines of a stream (see
+	processChanges()). Unlike processFile(), this has to wait for
+	the whole stream, so it can copy the rest of it through.
 
-/*
-	prototypes
+	@param[out] outFile 	where to write the result
+	@param[in] 	inFile		the stream to process
+
+	@return int
+	@retval 0		everything went smoothly
+	@retval -20		unable to write the output
+	@retval -36		unable to read the input
+	@retval -108	unable to allocate memory
 */
-static void printVersion(const char *appName);
-static void printUsage(const char *appName);
+static int changeStream(FILE *outFile, FILE *inFile)
+{
+	tWorkspace	*ws;
+	int		result;
+
+	ws = takeWorkspace();
+	if (ws == NULL)
+		return (-108);
+
+	result = readSource(&ws->input, inFile);
+	if (result == 0)
+	{
+		resetSink(&ws->output, outFile);
+		result = processChanges(ws->parser, &ws->output, ws->input.data,
+								ws->input.length, NULL, sLines, sLineCount);
+	}
+	freeWorkspace(ws);
+
+	return result;
+}
 
 /**
 	@internal
 
-	Prints version information to stderr.	
+	Reads a size given on the command line, in bytes, or with
+	a 'k', 'M' or 'G' suffix, e.g. '64M'.
 
-	@param[in] 	appName 	the application's name (argv[0])
+	@param[in] 	arg 	the size
+
+	@return the size in bytes, or 0 if it can't be understood
 */
-static void printVersion(const char *appName)
+static unsigned long parseSize(const char *arg)
 {
-	fprintf(stderr, "%s, version %s\n", appName, qVersion);
-	fprintf(stderr, "  Copyright (c) Paul Chambers, 2005-06\n");
+	unsigned long	size;
+	char	*end;
+
+	size = strtoul(arg, &end, 10);
+	if (end == arg)
+		return 0;
+
+	switch (*end)
+	{
+	case 'g':
+	case 'G':
+		size *= 1024;
+		/* fall through */
+	case 'm':
+	case 'M':
+		size *= 1024;
+		/* fall through */
+	case 'k':
+	case 'K':
+		size *= 1024;
+		++end;
+		break;
+	}
+
+	return (*end == '\0') ? size : 0;
 }
 
 /**
-@page Usage
-@verbatim
- insertdox [-v|-h] [-p] [-b <filename>] <file list>
-     -v, --version    print version message
-     -h, --help       print usage message
-     -p               only emit function comments and prototypes
-     -b <filename>    provide a 'boilerplate' file for the file comment
- if <file list> is empty, process stdin to stdout. @endverbatim
+	@internal
+
+	Adds an option that changes the output to sOptions. Options
+	whose order matters (like -D and -U) are added in order.
+
+	@param[in] 	name 	the option
+	@param[in] 	value 	its value ("" if it hasn't one)
 */
+static void addOption(const char *name, const char *value)
+{
+	sOptions = continueHash(sOptions, name, strlen(name) + 1);
+	sOptions = continueHash(sOptions, value, strlen(value) + 1);
+}
+
 /**
 	@internal
 
-	Prints version and usage information to stderr.	
+	Adds an option naming a file to sOptions, with the contents of
+	the file, so editing it changes the hash as well. If the file
+	can't be read, only its name is added (the option itself will
+	report the problem).
 
-	@param[in] 	appName 	the application's name (argv[0])
+	@param[in] 	name 		the option
+	@param[in] 	filename 	the file it names
 */
-static void printUsage(const char *appName)
+static void addOptionFile(const char *name, const char *filename)
 {
-	printVersion(appName);
-	fprintf(stderr,
-		"Usage: %s [-v|-h] [-p] [-b <filename>] <file list>\n"
-		"    -v, --version    print version message\n"
-		"    -h, --help       print usage message\n"
-		"    -p               only emit function comments and prototypes\n"
-		"    -b <filename>    provide a 'boilerplate' file for the file comment\n"
-		"if <file list> is empty, process stdin to stdout.\n"
-	, appName );
+	tSource	src;
+	FILE	*file;
+
+	addOption(name, filename);
+
+	initSource(&src);
+	file = fopen(filename, "rb");
+	if (file != NULL)
+	{
+		if (readSource(&src, file) == 0)
+			sOptions = continueHash(sOptions, src.data, src.length);
+		fclose(file);
+	}
+	freeSource(&src);
+}
+
+/**
+	@internal
+
+	Processes a file for --server. The workspace, and so the parser,
+	the boilerplate and the keywords, are all kept from one request
+	to the next, so only the first request pays to set them up.
+
+	@param[out] out 	receives the processed contents
+	@param[in] 	data 	the contents of the file
+	@param[in] 	length 	the number of characters in data
+	@param[in] 	path 	the file's path or name (NULL if it hasn't one)
+
+	@return int
+	@retval 0		everything went smoothly
+	@retval -108	unable to allocate memory
+*/
+static int serveRequest(tSink *out, const char *data, size_t length,
+						char *path)
+{
+	tWorkspace	*ws;
+	int		result;
+
+	ws = takeWorkspace();
+	if (ws == NULL)
+		return (-108);
+
+	resetParser(ws->parser, out, filenameFromPath(path));
+	feedParser(ws->parser, data, length);
+	result = finishParser(ws->parser);
+	returnWorkspace(ws);
+
+	return result;
 }
 
 /**
@@ -88,20 +1808,48 @@ static void printUsage(const char *appName)
 	@retval -2	couldn't write to an output file
 	@retval -3	couldn't rename the input file
 	@retval -4	couldn't rename the output file
+	@retval -43	couldn't find a directory given with -r
+	@retval -108	ran out of memory
 */
 
 int main(int argc, char *argv[])
 {
 	int	result;
-	int 	i, count;
-	FILE	*inFile, *outFile;
-	char	*tmpname, *bakname;
+	int 	i, count, workers;
+	int		keyResult;
+	long	line;
+	char	*macro;
+	char	option;
+	char	size[32];
+	tJobQueue	*queue;
+	tWalk	walk;
+	tParserCounts	counts;
+	tSink	symbols;
 	bool	usageOnly;
 
 	count = 1;
-	gOptions.filename = NULL;
+	result = 0;
+	gAppName = argv[0];
+	sRoots.items = (char **)malloc(argc * sizeof(char *));
+	sIncludes.items = (char **)malloc(argc * sizeof(char *));
+	sExcludes.items = (char **)malloc(argc * sizeof(char *));
+	if (sRoots.items == NULL || sIncludes.items == NULL || sExcludes.items == NULL
+	 || initKeywords() != 0)
+	{
+		fprintf(stderr, "### error: unable to allocate memory (in %s)\n", argv[0]);
+		return (-108);
+	}
 	gOptions.boilerplate = NULL;
 	gOptions.onlyPrototypes = false;
+	gOptions.threads = 1;
+	gOptions.prefetch = 0;
+	gOptions.cache = NULL;
+	gOptions.noBackup = false;
+	gOptions.stats = NULL;
+	gOptions.maxMemory = 0;
+	gOptions.check = false;
+	gOptions.server = NULL;
+	gOptions.symbols = NULL;
 
 	/* Run through the arguments, pulling out just the options.
 	   While we're doing this, shuffle down any non-option args
@@ -133,11 +1881,89 @@ int main(int argc, char *argv[])
 				}
 				break;
 
+			case 'D':
+			case 'U':
+				/* accept both '-D NAME' and '-DNAME', as a compiler does */
+				option = argv[i][1];
+				macro = NULL;
+				if (argv[i][2] != '\0')
+					macro = &argv[i][2];
+				else if (++i < argc)
+					macro = argv[i];
+
+				if (macro != NULL)
+				{
+					addOption((option == 'D') ? "-D" : "-U", macro);
+					keyResult = (option == 'D') ? defineMacro(macro)
+												: undefineMacro(macro);
+					if (keyResult == -108)
+						result = -108;
+					else if (keyResult != 0 && option == 'D')
+					{
+						fprintf(stderr,
+							"### error: -D expects '<name>' or '<name>=<value>', "
+							"not '%s' (in %s)\n", macro, argv[0]);
+						result = -1;
+					}
+					else if (keyResult != 0)
+					{
+						fprintf(stderr,
+							"### error: -U expects the name of a macro, "
+							"not '%s' (in %s)\n", macro, argv[0]);
+						result = -1;
+					}
+					usageOnly = false;
+				}
+				break;
+
+			case 'j':
+				/* accept both '-j 8' and '-j8' */
+				if (argv[i][2] != '\0')
+					gOptions.threads = atoi(&argv[i][2]);
+				else if (++i < argc)
+					gOptions.threads = atoi(argv[i]);
+
+				if (gOptions.threads < 1 || gOptions.threads > qMaxThreads)
+				{
+					fprintf(stderr,
+						"### error: -j expects a count from 1 to %d (in %s)\n",
+						qMaxThreads, argv[0]);
+					gOptions.threads = 1;
+				}
+				usageOnly = false;
+				break;
+
+			case 'k':
+				if (++i < argc)
+				{
+					addOption("-k", argv[i]);
+					keyResult = addKeywords(argv[i]);
+					if (keyResult == -108)
+						result = -108;
+					else if (keyResult != 0)
+					{
+						fprintf(stderr,
+							"### error: -k expects '<kind>=<word>[,<word>...]', "
+							"like 'todo=XXX,HACK' (in %s)\n", argv[0]);
+						result = -1;
+					}
+					usageOnly = false;
+				}
+				break;
+
 			case 'p':
 				gOptions.onlyPrototypes = true;
 				usageOnly = false;
 				break;
 
+			case 'r':
+				if (++i < argc)
+				{
+					sRoots.items[sRoots.count++] = argv[i];
+					usageOnly = false;
+				}
+				break;
+
 			case '-': /* the 'wordy' varients */
 				if (strcmp(argv[i],"--version") == 0)
 				{
@@ -149,6 +1975,152 @@ int main(int argc, char *argv[])
 					printUsage(argv[0]);
 					break;
 				}
+				else if (strcmp(argv[i],"--no-backup") == 0)
+				{
+					gOptions.noBackup = true;
+					break;
+				}
+				else if (strcmp(argv[i],"--check") == 0)
+				{
+					gOptions.check = true;
+					usageOnly = false;
+					break;
+				}
+				else if (strcmp(argv[i],"--include") == 0)
+				{
+					if (++i < argc)
+						sIncludes.items[sIncludes.count++] = argv[i];
+					break;
+				}
+				else if (strcmp(argv[i],"--exclude") == 0)
+				{
+					if (++i < argc)
+						sExcludes.items[sExcludes.count++] = argv[i];
+					break;
+				}
+				else if (strcmp(argv[i],"--cache") == 0)
+				{
+					if (++i < argc)
+					{
+						gOptions.cache = argv[i];
+						usageOnly = false;
+					}
+					break;
+				}
+				else if (strcmp(argv[i],"--prefetch") == 0)
+				{
+					if (++i < argc)
+					{
+						gOptions.prefetch = atoi(argv[i]);
+						if (gOptions.prefetch < 1
+						 || gOptions.prefetch > qMaxPrefetch)
+						{
+							fprintf(stderr,
+								"### error: --prefetch expects a count from "
+								"1 to %d (in %s)\n", qMaxPrefetch, argv[0]);
+							gOptions.prefetch = 0;
+							result = -1;
+						}
+						usageOnly = false;
+					}
+					break;
+				}
+				else if (strcmp(argv[i],"--lines") == 0)
+				{
+					if (++i < argc)
+					{
+						switch (addLines(argv[i]))
+						{
+						case 0:
+							break;
+						case -108:
+							fprintf(stderr,
+								"### error: unable to allocate memory (in %s)\n",
+								argv[0]);
+							result = -108;
+							break;
+						default:
+							fprintf(stderr,
+								"### error: --lines expects ranges of lines, "
+								"like '12-30,45' (in %s)\n",
+								argv[0]);
+							result = -1;
+							break;
+						}
+						usageOnly = false;
+					}
+					break;
+				}
+				else if (strcmp(argv[i],"--keywords") == 0)
+				{
+					if (++i < argc)
+					{
+						addOptionFile("--keywords", argv[i]);
+						keyResult = loadKeywords(argv[i], &line);
+						if (keyResult == -1)
+						{
+							fprintf(stderr,
+								"### error: can't understand line %ld of '%s' (in %s)\n",
+								line, argv[i], argv[0]);
+							result = -1;
+						}
+						else if (keyResult == -43)
+						{
+							fprintf(stderr,
+								"### error: unable to open '%s' (in %s)\n",
+								argv[i], argv[0]);
+							result = -43;
+						}
+						else if (keyResult != 0)
+							result = keyResult;
+						usageOnly = false;
+					}
+					break;
+				}
+				else if (strcmp(argv[i],"--max-memory") == 0)
+				{
+					if (++i < argc)
+					{
+						gOptions.maxMemory = parseSize(argv[i]);
+						if (gOptions.maxMemory < qMinMemory)
+						{
+							fprintf(stderr,
+								"### error: --max-memory expects a size of at "
+								"least %dk, like '64M' (in %s)\n",
+								qMinMemory / 1024, argv[0]);
+							result = -1;
+						}
+						usageOnly = false;
+					}
+					break;
+				}
+				else if (strcmp(argv[i],"--server") == 0)
+				{
+					if (++i < argc)
+					{
+						gOptions.server = argv[i];
+						usageOnly = false;
+					}
+					break;
+				}
+				else if (strcmp(argv[i],"--symbols") == 0)
+				{
+					if (++i < argc)
+					{
+						gOptions.symbols = argv[i];
+						usageOnly = false;
+					}
+					break;
+				}
+				else if (strcmp(argv[i],"--stats") == 0)
+				{
+					if (++i < argc)
+					{
+						gOptions.stats = argv[i];
+						usageOnly = false;
+					}
+					break;
+				}
 				/* fall through if there's no match */
 			default:
 				fprintf(stderr,
@@ -168,88 +2140,302 @@ int main(int argc, char *argv[])
 	
 	/* argv[1] through argv[count] now contains only filenames */
 	
-	result = 0;
+	/* don't go on to do something other than what was asked */
+	if (result != 0)
+		usageOnly = true;
+
+	if (sLineCount > 0)
+	{
+		/* the rest of the file wouldn't be -p output */
+		if (gOptions.onlyPrototypes)
+		{
+			fprintf(stderr,
+					"### error: --lines can't be used with -p (in %s)\n",
+					argv[0]);
+			usageOnly = true;
+			result = -1;
+		}
+
+		/* it needs the whole file in memory */
+		if (gOptions.maxMemory != 0)
+		{
+			fprintf(stderr,
+					"### error: --lines can't be used with --max-memory (in %s)\n",
+					argv[0]);
+			usageOnly = true;
+			result = -1;
+		}
+
+		if (gOptions.check)
+		{
+			fprintf(stderr,
+					"### error: --lines can't be used with --check (in %s)\n",
+					argv[0]);
+			usageOnly = true;
+			result = -1;
+		}
+		sortLines();
+	}
+
+	if (gOptions.server != NULL)
+	{
+		/* the requests say what to process, and how */
+		if (count > 1 || sRoots.count > 0 || sLineCount > 0 || gOptions.check)
+		{
+			fprintf(stderr,
+					"### error: --server can't be used with files, -r, "
+					"--lines or --check (in %s)\n",
+					argv[0]);
+			usageOnly = true;
+			result = -1;
+		}
+	}
+
+	if (gOptions.symbols != NULL)
+	{
+		/* none of these parse every function */
+		if (sLineCount > 0 || gOptions.check || gOptions.server != NULL
+		 || gOptions.cache != NULL)
+		{
+			fprintf(stderr,
+					"### error: --symbols can't be used with --lines, "
+					"--check, --server or --cache (in %s)\n",
+					argv[0]);
+			usageOnly = true;
+			result = -1;
+		}
+		else if (strcmp(gOptions.symbols, "-") == 0)
+			sSymbolFile = stdout;
+		else if ((sSymbolFile = fopen(gOptions.symbols, "w")) == NULL)
+		{
+			fprintf(stderr,
+					"### error: unable to open '%s' for writing (in %s)\n",
+					gOptions.symbols, argv[0]);
+			usageOnly = true;
+			result = -43;
+		}
+	}
+
+	/* read the boilerplate now, rather than for every file */
+	if (!usageOnly && gOptions.boilerplate != NULL)
+	{
+		result = loadBoilerplate(gOptions.boilerplate);
+		if (result != 0)
+		{
+			fprintf(stderr,
+					"### error: unable to read the boilerplate file '%s' (in %s)\n",
+					gOptions.boilerplate, argv[0]);
+			usageOnly = true;
+			result = -1;
+		}
+	}
 
 	if (!usageOnly)
 	{
-		if (count <= 1) /* one is really zero, since it started at 1 */
+		if (gOptions.stats != NULL)
+			initStats();
+
+		if (gOptions.server != NULL)
+		{
+			if (strcmp(gOptions.server, "-") == 0)
+			{
+				result = serveStream(stdin, stdout, serveRequest);
+				if (result == -36)
+					fprintf(stderr,
+							"### error: unable to read a request from stdin (in %s)\n",
+							argv[0]);
+				else if (result == -20)
+					fprintf(stderr,
+							"### error: unable to write a reply to stdout (in %s)\n",
+							argv[0]);
+			}
+			else
+			{
+				result = serveSocket(gOptions.server, serveRequest);
+				if (result == -1)
+					fprintf(stderr,
+							"### error: unable to listen on '%s' (in %s)\n",
+							gOptions.server, argv[0]);
+			}
+			if (result == -108)
+				fprintf(stderr,
+						"### error: unable to allocate memory (in %s)\n",
+						argv[0]);
+
+			while (sIdleCount > 0)
+				freeWorkspace(sIdle[--sIdleCount]);
+		}
+		else if (count <= 1 && sRoots.count == 0) /* one is really zero, since it started at 1 */
 		{
 			/* assume stdin to stdout */
-			gOptions.filename = NULL;
-			result = processFile(stdout, stdin);
+			if (sLineCount > 0)
+				result = changeStream(stdout, stdin);
+			else
+			{
+				memset(&counts, 0, sizeof(counts));
+				result = (sSymbolFile != NULL) ? initSink(&symbols, sSymbolFile) : 0;
+				if (result == 0)
+					result = processFile(stdout, stdin, NULL,
+										 (sSymbolFile != NULL) ? &symbols : NULL,
+										 &counts);
+				if (sSymbolFile != NULL)
+				{
+					if (flushSink(&symbols) != 0 && result == 0)
+						result = -20;
+					freeSink(&symbols);
+				}
+				if (gOptions.stats != NULL)
+					addCounts(&counts);
+				if (result == 0 && counts.overflows > 0)
+					fprintf(stderr,
+							"### warning: part of '<stdin>' was too big for "
+							"%s, so it was passed through unchanged (in %s)\n",
+							gOptions.maxMemory != 0 ? "--max-memory" : "memory",
+							argv[0]);
+			}
+			reportResult(NULL, "<stdin>", result);
+
+			if (result == 0 && gOptions.check)
+			{
+				printf("<stdin>: %lu of %lu functions need a comment\n",
+					   (unsigned long)counts.missing,
+					   (unsigned long)(counts.missing + counts.documented));
+				if (counts.missing > 0)
+					result = 1;
+			}
 		}
-		else for (i = 1; i < count; ++i)
+		else
 		{
-			gOptions.filename = filenameFromPath(argv[i]);
-			
-			tmpname = NULL;
+			/* never start more workers than there are files (but
+				a big file may still be split between all of them) */
+			workers = gOptions.threads;
+			if (sRoots.count == 0 && workers > count - 1)
+				workers = count - 1;
+
+			queue = NULL;
+			if (gOptions.check)
+				queue = createJobQueue(workers, checkFile,
+									   gOptions.prefetch, readAhead);
+			else if (gOptions.cache == NULL)
+				queue = createJobQueue(workers, convertFile,
+									   gOptions.prefetch, readAhead);
+			else
+			{
+				addOption("version", qVersion);
+				addOption("-p", gOptions.onlyPrototypes ? "on" : "off");
+				if (gOptions.boilerplate != NULL)
+					addOptionFile("-b", gOptions.boilerplate);
+				sprintf(size, "%lu", gOptions.maxMemory);
+				addOption("--max-memory", size);
 
-			inFile = fopen(argv[i],"r");
-			if (inFile == NULL)
+				sCache = loadCache(gOptions.cache, sOptions);
+				if (sCache != NULL)
+					queue = createJobQueue(workers, convertFile,
+										   gOptions.prefetch, readAhead);
+			}
+			if (queue == NULL)
 			{
 				fprintf(stderr,
-						"### error: unable to open '%s' for reading (in %s)\n",
-						argv[i], argv[0]);
-				result = -1;
+						"### error: unable to allocate memory (in %s)\n",
+						argv[0]);
+				result = -108;
 			}
 			else
 			{
-				tmpname = cpycat(argv[i],".tmp");
-				if (tmpname != NULL)
+				for (i = 1; i < count; ++i)
 				{
-					outFile = fopen(tmpname,"w");
-					if (outFile == NULL)
+					if (addJob(queue, argv[i]) != 0)
 					{
 						fprintf(stderr,
-								"### error: unable to open '%s' for writing (in %s)\n",
-								tmpname, argv[0]);
-						result = -2;
+								"### error: unable to allocate memory (in %s)\n",
+								argv[0]);
+						break;
 					}
-					else
-					{
-						/* this performs the actual processing */
-						result = processFile(outFile, inFile);
+				}
 
-						fclose(outFile);
-					}
-					/* don't free tmpname yet; need it below */
+				result = (i < count) ? -108 : 0;
+
+				/* the workers get started on the files as they're found */
+				walk.queue = queue;
+				walk.failed = false;
+				for (i = 0; i < sRoots.count && result == 0; ++i)
+				{
+					walk.rootLength = strlen(sRoots.items[i]);
+					result = walkTree(sRoots.items[i], visitPath, &walk);
+					if (result == -43)
+						fprintf(stderr,
+								"### error: unable to read '%s' (in %s)\n",
+								sRoots.items[i], argv[0]);
+					else if (result != 0)
+						fprintf(stderr,
+								"### error: unable to allocate memory (in %s)\n",
+								argv[0]);
+				}
+
+				i = result;
+				result = finishJobs(queue);
+				if (i != 0)
+					result = i;
+				else if (walk.failed && result == 0)
+					result = -1;
+
+				if (gOptions.check)
+				{
+					printf("%lu of %lu functions need a comment, in %d of %d files\n",
+						   (unsigned long)sChecked.missing,
+						   (unsigned long)sChecked.functions,
+						   sChecked.failed, sChecked.files);
+					if (result == 0 && sChecked.missing > 0)
+						result = 1;
 				}
-				fclose(inFile);
 			}
-			/* only rename the files if everything went smoothly */
-			if (tmpname != NULL)
+
+			if (sCache != NULL)
 			{
-				if (result == 0)
+				if (saveCache(sCache) != 0)
 				{
-					bakname = cpycat(argv[i],".bak");
-					if (bakname != NULL)
-					{
-						result = rename(argv[i], bakname);
-						if (result != 0)
-						{
-							fprintf(stderr,
-									"### error: unable to rename '%s' to '%s' (in %s)\n",
-									argv[i], bakname, argv[0]);
-							result = -3;
-						}
-						else
-						{
-							result = rename(tmpname, argv[i]);
-							if (result != 0)
-							{
-								fprintf(stderr,
-										"### error: unable to rename '%s' to '%s' (in %s)\n",
-										tmpname, argv[i], argv[0]);
-								result = -4;
-							}
-						}
-						free(bakname);
-					}
+					fprintf(stderr,
+							"### error: unable to write the cache '%s' (in %s)\n",
+							gOptions.cache, argv[0]);
+					if (result == 0)
+						result = -2;
 				}
-				free(tmpname);
+				freeCache(sCache);
 			}
+
+			while (sIdleCount > 0)
+				freeWorkspace(sIdle[--sIdleCount]);
+		}
+
+		if (sSymbolFile != NULL
+		 && (fflush(sSymbolFile) != 0 || ferror(sSymbolFile)
+		  || (sSymbolFile != stdout && fclose(sSymbolFile) != 0)))
+		{
+			fprintf(stderr,
+					"### error: unable to write the symbols to '%s' (in %s)\n",
+					gOptions.symbols, argv[0]);
+			if (result == 0)
+				result = -2;
+		}
+
+		if (gOptions.stats != NULL && writeStats(gOptions.stats) != 0)
+		{
+			fprintf(stderr,
+					"### error: unable to write the statistics to '%s' (in %s)\n",
+					gOptions.stats, argv[0]);
+			if (result == 0)
+				result = -2;
 		}
 	}
 
+	freeBoilerplate();
+	freeKeywords();
+	freeMacros();
+	forgetTypes();
+	free(sRoots.items);
+	free(sIncludes.items);
+	free(sExcludes.items);
+	free(sLines);
+
 	return result;
 }
@@ -0,0 +1,583 @@
+/**
+	@file jobutils.c
+
+	A queue of files to process, and a pool of worker threads
+	to process them.
+
+	Each worker runs the handler on one job at a time. Anything
+	a handler wants to report goes into its job's messages (or its
+	output, for stdout), which are written out strictly in the
+	order the jobs were added, so the output looks just like a run
+	that processed the files one after another. For the same
+	reason, the overall result is the result of the last job.
+	Finished jobs are taken off the queue with the lock held, but
+	written out after it's released, so a slow pipe on stdout or
+	stderr doesn't hold up the workers.
+
+	With a single thread (or without pthreads), jobs are processed
+	by the caller as they are added.
+
+	Optionally, a reader thread runs ahead of the workers, reading
+	the files of the jobs they haven't got to yet into memory (see
+	--prefetch), so a worker rarely has to wait for a slow disk or
+	network file system. It never gets more than a set number of
+	jobs ahead, and it leaves alone any job a worker has already
+	taken, so a worker that catches up simply reads its own file.
+
+	@version 0.92
+	@author Paul Chambers
+	@date 2005-2006
+*/
+/* $Header$ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "common.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "fileutils.h"
+#include "jobutils.h"
+
+#ifdef qHaveThreads
+#include <pthread.h>
+#endif
+
+/**
+	the state shared by the producer and the workers.
+*/
+struct tJobQueue
+{
+	tJobHandler	handler;	/**< processes each job */
+	tJob	*head;			/**< oldest job not yet reported */
+	tJob	*tail;			/**< most recently added job */
+	tJob	*pending;		/**< next job to hand to a worker */
+	tJobHandler	reader;		/**< reads a job's file ahead of the workers
+								 (NULL if nothing is read ahead) */
+	tJob	*unread;		/**< next job for the reader to read */
+	int		ahead;			/**< the most jobs that may be read ahead */
+	int		fetched;		/**< jobs read ahead, not yet taken by a worker */
+	bool	closed;			/**< no more jobs will be added */
+	int		result;			/**< result of the last job reported */
+	int		threads;		/**< number of worker threads running */
+#ifdef qHaveThreads
+	pthread_mutex_t	lock;	/**< protects everything above */
+	pthread_cond_t	ready;	/**< signalled when a job is added, or on close */
+	pthread_cond_t	done;	/**< signalled when a job is finished */
+	pthread_cond_t	wanted;	/**< signalled when the reader may carry on */
+	pthread_cond_t	read;	/**< signalled when a job has been read ahead */
+	pthread_t	*workers;	/**< the worker threads */
+	pthread_t	readerThread;	/**< the reader thread (if reader isn't NULL) */
+#endif
+};
+
+static void reportJob(tJobQueue *queue, tJob *job);
+#ifdef qHaveThreads
+static tJob *takeFinished(tJobQueue *queue);
+static void reportJobs(tJobQueue *queue, tJob *jobs);
+#endif
+static void destroyJobQueue(tJobQueue *queue);
+#ifdef qHaveThreads
+static void *workerMain(void *arg);
+static void *readerMain(void *arg);
+#endif
+
+/*
+	private functions
+*/
+
+/**
+	@internal
+
+	Writes out a finished job's output and messages, records
+	its result and frees it.
+
+	@param[in,out] 	queue 	the queue the job came from
+	@param[in] 		job 	the finished job
+*/
+static void reportJob(tJobQueue *queue, tJob *job)
+{
+	if (job->outLength > 0)
+		fwrite(job->output, sizeof(char), job->outLength, stdout);
+	if (job->msgLength > 0)
+		fwrite(job->messages, sizeof(char), job->msgLength, stderr);
+
+	queue->result = job->result;
+
+	freeSource(&job->input);
+	free(job->output);
+	free(job->messages);
+	free(job->path);
+	free(job);
+}
+
+#ifdef qHaveThreads
+/**
+	@internal
+
+	Takes the jobs at the head of the queue that have finished
+	off it, up to the first one that hasn't. Call it with the
+	queue locked.
+
+	@param[in,out] 	queue 	the queue to take them from
+
+	@return the finished jobs, in order (NULL if there are none)
+*/
+static tJob *takeFinished(tJobQueue *queue)
+{
+	tJob	*first, *last;
+
+	first = queue->head;
+	last = NULL;
+	while (queue->head != NULL && queue->head->done)
+	{
+		last = queue->head;
+		queue->head = last->next;
+	}
+	if (last == NULL)
+		return NULL;
+
+	last->next = NULL;
+	if (queue->head == NULL)
+		queue->tail = NULL;
+
+	return first;
+}
+
+/**
+	@internal
+
+	Reports a list of jobs from takeFinished(). Call it with
+	the queue unlocked.
+
+	@param[in,out] 	queue 	the queue the jobs came from
+	@param[in] 		jobs 	the finished jobs
+*/
+static void reportJobs(tJobQueue *queue, tJob *jobs)
+{
+	tJob	*next;
+
+	while (jobs != NULL)
+	{
+		next = jobs->next;
+		reportJob(queue, jobs);
+		jobs = next;
+	}
+}
+#endif
+
+/**
+	@internal
+
+	Releases a tJobQueue. Any workers must already have exited.
+
+	@param[in] 	queue 	the queue to free
+*/
+static void destroyJobQueue(tJobQueue *queue)
+{
+#ifdef qHaveThreads
+	if (queue->workers != NULL)
+	{
+		pthread_cond_destroy(&queue->read);
+		pthread_cond_destroy(&queue->wanted);
+		pthread_cond_destroy(&queue->done);
+		pthread_cond_destroy(&queue->ready);
+		pthread_mutex_destroy(&queue->lock);
+		free(queue->workers);
+	}
+#endif
+	free(queue);
+}
+
+#ifdef qHaveThreads
+/**
+	@internal
+
+	The body of each worker thread.
+
+	Takes jobs from the queue in order, until the queue
+	is closed and there's nothing left to do.
+
+	@param[in,out] 	arg 	the tJobQueue
+
+	@return always NULL
+*/
+static void *workerMain(void *arg)
+{
+	tJobQueue	*queue = (tJobQueue *)arg;
+	tJob		*job;
+
+	pthread_mutex_lock(&queue->lock);
+	for (;;)
+	{
+		while (queue->pending == NULL && !queue->closed)
+			pthread_cond_wait(&queue->ready, &queue->lock);
+
+		job = queue->pending;
+		if (job == NULL)
+			break;
+		queue->pending = job->next;
+
+		if (queue->reader != NULL)
+		{
+			if (queue->unread == job)
+				queue->unread = job->next;	/* got to it first */
+			else
+			{
+				/* it's been read ahead, or it's being read now */
+				while (job->fetching)
+					pthread_cond_wait(&queue->read, &queue->lock);
+				--queue->fetched;
+				pthread_cond_signal(&queue->wanted);
+			}
+		}
+
+		pthread_mutex_unlock(&queue->lock);
+		job->result = queue->handler(job);
+		pthread_mutex_lock(&queue->lock);
+
+		job->done = true;
+		pthread_cond_broadcast(&queue->done);
+	}
+	pthread_mutex_unlock(&queue->lock);
+
+	return NULL;
+}
+
+/**
+	@internal
+
+	The body of the reader thread.
+
+	Reads the files of the jobs that haven't been taken by a
+	worker yet, in order, keeping no more than queue->ahead
+	of them in memory, until the queue is closed and every
+	job has been taken or read.
+
+	@param[in,out] 	arg 	the tJobQueue
+
+	@return always NULL
+*/
+static void *readerMain(void *arg)
+{
+	tJobQueue	*queue = (tJobQueue *)arg;
+	tJob		*job;
+
+	pthread_mutex_lock(&queue->lock);
+	for (;;)
+	{
+		while ((queue->unread == NULL || queue->fetched >= queue->ahead)
+			&& !(queue->closed && queue->unread == NULL))
+		{
+			pthread_cond_wait(&queue->wanted, &queue->lock);
+		}
+
+		job = queue->unread;
+		if (job == NULL)
+			break;
+		queue->unread = job->next;
+		++queue->fetched;
+		job->fetching = true;
+
+		pthread_mutex_unlock(&queue->lock);
+		queue->reader(job);
+		pthread_mutex_lock(&queue->lock);
+
+		job->fetching = false;
+		pthread_cond_broadcast(&queue->read);
+	}
+	pthread_mutex_unlock(&queue->lock);
+
+	return NULL;
+}
+#endif
+
+/*
+	public functions
+*/
+
+/**
+	Records an error message against a job.
+
+	The message isn't written out until the job is reported,
+	so messages come out in file order even when the files
+	are processed in parallel.
+
+	@param[in,out] 	job 	the job the message applies to
+	@param[in] 		format 	printf-style format string
+*/
+void jobError(tJob *job, const char *format, ...)
+{
+	va_list	args;
+	char	*messages;
+	size_t	size;
+	int		len;
+
+	va_start(args, format);
+	len = vsnprintf(NULL, 0, format, args);
+	va_end(args);
+
+	if (len > 0)
+	{
+		size = job->msgLength + len + 1;
+		if (size > job->msgSize)
+		{
+			if (size < 2 * job->msgSize)
+				size = 2 * job->msgSize;
+			messages = (char *)realloc(job->messages, size);
+			if (messages == NULL)
+				return;
+			job->messages = messages;
+			job->msgSize = size;
+		}
+
+		va_start(args, format);
+		vsnprintf(&job->messages[job->msgLength], len + 1, format, args);
+		va_end(args);
+
+		job->msgLength += len;
+	}
+}
+
+/**
+	Adds to what a job writes to stdout. Like the messages,
+	it's held until the job is reported.
+
+	@param[in,out] 	job 	the job the output belongs to
+	@param[in] 		data 	the characters to add
+	@param[in] 		length 	the number of characters
+
+	@return int
+	@retval 0		all is well
+	@retval -108	unable to allocate memory
+*/
+int jobOutput(tJob *job, const char *data, size_t length)
+{
+	char	*output;
+
+	if (length > 0)
+	{
+		output = (char *)realloc(job->output, job->outLength + length);
+		if (output == NULL)
+			return (-108);
+		memcpy(&output[job->outLength], data, length);
+		job->output = output;
+		job->outLength += length;
+	}
+
+	return 0;
+}
+
+/**
+	Creates a queue, and starts its workers.
+
+	If ahead isn't 0, a reader thread is started as well, which
+	calls reader for up to that many of the jobs the workers
+	haven't got to yet. It may set the job's input, stamp and
+	fetched, for the handler to use rather than reading the file
+	itself. Its result is ignored, so anything that goes wrong
+	should be left for the handler to find and report. A worker
+	is started for the reader to run ahead of, even for a single
+	thread.
+
+	If the threads can't be started, the queue quietly
+	falls back to processing the jobs one at a time.
+
+	@param[in] 	threads 	how many files to process at once
+	@param[in] 	handler 	called to process each job
+	@param[in] 	ahead 		how many files may be read ahead
+	@param[in] 	reader 		called to read a job's file ahead of
+							its handler
+
+	@return the new tJobQueue
+	@retval NULL	unable to allocate memory
+*/
+tJobQueue *createJobQueue(int threads, tJobHandler handler,
+						  int ahead, tJobHandler reader)
+{
+	tJobQueue	*queue;
+
+	queue = (tJobQueue *)malloc(sizeof(tJobQueue));
+	if (queue == NULL)
+		return NULL;
+
+	queue->handler = handler;
+	queue->head = NULL;
+	queue->tail = NULL;
+	queue->pending = NULL;
+	queue->reader = NULL;
+	queue->unread = NULL;
+	queue->ahead = ahead;
+	queue->fetched = 0;
+	queue->closed = false;
+	queue->result = 0;
+	queue->threads = 0;
+
+#ifdef qHaveThreads
+	queue->workers = NULL;
+	if (threads > 1 || (threads == 1 && ahead > 0))
+	{
+		queue->workers = (pthread_t *)malloc(threads * sizeof(pthread_t));
+		if (queue->workers != NULL)
+		{
+			pthread_mutex_init(&queue->lock, NULL);
+			pthread_cond_init(&queue->ready, NULL);
+			pthread_cond_init(&queue->done, NULL);
+			pthread_cond_init(&queue->wanted, NULL);
+			pthread_cond_init(&queue->read, NULL);
+
+			while (queue->threads < threads
+				&& pthread_create(&queue->workers[queue->threads], NULL,
+								  workerMain, queue) == 0)
+			{
+				++queue->threads;
+			}
+
+			if (queue->threads > 0 && ahead > 0
+			 && pthread_create(&queue->readerThread, NULL,
+							   readerMain, queue) == 0)
+			{
+				queue->reader = reader;
+			}
+		}
+	}
+#else
+	(void)threads;
+	(void)reader;
+#endif
+
+	return queue;
+}
+
+/**
+	Adds a file to the end of a queue.
+
+	Also reports any jobs at the front of the queue that have
+	finished, so messages appear while the queue is still being
+	filled.
+
+	@param[in,out] 	queue 	the queue to add to
+	@param[in] 		path 	the file to process (copied)
+
+	@return int
+	@retval 0		the job was queued
+	@retval -108	unable to allocate memory
+*/
+int addJob(tJobQueue *queue, const char *path)
+{
+	tJob	*job;
+
+	job = (tJob *)malloc(sizeof(tJob));
+	if (job == NULL)
+		return (-108);
+
+	job->path = (char *)malloc(strlen(path) + 1);
+	if (job->path == NULL)
+	{
+		free(job);
+		return (-108);
+	}
+	strcpy(job->path, path);
+
+	job->next = NULL;
+	job->result = 0;
+	job->done = false;
+	job->messages = NULL;
+	job->msgLength = 0;
+	job->msgSize = 0;
+	job->output = NULL;
+	job->outLength = 0;
+	initSource(&job->input);
+	job->fetched = false;
+	job->fetching = false;
+
+	if (queue->threads == 0)
+	{
+		/* no workers, so do it now */
+		job->result = queue->handler(job);
+		reportJob(queue, job);
+	}
+#ifdef qHaveThreads
+	else
+	{
+		pthread_mutex_lock(&queue->lock);
+
+		if (queue->tail != NULL)
+			queue->tail->next = job;
+		else
+			queue->head = job;
+		queue->tail = job;
+		if (queue->pending == NULL)
+			queue->pending = job;
+		pthread_cond_signal(&queue->ready);
+		if (queue->unread == NULL && queue->reader != NULL)
+		{
+			queue->unread = job;
+			pthread_cond_signal(&queue->wanted);
+		}
+
+		/* report whatever has finished already */
+		job = takeFinished(queue);
+
+		pthread_mutex_unlock(&queue->lock);
+
+		reportJobs(queue, job);
+	}
+#endif
+
+	return 0;
+}
+
+/**
+	Waits for every job in a queue to finish, reports them,
+	and frees the queue.
+
+	@param[in] 	queue 	the queue to finish
+
+	@return the result of the last job added (0 if there were none)
+*/
+int finishJobs(tJobQueue *queue)
+{
+	tJob	*job;
+	int		result;
+#ifdef qHaveThreads
+	int		i;
+
+	if (queue->threads > 0)
+	{
+		pthread_mutex_lock(&queue->lock);
+
+		queue->closed = true;
+		pthread_cond_broadcast(&queue->ready);
+		pthread_cond_signal(&queue->wanted);
+
+		while (queue->head != NULL)
+		{
+			while (!queue->head->done)
+				pthread_cond_wait(&queue->done, &queue->lock);
+
+			job = takeFinished(queue);
+			pthread_mutex_unlock(&queue->lock);
+			reportJobs(queue, job);
+			pthread_mutex_lock(&queue->lock);
+		}
+
+		pthread_mutex_unlock(&queue->lock);
+
+		for (i = 0; i < queue->threads; ++i)
+			pthread_join(queue->workers[i], NULL);
+		if (queue->reader != NULL)
+			pthread_join(queue->readerThread, NULL);
+	}
+#else
+	(void)job;
+#endif
+
+	result = queue->result;
+	destroyJobQueue(queue);
+
+	return result;
+}
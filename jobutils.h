@@ -0,0 +1,61 @@
+/**
+	@file jobutils.h
+
+	Public interface for jobutils.c
+
+	@version 0.92
+	@author Paul Chambers
+	@date 2005-2006
+*/
+/* $Header$ */
+
+/**
+	the most worker threads that may be requested with -j
+*/
+#define qMaxThreads	256
+
+/**
+	the most files that may be read ahead of the workers
+	with --prefetch
+*/
+#define qMaxPrefetch	256
+
+/**
+	one file to be processed.
+
+	Jobs are handed to the workers in the order they were added,
+	and reported in that same order, regardless of the order in
+	which the workers finish them.
+*/
+typedef struct tJob
+{
+	struct tJob	*next;		/**< the next job in the queue */
+	char	*path;			/**< path of the file to process */
+	int		result;			/**< the result returned by the handler */
+	bool	done;			/**< set once the handler has returned */
+	char	*messages;		/**< error messages, held until the job is reported */
+	size_t	msgLength;		/**< number of characters in messages */
+	size_t	msgSize;		/**< space allocated to messages */
+	char	*output;		/**< output for stdout, held until the job is reported */
+	size_t	outLength;		/**< number of characters in output */
+	tSource	input;			/**< the file's contents, if it was read ahead */
+	tFileStamp	stamp;		/**< the version of the file that was read ahead */
+	bool	fetched;		/**< set if input and stamp are valid */
+	bool	fetching;		/**< set while the job is being read ahead */
+} tJob;
+
+/**
+	called (possibly from a worker thread) to process one job,
+	or to read its file ahead of that
+*/
+typedef int (*tJobHandler)(tJob *job);
+
+typedef struct tJobQueue tJobQueue;
+
+void jobError(tJob *job, const char *format, ...);
+int jobOutput(tJob *job, const char *data, size_t length);
+
+tJobQueue *createJobQueue(int threads, tJobHandler handler,
+						  int ahead, tJobHandler reader);
+int addJob(tJobQueue *queue, const char *path);
+int finishJobs(tJobQueue *queue);
@@ -0,0 +1,484 @@
+/**
+	@file keywordutils.c
+
+	Recognizes the words the parser looks for: the markers that start
+	a comment worth remembering (like 'todo' or 'note'), and keywords
+	in the code (like 'return' or 'static').
+
+	Each set of words is held in a trie, so finding a word costs the
+	same however many there are - one step per character. The words
+	that are always known are listed in sBuiltIn; more can be added
+	with -k or from a file (see addKeywords()).
+
+	A word is only recognized as a whole word - 'notes' isn't 'note'.
+
+	The tries are only changed before any files are processed, after
+	which they're shared, unchanged, by all of the worker threads.
+
+	@version 0.92
+	@author Paul Chambers
+	@date 2005-2006
+*/
+/* $Header$ */
+
+#include "common.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "keywordutils.h"
+
+/** the number of different characters a keyword may contain */
+#define qAlphabet	64
+
+/** the number of nodes a trie starts with */
+#define qTrieNodes	64
+
+/** true if the character can be part of an identifier */
+#define qIsWordChar(c)	(isalnum((byte)(c)) || (c) == '_')
+
+/**
+	one node of a trie, reached by following a keyword's
+	characters from the root (node 0).
+*/
+typedef struct {
+	unsigned short	next[qAlphabet];	/**< the node for each following character
+											 (0 if no keyword continues that way) */
+	byte	kind;						/**< if a keyword ends here, what it means */
+} tTrieNode;
+
+/**
+	a set of keywords.
+*/
+typedef struct {
+	tTrieNode	*nodes;		/**< the nodes, the first of which is the root */
+	size_t		count;		/**< the number of nodes in use */
+	size_t		size;		/**< the number of nodes allocated */
+	bool		folded;		/**< case is ignored */
+} tTrie;
+
+/**
+	the position of each character that may be part of a keyword
+	in the alphabet, counting from 1 (0 for the rest).
+*/
+static const byte sSymbol[256] = {
+	['a'] = 1,	['b'] = 2,	['c'] = 3,	['d'] = 4,	['e'] = 5,	['f'] = 6,
+	['g'] = 7,	['h'] = 8,	['i'] = 9,	['j'] = 10,	['k'] = 11,	['l'] = 12,
+	['m'] = 13,	['n'] = 14,	['o'] = 15,	['p'] = 16,	['q'] = 17,	['r'] = 18,
+	['s'] = 19,	['t'] = 20,	['u'] = 21,	['v'] = 22,	['w'] = 23,	['x'] = 24,
+	['y'] = 25,	['z'] = 26,	['A'] = 27,	['B'] = 28,	['C'] = 29,	['D'] = 30,
+	['E'] = 31,	['F'] = 32,	['G'] = 33,	['H'] = 34,	['I'] = 35,	['J'] = 36,
+	['K'] = 37,	['L'] = 38,	['M'] = 39,	['N'] = 40,	['O'] = 41,	['P'] = 42,
+	['Q'] = 43,	['R'] = 44,	['S'] = 45,	['T'] = 46,	['U'] = 47,	['V'] = 48,
+	['W'] = 49,	['X'] = 50,	['Y'] = 51,	['Z'] = 52,	['0'] = 53,	['1'] = 54,
+	['2'] = 55,	['3'] = 56,	['4'] = 57,	['5'] = 58,	['6'] = 59,	['7'] = 60,
+	['8'] = 61,	['9'] = 62,	['_'] = 63,	['-'] = 64
+};
+
+/**
+	the keywords that are always known.
+*/
+static const struct {
+	int			kind;		/**< what it means */
+	const char	*word;		/**< the keyword */
+} sBuiltIn[] = {
+	{ qKeyTodo,			"todo" },
+	{ qKeyTodo,			"fixme" },
+	{ qKeyTodo,			"fix-me" },
+	{ qKeyTodo,			"xxx" },
+	{ qKeyTodo,			"hack" },
+	{ qKeyTodo,			"bug" },
+	{ qKeyNote,			"note" },
+	{ qKeyNote,			"nb" },
+	{ qKeyReturn,		"return" },
+	{ qKeyStatic,		"static" },
+	{ qKeyConst,		"const" },
+	{ qKeyQualifier,	"volatile" },
+	{ qKeyIgnored,		"inline" },
+	{ qKeyIgnored,		"extern" },
+	{ qKeyIgnored,		"restrict" },
+	{ qKeyIgnored,		"virtual" },
+	{ qKeyIgnored,		"explicit" },
+	{ qKeyIgnored,		"friend" },
+	{ qKeyIgnored,		"constexpr" },
+	{ qKeyIgnored,		"typename" },
+	{ qKeyScope,		"namespace" },
+	{ qKeyScope,		"class" },
+	{ qKeyScope,		"struct" },
+	{ qKeyScope,		"union" },
+	{ qKeyAccess,		"public" },
+	{ qKeyAccess,		"protected" },
+	{ qKeyAccess,		"private" },
+	{ qKeyTemplate,		"template" },
+	{ qKeyOperator,		"operator" },
+	{ qKeyTrailing,		"noexcept" },
+	{ qKeyTrailing,		"throw" }
+};
+
+/** the name of each kind of keyword, as used by addKeywords() */
+static const char *sKindNames[qKeyKinds] = {
+	NULL, "todo", "note", "return", "static", "const", "qualifier", "ignore",
+	"scope", "access", "template", "operator", "trailing"
+};
+
+static tTrie sMarkers;		/**< the words that start a comment */
+static tTrie sKeywords;		/**< the words in the code */
+
+static int initTrie(tTrie *trie, bool folded);
+static void freeTrie(tTrie *trie);
+static int matchTrie(const tTrie *trie, const char *ptr, const char *end,
+					 size_t *length);
+static int addWords(int kind, const char *words);
+
+/*
+	private functions
+*/
+
+/**
+	@internal
+
+	Empties a trie, leaving only its root.
+
+	@param[out] 	trie 	the trie to empty
+	@param[in] 		folded 	if case is to be ignored
+
+	@return int
+	@retval 0		all is well
+	@retval -108	unable to allocate memory
+*/
+static int initTrie(tTrie *trie, bool folded)
+{
+	if (trie->nodes == NULL)
+	{
+		trie->nodes = (tTrieNode *)malloc(qTrieNodes * sizeof(tTrieNode));
+		if (trie->nodes == NULL)
+			return (-108);
+		trie->size = qTrieNodes;
+	}
+	memset(&trie->nodes[0], 0, sizeof(tTrieNode));
+	trie->count = 1;
+	trie->folded = folded;
+
+	return 0;
+}
+
+/**
+	@internal
+
+	Releases the storage used by a trie.
+
+	@param[in,out] 	trie 	the trie to free
+*/
+static void freeTrie(tTrie *trie)
+{
+	free(trie->nodes);
+	trie->nodes = NULL;
+	trie->count = 0;
+	trie->size = 0;
+}
+
+/**
+	@internal
+
+	Finds the longest keyword at the start of some text that
+	is followed by something that can't be part of a word.
+
+	@param[in] 	trie 	the keywords to look for
+	@param[in] 	ptr 	the start of the text
+	@param[in] 	end 	the end of the text
+	@param[out] length 	receives the length of the keyword
+
+	@return the kind of keyword found
+	@retval qKeyNone	the text doesn't start with a keyword
+*/
+static int matchTrie(const tTrie *trie, const char *ptr, const char *end,
+					 size_t *length)
+{
+	const char	*p = ptr;
+	unsigned int	node = 0;
+	int		kind = qKeyNone;
+	int		c;
+
+	if (trie->count == 0)
+		return qKeyNone;
+
+	while (p < end)
+	{
+		c = (byte)*p;
+		if (trie->folded)
+			c = tolower(c);
+		if (sSymbol[c] == 0
+		 || (node = trie->nodes[node].next[sSymbol[c] - 1]) == 0)
+			break;
+
+		++p;
+		if (trie->nodes[node].kind != qKeyNone
+		 && (p == end || !qIsWordChar(*p)))
+		{
+			kind = trie->nodes[node].kind;
+			*length = p - ptr;
+		}
+	}
+
+	return kind;
+}
+
+/**
+	@internal
+
+	Adds a list of words, separated by commas or whitespace.
+
+	@param[in] 	kind 	what the words mean
+	@param[in] 	words 	the list
+
+	@return int
+	@retval 0		all is well
+	@retval -1		a word can't be a keyword, or there are none
+	@retval -108	unable to allocate memory
+*/
+static int addWords(int kind, const char *words)
+{
+	const char	*p = words;
+	size_t	length;
+	int		result = -1;
+
+	for (;;)
+	{
+		while (*p == ',' || isspace((byte)*p))
+			++p;
+		if (*p == '\0')
+			break;
+
+		length = strcspn(p, ", \t\r\n");
+		result = addKeyword(kind, p, length);
+		if (result != 0)
+			break;
+		p += length;
+	}
+
+	return result;
+}
+
+/*
+	public functions
+*/
+
+/**
+	Sets up the keywords that are always known, forgetting any
+	that had been added. Must be called before anything else here.
+
+	@return int
+	@retval 0		all is well
+	@retval -108	unable to allocate memory
+*/
+int initKeywords(void)
+{
+	size_t	i;
+	int		result;
+
+	result = initTrie(&sMarkers, true);
+	if (result == 0)
+		result = initTrie(&sKeywords, false);
+
+	for (i = 0; result == 0 && i < sizeof(sBuiltIn) / sizeof(sBuiltIn[0]); ++i)
+		result = addKeyword(sBuiltIn[i].kind, sBuiltIn[i].word,
+							strlen(sBuiltIn[i].word));
+
+	return result;
+}
+
+/**
+	Releases the storage used by the keywords.
+*/
+void freeKeywords(void)
+{
+	freeTrie(&sMarkers);
+	freeTrie(&sKeywords);
+}
+
+/**
+	Adds a keyword. If it's already known, it takes on the new meaning.
+
+	@param[in] 	kind 	what the keyword means (a qKey constant)
+	@param[in] 	word 	the keyword, which may contain letters,
+						digits, '_' and '-'
+	@param[in] 	length 	the number of characters in it
+
+	@return int
+	@retval 0		all is well
+	@retval -1		the word can't be a keyword
+	@retval -108	unable to allocate memory
+*/
+int addKeyword(int kind, const char *word, size_t length)
+{
+	tTrie		*trie;
+	tTrieNode	*nodes;
+	unsigned int	node = 0;
+	size_t	i;
+	int		c;
+
+	if (kind <= qKeyNone || kind >= qKeyKinds
+	 || length == 0 || length > qMaxKeyword)
+		return (-1);
+
+	trie = (kind == qKeyTodo || kind == qKeyNote) ? &sMarkers : &sKeywords;
+
+	for (i = 0; i < length; ++i)
+	{
+		c = (byte)word[i];
+		if (trie->folded)
+			c = tolower(c);
+		if (sSymbol[c] == 0)
+			return (-1);
+	}
+
+	for (i = 0; i < length; ++i)
+	{
+		c = (byte)word[i];
+		if (trie->folded)
+			c = tolower(c);
+		c = sSymbol[c] - 1;
+
+		if (trie->nodes[node].next[c] == 0)
+		{
+			/* node numbers have to fit in a tTrieNode */
+			if (trie->count > (unsigned short)~0)
+				return (-108);
+
+			if (trie->count == trie->size)
+			{
+				nodes = (tTrieNode *)realloc(trie->nodes,
+										2 * trie->size * sizeof(tTrieNode));
+				if (nodes == NULL)
+					return (-108);
+				trie->nodes = nodes;
+				trie->size *= 2;
+			}
+			memset(&trie->nodes[trie->count], 0, sizeof(tTrieNode));
+			trie->nodes[node].next[c] = (unsigned short)trie->count++;
+		}
+		node = trie->nodes[node].next[c];
+	}
+	trie->nodes[node].kind = (byte)kind;
+
+	return 0;
+}
+
+/**
+	Adds keywords described as '<kind>=<word>[,<word>...]',
+	e.g. 'todo=XXX,HACK', where <kind> is one of todo, note,
+	return, static, const, qualifier, ignore, scope, access,
+	template, operator or trailing.
+
+	@param[in] 	spec 	the description
+
+	@return int
+	@retval 0		all is well
+	@retval -1		the description can't be understood
+	@retval -108	unable to allocate memory
+*/
+int addKeywords(const char *spec)
+{
+	const char	*p;
+	size_t	length;
+	int		kind;
+
+	while (isspace((byte)*spec))
+		++spec;
+	p = spec;
+	while (isalpha((byte)*p))
+		++p;
+	length = p - spec;
+	while (isspace((byte)*p))
+		++p;
+	if (*p != '=')
+		return (-1);
+
+	for (kind = qKeyNone + 1; kind < qKeyKinds; ++kind)
+	{
+		if (strlen(sKindNames[kind]) == length
+		 && strncmp(spec, sKindNames[kind], length) == 0)
+		{
+			return addWords(kind, p + 1);
+		}
+	}
+
+	return (-1);
+}
+
+/**
+	Adds the keywords listed in a file, one addKeywords()
+	description per line. Blank lines, and lines starting
+	with '#', are ignored.
+
+	@param[in] 	filename 	the file to read
+	@param[out] line 		receives the number of the line
+							that couldn't be understood
+
+	@return int
+	@retval 0		all is well
+	@retval -1		a line can't be understood
+	@retval -36		unable to read the file
+	@retval -43		unable to open the file
+	@retval -108	unable to allocate memory
+*/
+int loadKeywords(const char *filename, long *line)
+{
+	FILE	*file;
+	char	text[4096];
+	char	*p;
+	int		result = 0;
+
+	file = fopen(filename, "r");
+	if (file == NULL)
+		return (-43);
+
+	*line = 0;
+	while (result == 0 && fgets(text, sizeof(text), file) != NULL)
+	{
+		++*line;
+		p = text;
+		while (isspace((byte)*p))
+			++p;
+		if (*p != '\0' && *p != '#')
+			result = addKeywords(p);
+	}
+	if (result == 0 && ferror(file))
+		result = -36;
+	fclose(file);
+
+	return result;
+}
+
+/**
+	Finds the marker, if any, that a comment starts with.
+	Case is ignored.
+
+	@param[in] 	ptr 	the start of the comment's text
+	@param[in] 	end 	the end of the comment
+	@param[out] length 	receives the length of the marker
+
+	@return the kind of marker (qKeyTodo or qKeyNote)
+	@retval qKeyNone	the comment doesn't start with one
+*/
+int matchMarker(const char *ptr, const char *end, size_t *length)
+{
+	return matchTrie(&sMarkers, ptr, end, length);
+}
+
+/**
+	Finds the keyword, if any, that some code starts with.
+
+	@param[in] 	ptr 	the start of the code
+	@param[in] 	end 	the end of the code
+	@param[out] length 	receives the length of the keyword
+
+	@return the kind of keyword
+	@retval qKeyNone	the code doesn't start with one
+*/
+int matchKeyword(const char *ptr, const char *end, size_t *length)
+{
+	return matchTrie(&sKeywords, ptr, end, length);
+}
@@ -0,0 +1,44 @@
+/**
+	@file keywordutils.h
+
+	Public interface for keywordutils.c
+
+	@version 0.92
+	@author Paul Chambers
+	@date 2005-2006
+*/
+/* $Header$ */
+
+/*
+	what a keyword means to the parser. Markers (todo and note)
+	start a comment, and case is ignored when looking for them;
+	the rest are words within the code itself.
+*/
+#define qKeyNone		0	/**< not a keyword */
+#define qKeyTodo		1	/**< a comment to be added as a \@todo */
+#define qKeyNote		2	/**< a comment to be added as a \@note */
+#define qKeyReturn		3	/**< a statement that returns a value */
+#define qKeyStatic		4	/**< makes a function internal */
+#define qKeyConst		5	/**< makes an argument input only */
+#define qKeyQualifier	6	/**< kept in a type's description, e.g. 'volatile' */
+#define qKeyIgnored		7	/**< left out of a type's description, e.g. 'inline' */
+#define qKeyScope		8	/**< opens a block of declarations, e.g. 'namespace' */
+#define qKeyAccess		9	/**< labels part of a class, e.g. 'public' */
+#define qKeyTemplate	10	/**< starts a template's parameters */
+#define qKeyOperator	11	/**< names an operator, e.g. 'operator==' */
+#define qKeyTrailing	12	/**< follows an argument list, with brackets of its
+								 own, e.g. 'noexcept' */
+#define qKeyKinds		13	/**< the number of kinds */
+
+/** the longest keyword that can be added */
+#define qMaxKeyword		64
+
+int initKeywords(void);
+void freeKeywords(void);
+
+int addKeyword(int kind, const char *word, size_t length);
+int addKeywords(const char *spec);
+int loadKeywords(const char *filename, long *line);
+
+int matchMarker(const char *ptr, const char *end, size_t *length);
+int matchKeyword(const char *ptr, const char *end, size_t *length);
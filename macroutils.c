@@ -0,0 +1,1134 @@
+/**
+	@file macroutils.c
+
+	Follows the conditionals in a file (\#if, \#ifdef and the rest), so
+	the branches that are compiled out can be passed over rather than
+	parsed.
+
+	Only the macros given with -D and -U are known. A condition that
+	depends on any other macro isn't known, so both of its branches
+	are parsed, much as they always were. The conditions understood
+	are the usual ones: numbers, defined(), the known macros, and the
+	arithmetic, comparison and logical operators between them.
+
+	A branch is only passed over when it's certain that it's compiled
+	out. Once a branch of a conditional is certain to be compiled in,
+	the branches after it are compiled out, whatever they say; one
+	that isn't known doesn't settle anything, so it's parsed, and the
+	ones after it are still looked at.
+
+	A file may \#define or \#undef one of the known macros itself,
+	which is followed from there on (as long as the directive isn't
+	compiled out).
+
+	The macros are only changed before any files are processed, after
+	which they're shared, unchanged, by all of the worker threads.
+	Everything that changes as a file is parsed is in its tConditions.
+
+	@version 0.92
+	@author Paul Chambers
+	@date 2005-2006
+*/
+/* $Header$ */
+
+#include "common.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+
+#include "macroutils.h"
+
+/** the number of macros the table starts with */
+#define qFirstMacros	16
+
+/** true if the character can be part of an identifier */
+#define qIsWordChar(c)	(isalnum((byte)(c)) || (c) == '_')
+
+/*
+	the state of each conditional a line is within (tConditions::levels)
+*/
+#define qLevelTaken		0x01	/**< one of its branches so far is certainly
+									 compiled in, so the rest are compiled out */
+#define qLevelDead		0x02	/**< the current branch is compiled out */
+#define qLevelOuter		0x04	/**< it's within a branch that's compiled out,
+									 so all of it is */
+
+/**
+	one of the macros given with -D or -U.
+*/
+typedef struct {
+	const char	*name;		/**< its name (not nul-terminated) */
+	size_t	length;			/**< the length of the name */
+	bool	defined;		/**< given with -D, rather than -U */
+	bool	known;			/**< its value is a number */
+	long	value;			/**< the number, if it is one */
+} tMacro;
+
+/**
+	a value within a condition.
+*/
+typedef struct {
+	long	value;		/**< the value, if it's known */
+	bool	known;		/**< it doesn't depend on anything unknown */
+} tValue;
+
+/**
+	a condition that's being evaluated.
+*/
+typedef struct {
+	const char	*p;				/**< the next character to look at */
+	const char	*end;			/**< points just past the last character */
+	const tConditions	*cond;	/**< what's known about the macros */
+	bool	failed;				/**< it isn't a condition that's understood */
+} tExpr;
+
+static tMacro	*sMacros;		/**< the macros from -D and -U */
+static int		sMacroCount;	/**< the number of them */
+static int		sMacroSize;		/**< the number allocated */
+
+static const char *readWord(const char *p, const char *end, size_t *length);
+static bool readNumber(tExpr *e, long *value, bool *known);
+static int findMacro(const char *name, size_t length);
+static int addMacro(const char *name, size_t length, bool defined,
+					bool known, long value);
+static bool isWord(const char *word, size_t length, const char *literal);
+static bool isDead(const tConditions *cond);
+static void setOverride(tConditions *cond, int macro, bool defined,
+						bool known, long value);
+static const tOverride *findOverride(const tConditions *cond, int macro);
+static int isDefined(const tConditions *cond, const char *name,
+					 size_t length);
+static void skipBlanks(tExpr *e);
+static bool takeOperator(tExpr *e, const char *op);
+static tValue evalPrimary(tExpr *e);
+static tValue evalUnary(tExpr *e);
+static tValue evalProduct(tExpr *e);
+static tValue evalSum(tExpr *e);
+static tValue evalRelation(tExpr *e);
+static tValue evalEquality(tExpr *e);
+static tValue evalAnd(tExpr *e);
+static tValue evalOr(tExpr *e);
+static int evalBranch(const tConditions *cond, const char *word,
+					  size_t length, tExpr *e);
+static void openConditional(tConditions *cond, int result);
+static void enterBranch(byte *level, int result);
+
+/*
+	private functions
+*/
+
+/**
+	@internal
+
+	Reads an identifier.
+
+	@param[in] 	p 		 the first character of it
+	@param[in] 	end 	 points just past the last character there is
+	@param[out] length 	 receives the length of the identifier
+
+	@return the identifier
+	@retval NULL	there isn't one at p
+*/
+static const char *readWord(const char *p, const char *end, size_t *length)
+{
+	const char	*start = p;
+
+	if (p >= end || !(isalpha((byte)*p) || *p == '_'))
+		return NULL;
+
+	while (p < end && qIsWordChar(*p))
+		++p;
+
+	*length = p - start;
+	return start;
+}
+
+/**
+	@internal
+
+	Reads a number (decimal, octal or hex, with any suffix).
+
+	Arithmetic here is all signed, so an unsigned number (one with a 'u'
+	suffix, or too big for a long) isn't known: C's usual conversions
+	would make e.g. -1 > 0u true.
+
+	@param[in,out] 	e 		the condition, moved past the number
+	@param[out] 	value 	receives the number
+	@param[out] 	known 	receives whether it's a signed number
+
+	@return false if there isn't a number that's understood
+*/
+static bool readNumber(tExpr *e, long *value, bool *known)
+{
+	unsigned long	n = 0;
+	int		base = 10;
+	int		digit;
+	const char	*start;
+
+	if (e->p >= e->end || !isdigit((byte)*e->p))
+		return false;
+
+	if (*e->p == '0')
+	{
+		base = 8;
+		++e->p;
+		if (e->p < e->end && (*e->p == 'x' || *e->p == 'X'))
+		{
+			base = 16;
+			++e->p;
+		}
+	}
+
+	start = e->p;
+	while (e->p < e->end && isxdigit((byte)*e->p))
+	{
+		digit = isdigit((byte)*e->p) ? *e->p - '0'
+									 : tolower((byte)*e->p) - 'a' + 10;
+		if (digit >= base || n > (ULONG_MAX - digit) / base)
+			return false;
+		n = n * base + digit;
+		++e->p;
+	}
+
+	/* '0x' needs at least one digit after it */
+	if (base == 16 && e->p == start)
+		return false;
+
+	*known = (bool)(n <= LONG_MAX);
+	while (e->p < e->end && strchr("uUlL", *e->p) != NULL)
+	{
+		if (*e->p == 'u' || *e->p == 'U')
+			*known = false;
+		++e->p;
+	}
+
+	if (e->p < e->end && qIsWordChar(*e->p))
+		return false;
+
+	*value = *known ? (long)n : 0;
+	return true;
+}
+
+/**
+	@internal
+
+	Finds a macro given with -D or -U.
+
+	@param[in] 	name 	its name
+	@param[in] 	length 	the length of the name
+
+	@return its index in sMacros
+	@retval -1	it isn't one of them
+*/
+static int findMacro(const char *name, size_t length)
+{
+	int		i;
+
+	for (i = 0; i < sMacroCount; ++i)
+	{
+		if (sMacros[i].length == length
+		 && memcmp(sMacros[i].name, name, length) == 0)
+			return i;
+	}
+
+	return (-1);
+}
+
+/**
+	@internal
+
+	Adds a macro to sMacros, or changes it if it's already there
+	(so the last -D or -U for it is the one that counts).
+
+	@param[in] 	name 	 its name, which must stay where it is
+	@param[in] 	length 	 the length of the name
+	@param[in] 	defined  true for -D, false for -U
+	@param[in] 	known 	 its value is a number
+	@param[in] 	value 	 the number
+
+	@return int
+	@retval 0		all is well
+	@retval -108	unable to allocate memory
+*/
+static int addMacro(const char *name, size_t length, bool defined,
+					bool known, long value)
+{
+	tMacro	*macros;
+	int		i;
+
+	i = findMacro(name, length);
+	if (i < 0)
+	{
+		if (sMacroCount == sMacroSize)
+		{
+			i = (sMacroSize == 0) ? qFirstMacros : sMacroSize * 2;
+			macros = (tMacro *)realloc(sMacros, i * sizeof(tMacro));
+			if (macros == NULL)
+				return (-108);
+			sMacros = macros;
+			sMacroSize = i;
+		}
+		i = sMacroCount++;
+		sMacros[i].name = name;
+		sMacros[i].length = length;
+	}
+
+	sMacros[i].defined = defined;
+	sMacros[i].known = known;
+	sMacros[i].value = value;
+
+	return 0;
+}
+
+/**
+	@internal
+
+	Checks if a word is the one expected.
+
+	@param[in] 	word 	 the word
+	@param[in] 	length 	 the length of the word
+	@param[in] 	literal  the word expected
+
+	@return true if they're the same
+*/
+static bool isWord(const char *word, size_t length, const char *literal)
+{
+	return (bool)(strlen(literal) == length
+				&& memcmp(word, literal, length) == 0);
+}
+
+/**
+	@internal
+
+	Checks if the current line is compiled out.
+
+	@param[in] 	cond 	the state of the conditionals
+
+	@return true if it is
+*/
+static bool isDead(const tConditions *cond)
+{
+	return (bool)(cond->depth > 0
+		&& (cond->levels[cond->depth - 1] & (qLevelDead | qLevelOuter)) != 0);
+}
+
+/**
+	@internal
+
+	Records a file's own change to one of the macros. If there
+	are too many to keep track of, none of them are known from
+	then on.
+
+	@param[in,out] 	cond 	 the state of the file's conditionals
+	@param[in] 	macro 	 the macro's index in sMacros
+	@param[in] 	defined  whether it's now defined
+	@param[in] 	known 	 whether its value is known
+	@param[in] 	value 	 the value, if it's known
+*/
+static void setOverride(tConditions *cond, int macro, bool defined,
+						bool known, long value)
+{
+	tOverride	*override;
+
+	override = (tOverride *)findOverride(cond, macro);
+	if (override == NULL)
+	{
+		if (cond->overrideCount == qMaxOverrides)
+		{
+			cond->confused = true;
+			return;
+		}
+		override = &cond->overrides[cond->overrideCount++];
+		override->macro = macro;
+	}
+
+	override->defined = defined;
+	override->known = known;
+	override->value = value;
+}
+
+/**
+	@internal
+
+	Finds a file's own change to one of the macros.
+
+	@param[in] 	cond 	the state of the file's conditionals
+	@param[in] 	macro 	the macro's index in sMacros
+
+	@return the change
+	@retval NULL	the file hasn't changed it
+*/
+static const tOverride *findOverride(const tConditions *cond, int macro)
+{
+	int		i;
+
+	for (i = 0; i < cond->overrideCount; ++i)
+	{
+		if (cond->overrides[i].macro == macro)
+			return &cond->overrides[i];
+	}
+
+	return NULL;
+}
+
+/**
+	@internal
+
+	Checks if a macro is defined.
+
+	@param[in] 	cond 	what's known about the macros
+	@param[in] 	name 	its name
+	@param[in] 	length 	the length of the name
+
+	@return qCondTrue if it's defined, qCondFalse if it isn't,
+			or qCondUnknown if it isn't known
+*/
+static int isDefined(const tConditions *cond, const char *name,
+					 size_t length)
+{
+	const tOverride	*override;
+	int		macro;
+
+	macro = findMacro(name, length);
+	if (macro < 0 || cond->confused)
+		return qCondUnknown;
+
+	override = findOverride(cond, macro);
+	if (override != NULL)
+		return override->defined ? qCondTrue : qCondFalse;
+
+	return sMacros[macro].defined ? qCondTrue : qCondFalse;
+}
+
+/**
+	@internal
+
+	Skips the spaces in a condition.
+
+	@param[in,out] 	e 	the condition
+*/
+static void skipBlanks(tExpr *e)
+{
+	while (e->p < e->end && isspace((byte)*e->p))
+		++e->p;
+}
+
+/**
+	@internal
+
+	Takes an operator from a condition, if it's the next thing in it.
+	An operator isn't taken if it's just the start of a longer one,
+	so '&' can't be taken from '&&', nor '<' from '<='.
+
+	@param[in,out] 	e 	the condition
+	@param[in] 		op 	the operator
+
+	@return true if it was taken
+*/
+static bool takeOperator(tExpr *e, const char *op)
+{
+	size_t	length = strlen(op);
+	const char	*after;
+
+	skipBlanks(e);
+	if ((size_t)(e->end - e->p) < length || memcmp(e->p, op, length) != 0)
+		return false;
+
+	after = e->p + length;
+	if (after < e->end
+	 && (*after == '=' || (length == 1 && *after == *op
+						   && (*op == '&' || *op == '|'
+						    || *op == '<' || *op == '>'))))
+		return false;
+
+	e->p = after;
+	return true;
+}
+
+/**
+	@internal
+
+	Evaluates a number, a macro, defined() or a bracketed condition.
+
+	@param[in,out] 	e 	the condition
+
+	@return its value
+*/
+static tValue evalPrimary(tExpr *e)
+{
+	tValue	v;
+	const tOverride	*override;
+	const char	*word;
+	size_t	length;
+	int		macro;
+	bool	bracketed;
+
+	v.value = 0;
+	v.known = false;
+
+	skipBlanks(e);
+	if (takeOperator(e, "("))
+	{
+		v = evalOr(e);
+		if (!takeOperator(e, ")"))
+			e->failed = true;
+		return v;
+	}
+
+	if (readNumber(e, &v.value, &v.known))
+		return v;
+
+	word = readWord(e->p, e->end, &length);
+	if (word == NULL)
+	{
+		e->failed = true;
+		return v;
+	}
+	e->p += length;
+
+	if (isWord(word, length, "defined"))
+	{
+		bracketed = takeOperator(e, "(");
+		skipBlanks(e);
+		word = readWord(e->p, e->end, &length);
+		if (word != NULL)
+			e->p += length;
+		if (word == NULL || (bracketed && !takeOperator(e, ")")))
+		{
+			e->failed = true;
+			return v;
+		}
+
+		switch (isDefined(e->cond, word, length))
+		{
+		case qCondTrue:
+			v.value = 1;
+			v.known = true;
+			break;
+		case qCondFalse:
+			v.known = true;
+			break;
+		}
+		return v;
+	}
+
+	/* another macro: only one from -D or -U is known */
+	macro = findMacro(word, length);
+	if (macro >= 0 && !e->cond->confused)
+	{
+		override = findOverride(e->cond, macro);
+		if (override != NULL)
+		{
+			v.known = (bool)(!override->defined || override->known);
+			v.value = override->defined ? override->value : 0;
+		}
+		else
+		{
+			v.known = (bool)(!sMacros[macro].defined || sMacros[macro].known);
+			v.value = sMacros[macro].defined ? sMacros[macro].value : 0;
+		}
+	}
+
+	/* a function-like macro (or something like __has_include()) */
+	skipBlanks(e);
+	if (e->p < e->end && *e->p == '(')
+		e->failed = true;
+
+	return v;
+}
+
+/**
+	@internal
+
+	Evaluates the unary operators !, -, + and ~.
+
+	@param[in,out] 	e 	the condition
+
+	@return its value
+*/
+static tValue evalUnary(tExpr *e)
+{
+	tValue	v;
+
+	if (takeOperator(e, "!"))
+	{
+		v = evalUnary(e);
+		v.value = !v.value;
+	}
+	else if (takeOperator(e, "-"))
+	{
+		v = evalUnary(e);
+		if (v.value == LONG_MIN)
+			e->failed = true;
+		v.value = -v.value;
+	}
+	else if (takeOperator(e, "+"))
+		v = evalUnary(e);
+	else if (takeOperator(e, "~"))
+	{
+		v = evalUnary(e);
+		v.value = ~v.value;
+	}
+	else
+		v = evalPrimary(e);
+
+	return v;
+}
+
+/**
+	@internal
+
+	Evaluates *, / and %.
+
+	@param[in,out] 	e 	the condition
+
+	@return its value
+*/
+static tValue evalProduct(tExpr *e)
+{
+	tValue	a, b;
+	int		op;
+
+	a = evalUnary(e);
+	while (!e->failed)
+	{
+		if (takeOperator(e, "*"))
+			op = '*';
+		else if (takeOperator(e, "/"))
+			op = '/';
+		else if (takeOperator(e, "%"))
+			op = '%';
+		else
+			break;
+
+		b = evalUnary(e);
+		if (a.known && b.known)
+		{
+			if (op != '*'
+			 && (b.value == 0 || (a.value == LONG_MIN && b.value == -1)))
+				e->failed = true;
+			else if (op == '*')
+				a.value = (long)((unsigned long)a.value * b.value);
+			else if (op == '/')
+				a.value /= b.value;
+			else
+				a.value %= b.value;
+		}
+		a.known = (bool)(a.known && b.known);
+	}
+
+	return a;
+}
+
+/**
+	@internal
+
+	Evaluates + and -.
+
+	@param[in,out] 	e 	the condition
+
+	@return its value
+*/
+static tValue evalSum(tExpr *e)
+{
+	tValue	a, b;
+	bool	add;
+
+	a = evalProduct(e);
+	while (!e->failed)
+	{
+		if (takeOperator(e, "+"))
+			add = true;
+		else if (takeOperator(e, "-"))
+			add = false;
+		else
+			break;
+
+		b = evalProduct(e);
+		/* (wrapping around, rather than overflowing) */
+		a.value = (long)(add ? (unsigned long)a.value + b.value
+							 : (unsigned long)a.value - b.value);
+		a.known = (bool)(a.known && b.known);
+	}
+
+	return a;
+}
+
+/**
+	@internal
+
+	Evaluates <, <=, > and >=.
+
+	@param[in,out] 	e 	the condition
+
+	@return its value
+*/
+static tValue evalRelation(tExpr *e)
+{
+	tValue	a, b;
+
+	a = evalSum(e);
+	while (!e->failed)
+	{
+		if (takeOperator(e, "<="))
+			b = evalSum(e), a.value = (a.value <= b.value);
+		else if (takeOperator(e, ">="))
+			b = evalSum(e), a.value = (a.value >= b.value);
+		else if (takeOperator(e, "<"))
+			b = evalSum(e), a.value = (a.value < b.value);
+		else if (takeOperator(e, ">"))
+			b = evalSum(e), a.value = (a.value > b.value);
+		else
+			break;
+
+		a.known = (bool)(a.known && b.known);
+	}
+
+	return a;
+}
+
+/**
+	@internal
+
+	Evaluates == and !=.
+
+	@param[in,out] 	e 	the condition
+
+	@return its value
+*/
+static tValue evalEquality(tExpr *e)
+{
+	tValue	a, b;
+
+	a = evalRelation(e);
+	while (!e->failed)
+	{
+		if (takeOperator(e, "=="))
+			b = evalRelation(e), a.value = (a.value == b.value);
+		else if (takeOperator(e, "!="))
+			b = evalRelation(e), a.value = (a.value != b.value);
+		else
+			break;
+
+		a.known = (bool)(a.known && b.known);
+	}
+
+	return a;
+}
+
+/**
+	@internal
+
+	Evaluates &&. If either side is known to be false, so is the
+	result, even if the other side isn't known.
+
+	@param[in,out] 	e 	the condition
+
+	@return its value
+*/
+static tValue evalAnd(tExpr *e)
+{
+	tValue	a, b;
+
+	a = evalEquality(e);
+	while (!e->failed && takeOperator(e, "&&"))
+	{
+		b = evalEquality(e);
+		if ((a.known && a.value == 0) || (b.known && b.value == 0))
+		{
+			a.value = 0;
+			a.known = true;
+		}
+		else
+		{
+			a.value = 1;
+			a.known = (bool)(a.known && b.known);
+		}
+	}
+
+	return a;
+}
+
+/**
+	@internal
+
+	Evaluates ||. If either side is known to be true, so is the
+	result, even if the other side isn't known.
+
+	@param[in,out] 	e 	the condition
+
+	@return its value
+*/
+static tValue evalOr(tExpr *e)
+{
+	tValue	a, b;
+
+	a = evalAnd(e);
+	while (!e->failed && takeOperator(e, "||"))
+	{
+		b = evalAnd(e);
+		if ((a.known && a.value != 0) || (b.known && b.value != 0))
+		{
+			a.value = 1;
+			a.known = true;
+		}
+		else
+		{
+			a.value = 0;
+			a.known = (bool)(a.known && b.known);
+		}
+	}
+
+	return a;
+}
+
+/**
+	@internal
+
+	Evaluates what follows the name of a directive that starts
+	a branch: the condition of an \#if or \#elif, or the name
+	after an \#ifdef, \#ifndef, \#elifdef or \#elifndef.
+
+	@param[in] 		cond 	what's known about the macros
+	@param[in] 		word 	the name of the directive
+	@param[in] 		length 	the length of the name
+	@param[in,out] 	e 		the rest of the directive
+
+	@return qCondTrue, qCondFalse or qCondUnknown
+*/
+static int evalBranch(const tConditions *cond, const char *word,
+					  size_t length, tExpr *e)
+{
+	const char	*name;
+	size_t	nameLength;
+	int		result;
+
+	if (isWord(word, length, "if") || isWord(word, length, "elif"))
+		return evalCondition(cond, e->p, e->end - e->p);
+
+	skipBlanks(e);
+	name = readWord(e->p, e->end, &nameLength);
+	if (name == NULL)
+		return qCondUnknown;
+	e->p += nameLength;
+	skipBlanks(e);
+	if (e->p != e->end)
+		return qCondUnknown;
+
+	result = isDefined(cond, name, nameLength);
+	if (result != qCondUnknown
+	 && (isWord(word, length, "ifndef") || isWord(word, length, "elifndef")))
+		result = (result == qCondTrue) ? qCondFalse : qCondTrue;
+
+	return result;
+}
+
+/**
+	@internal
+
+	Starts a conditional (\#if, \#ifdef or \#ifndef).
+
+	@param[in,out] 	cond 	the state of the conditionals
+	@param[in] 		result 	what its condition came to
+*/
+static void openConditional(tConditions *cond, int result)
+{
+	bool	dead = isDead(cond);
+
+	if (cond->depth == qMaxNesting)
+	{
+		/* not followed, so it's as if its condition isn't known */
+		++cond->extra;
+		return;
+	}
+
+	cond->levels[cond->depth] = dead ? qLevelOuter : 0;
+	enterBranch(&cond->levels[cond->depth], result);
+	++cond->depth;
+}
+
+/**
+	@internal
+
+	Moves on to the next branch of a conditional.
+
+	@param[in,out] 	level 	the state of the conditional
+	@param[in] 		result 	what the branch's condition came to
+							(qCondTrue for \#else)
+*/
+static void enterBranch(byte *level, int result)
+{
+	if ((*level & qLevelOuter) != 0)
+		return;
+
+	if ((*level & qLevelTaken) != 0 || result == qCondFalse)
+		*level |= qLevelDead;
+	else if (result == qCondTrue)
+		*level = qLevelTaken;
+	else
+		*level &= ~qLevelDead;
+}
+
+/*
+	public functions
+*/
+
+/**
+	Adds a macro given with -D.
+
+	@param[in] 	spec 	'<name>' or '<name>=<value>', which must stay where
+						it is (it's used, rather than copied). Without a
+						value, the macro is 1, as it is for a compiler
+
+	@return int
+	@retval 0		all is well
+	@retval -1		it isn't a name, or a name and a value
+	@retval -108	unable to allocate memory
+*/
+int defineMacro(const char *spec)
+{
+	const char	*end = spec + strlen(spec);
+	const char	*name;
+	size_t	length;
+	tExpr	e;
+	long	value = 1;
+	bool	known = true;
+
+	name = readWord(spec, end, &length);
+	if (name == NULL || (spec[length] != '\0' && spec[length] != '='))
+		return (-1);
+
+	if (spec[length] == '=')
+	{
+		/* only a number is understood, the rest aren't known */
+		e.p = &spec[length + 1];
+		e.end = end;
+		skipBlanks(&e);
+		if (!readNumber(&e, &value, &known))
+			known = false;
+		skipBlanks(&e);
+		if (e.p != e.end)
+			known = false;
+	}
+
+	return addMacro(name, length, true, known, value);
+}
+
+/**
+	Adds a macro given with -U.
+
+	@param[in] 	name 	the name of the macro, which must
+						stay where it is
+
+	@return int
+	@retval 0		all is well
+	@retval -1		it isn't a name
+	@retval -108	unable to allocate memory
+*/
+int undefineMacro(const char *name)
+{
+	size_t	length;
+
+	if (readWord(name, name + strlen(name), &length) == NULL
+	 || name[length] != '\0')
+		return (-1);
+
+	return addMacro(name, length, false, true, 0);
+}
+
+/**
+	Checks if any macros were given with -D or -U. If not, there's
+	no point following the conditionals, as none of them are known.
+
+	@return true if there are some
+*/
+bool haveMacros(void)
+{
+	return (bool)(sMacroCount > 0);
+}
+
+/**
+	Releases the macros.
+*/
+void freeMacros(void)
+{
+	free(sMacros);
+	sMacros = NULL;
+	sMacroCount = 0;
+	sMacroSize = 0;
+}
+
+/**
+	Empties a tDirective, for the next directive.
+
+	@param[out] dir 	the tDirective to empty
+*/
+void clearDirective(tDirective *dir)
+{
+	dir->length = 0;
+}
+
+/**
+	Adds characters to a directive. If there isn't room for them,
+	they're only counted, so the directive is known to be incomplete.
+
+	@param[in,out] 	dir 	the tDirective
+	@param[in] 		start 	the characters to add
+	@param[in] 		count 	the number of them
+*/
+void addToDirective(tDirective *dir, const char *start, size_t count)
+{
+	if (dir->length + count <= qMaxDirective)
+		memcpy(&dir->text[dir->length], start, count);
+	dir->length += count;
+}
+
+/**
+	Gets a tConditions ready for the start of a file.
+
+	@param[out] cond 	the tConditions to set up
+*/
+void initConditions(tConditions *cond)
+{
+	cond->depth = 0;
+	cond->extra = 0;
+	cond->overrideCount = 0;
+	cond->confused = false;
+}
+
+/**
+	Follows a directive that's just ended. Conditionals move on to
+	their next branch, and \#define and \#undef are noted if they
+	name one of the macros from -D or -U. Anything else is ignored.
+
+	@param[in,out] 	cond 	the state of the file's conditionals
+	@param[in] 		dir 	the directive
+
+	@return true if the lines after it are compiled out
+*/
+bool followDirective(tConditions *cond, const tDirective *dir)
+{
+	const char	*word, *name;
+	size_t	length, nameLength;
+	tExpr	e;
+	long	value;
+	int		macro, result;
+	bool	complete = (bool)(dir->length <= qMaxDirective);
+	bool	known;
+
+	e.p = dir->text;
+	e.end = &dir->text[complete ? dir->length : qMaxDirective];
+	e.cond = cond;
+	e.failed = false;
+
+	skipBlanks(&e);
+	word = readWord(e.p, e.end, &length);
+	if (word == NULL)
+		return isDead(cond);
+	e.p += length;
+
+	if (isWord(word, length, "if")
+	 || isWord(word, length, "ifdef")
+	 || isWord(word, length, "ifndef"))
+	{
+		result = qCondUnknown;
+		if (!isDead(cond) && complete && cond->depth < qMaxNesting)
+			result = evalBranch(cond, word, length, &e);
+		openConditional(cond, result);
+	}
+	else if (isWord(word, length, "elif")
+		  || isWord(word, length, "elifdef")
+		  || isWord(word, length, "elifndef"))
+	{
+		if (cond->extra == 0 && cond->depth > 0)
+		{
+			result = qCondUnknown;
+			if ((cond->levels[cond->depth - 1]
+				 & (qLevelTaken | qLevelOuter)) == 0 && complete)
+				result = evalBranch(cond, word, length, &e);
+			enterBranch(&cond->levels[cond->depth - 1], result);
+		}
+	}
+	else if (isWord(word, length, "else"))
+	{
+		if (cond->extra == 0 && cond->depth > 0)
+			enterBranch(&cond->levels[cond->depth - 1], qCondTrue);
+	}
+	else if (isWord(word, length, "endif"))
+	{
+		if (cond->extra > 0)
+			--cond->extra;
+		else if (cond->depth > 0)
+			--cond->depth;
+	}
+	else if ((isWord(word, length, "define") || isWord(word, length, "undef"))
+		  && !isDead(cond))
+	{
+		skipBlanks(&e);
+		name = readWord(e.p, e.end, &nameLength);
+		macro = (name == NULL) ? -1 : findMacro(name, nameLength);
+		if (macro >= 0 && *word == 'u')
+			setOverride(cond, macro, false, true, 0);
+		else if (macro >= 0)
+		{
+			/* only a number is understood (not a function-like macro) */
+			e.p = name + nameLength;
+			known = (bool)(complete && (e.p == e.end || *e.p != '('));
+			skipBlanks(&e);
+			if (!known || !readNumber(&e, &value, &known))
+				known = false;
+			skipBlanks(&e);
+			setOverride(cond, macro, true, (bool)(known && e.p == e.end),
+						known ? value : 0);
+		}
+	}
+
+	return isDead(cond);
+}
+
+/**
+	Checks if a file's conditionals are as they were at its start:
+	outside all of them, and without any of the macros changed. A
+	file can only be picked up from such a place, as the state of
+	the conditionals isn't carried over (see nextBoundary()).
+
+	@param[in] 	cond 	the state of the file's conditionals
+
+	@return true if it's settled
+*/
+bool isSettled(const tConditions *cond)
+{
+	return (bool)(cond->depth == 0 && cond->extra == 0
+			   && cond->overrideCount == 0 && !cond->confused);
+}
+
+/**
+	Evaluates the condition of an \#if or \#elif. Anything
+	that isn't understood isn't known.
+
+	@param[in] 	cond 	what's known about the macros
+	@param[in] 	text 	the condition
+	@param[in] 	length 	its length
+
+	@return qCondTrue, qCondFalse or qCondUnknown
+*/
+int evalCondition(const tConditions *cond, const char *text, size_t length)
+{
+	tExpr	e;
+	tValue	v;
+
+	e.p = text;
+	e.end = text + length;
+	e.cond = cond;
+	e.failed = false;
+
+	v = evalOr(&e);
+	skipBlanks(&e);
+	if (e.failed || e.p != e.end || !v.known)
+		return qCondUnknown;
+
+	return (v.value != 0) ? qCondTrue : qCondFalse;
+}
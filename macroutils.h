@@ -0,0 +1,73 @@
+/**
+	@file macroutils.h
+
+	Public interface for macroutils.c
+
+	@version 0.92
+	@author Paul Chambers
+	@date 2005-2006
+*/
+/* $Header$ */
+
+/** the longest directive that's evaluated (longer ones aren't known) */
+#define qMaxDirective	256
+
+/** the deepest nesting of conditionals that's followed */
+#define qMaxNesting		64
+
+/** the most macros from -D and -U a file may redefine for itself */
+#define qMaxOverrides	16
+
+/** what a condition came to */
+#define qCondFalse		0	/**< it's known to be false */
+#define qCondTrue		1	/**< it's known to be true */
+#define qCondUnknown	2	/**< it depends on something that isn't known */
+
+/**
+	the text of a preprocessor directive, after the '#', as it's
+	collected by the parser. Comments are left out.
+*/
+typedef struct {
+	size_t	length;					/**< the number of characters (more than
+										 qMaxDirective if some are missing) */
+	char	text[qMaxDirective];	/**< the characters */
+} tDirective;
+
+/**
+	a change a file made to one of the macros from -D and -U, with
+	its own \#define or \#undef.
+*/
+typedef struct {
+	int		macro;		/**< which macro changed */
+	bool	defined;	/**< whether it's now defined */
+	bool	known;		/**< whether its value is known */
+	long	value;		/**< its value, if it's known */
+} tOverride;
+
+/**
+	the state of the conditionals (\#if and the rest) in a file:
+	which of them the current line is within, and whether it's
+	compiled out.
+*/
+typedef struct {
+	int		depth;					/**< how many conditionals it's within */
+	int		extra;					/**< how many of those are deeper than
+										 qMaxNesting (and so not followed) */
+	byte	levels[qMaxNesting];	/**< the state of each (see macroutils.c) */
+	int		overrideCount;			/**< the number of overrides */
+	bool	confused;				/**< too many overrides to keep track */
+	tOverride	overrides[qMaxOverrides]; /**< the file's changes to the macros */
+} tConditions;
+
+int defineMacro(const char *spec);
+int undefineMacro(const char *name);
+bool haveMacros(void);
+void freeMacros(void);
+
+void clearDirective(tDirective *dir);
+void addToDirective(tDirective *dir, const char *start, size_t count);
+
+void initConditions(tConditions *cond);
+bool followDirective(tConditions *cond, const tDirective *dir);
+bool isSettled(const tConditions *cond);
+int evalCondition(const tConditions *cond, const char *text, size_t length);
@@ -23,15 +23,119 @@
 
 #include <stdlib.h>
 #include <stdio.h>
-#define __USE_BSD
 #include <string.h>
 #include <ctype.h>
 
+#include "arenautils.h"
+#include "sinkutils.h"
 #include "stringutils.h"
 #include "bufferutils.h"
+#include "fileutils.h"
+#include "cacheutils.h"
+#include "keywordutils.h"
+#include "typeutils.h"
+#include "macroutils.h"
 
 #include "parser.h"
 
+/*
+	Each state of the state machine ignores most characters - all
+	it does with them is add them to the buffer. sSignificant flags,
+	for each state, the characters that it does need to look at,
+	so that runs of the others can be skipped over in bulk.
+*/
+#define qInCode			0x01	/**< not in any of the following */
+#define qInBlockComment	0x02	/**< within a comment */
+#define qInLineComment	0x04	/**< within a C++-style comment */
+#define qInPreprocessor	0x08	/**< within a preprocessor directive */
+#define qInSingleQuotes	0x10	/**< within a character constant */
+#define qInDoubleQuotes	0x20	/**< within a string */
+#define qInDead			0x40	/**< within a branch that's compiled out
+									 (see skipDead()) */
+
+/** the characters each state of the state machine can't skip */
+static const byte sSignificant[256] = {
+	['\n']	= qInCode | qInLineComment | qInPreprocessor | qInDead,
+	['\r']	= qInCode | qInLineComment | qInPreprocessor | qInDead,
+	['/']	= qInCode | qInBlockComment | qInPreprocessor | qInDead,
+	['*']	= qInDead,
+	['\\']	= qInCode | qInPreprocessor | qInSingleQuotes | qInDoubleQuotes
+			  | qInDead,
+	['\'']	= qInCode | qInSingleQuotes | qInDead,
+	['"']	= qInCode | qInDoubleQuotes | qInDead,
+	['#']	= qInCode | qInDead,
+	['(']	= qInCode,
+	[')']	= qInCode,
+	['{']	= qInCode,
+	['}']	= qInCode,
+	[';']	= qInCode
+};
+
+/** the most qualifiers, like 'volatile', kept in a type's description */
+#define qMaxQualifiers	4
+
+/** the most indentation kept with a comment (see startDescription()) */
+#define qMaxIndent		32
+
+/** the contents of the 'boilerplate' file (see loadBoilerplate()) */
+static tSource sBoilerplate;
+
+/**
+	where skipDead() is, within a branch that's compiled out.
+*/
+typedef struct {
+	int		prevc;			/**< the previous character */
+	int		quote;			/**< the quote that started a literal
+								 (0 if not in one) */
+	bool	inComment;		/**< within a comment */
+	bool	inCppComment;	/**< within a C++-style comment */
+	bool	isLiteral;		/**< the current character was escaped */
+	bool	isChar1;		/**< only whitespace so far on this line */
+} tDeadScan;
+
+/**
+	a parser, which can be reused for any number of files.
+
+	Besides the state of the state machine, it holds on to the
+	tBuffer (and thus its storage and its arena) from one file
+	to the next, so they only need to be allocated once, and are
+	already the right size for the next file.
+*/
+struct tParser
+{
+	tBuffer	buf;			/**< the text accumulated so far */
+	size_t	bytes;			/**< the number of characters fed (for --stats) */
+	bool	plain;			/**< never skips runs of characters in bulk
+								 (see plainParser()) */
+	int		prevc;			/**< the previous character */
+	int		pending;		/**< the last character fed, which is waiting
+								 for the one after it (EOF if none) */
+	int		depthCurly;		/**< how deeply nested in curly brackets */
+	int		depthRound;		/**< how deeply nested in round brackets */
+	int		depthScope;		/**< how many of the curly brackets are around
+								 declarations, like a namespace's */
+	bool	inQuietRound;	/**< within round brackets at the top level
+								 that aren't an argument list */
+	bool	inQuietCurly;	/**< within curly brackets at the top level
+								 that aren't a body (see opensInitializer()) */
+	bool	inComment;		/**< within a comment */
+	bool	inCppComment;	/**< within a C++-style comment */
+	bool	inPreprocessor;	/**< within a preprocessor directive */
+	bool	inSingleQuotes;	/**< within a character constant */
+	bool	inDoubleQuotes;	/**< within a string */
+	bool	inBetween;		/**< between statements */
+	bool	isLiteral;		/**< the current character was escaped */
+	bool	isChar1;		/**< only whitespace so far on this line */
+	bool	atStart;		/**< only whitespace so far in this file */
+
+	/* only used with -D or -U */
+	bool	conditional;	/**< following the conditionals (see macroutils.c) */
+	bool	skipping;		/**< within a branch that's compiled out */
+	tDirective	directive;	/**< the directive being collected */
+	tConditions	conditions;	/**< the conditionals the file is within */
+	tDeadScan	dead;		/**< where skipDead() is */
+};
+
 static void parseComment(tBuffer *buf);
 static void parseStatement(tBuffer *buf);
 
@@ -39,14 +143,35 @@ static void processBoilerplate(tBuffer *buf);
 static void newFileComment(tBuffer *buf);
 static void processFileComment(tBuffer *buf);
 
-static void processTyped(	char *type, size_t size,
+static void processTyped(	tBuilder *type,
 							bool *isStaticP, bool *inOnlyP,
 							tRange *name );
+static bool nextArgument(tRange *list, tRange *arg);
 static void processArgList(tBuffer *buf);
 static void processDescription(tBuffer *buf);
+static char *trimIndent(tBuffer *buf, char *ptr);
 static void processFunction(tBuffer *buf);
+static void processDocumented(tBuffer *buf);
+static void checkFunction(tBuffer *buf);
+static void exportSlices(tSink *out, const char *label,
+						 tSliceList *sl, const char *base);
+static void exportFunction(tBuffer *buf, bool documented);
 
 static void flushBuffer(tBuffer *buf);
+static void startDescription(tBuffer *buf);
+static bool opensArgList(tBuffer *buf);
+static void skipLabel(tBuffer *buf);
+static bool opensScope(tBuffer *buf);
+static bool opensInitializer(tBuffer *buf);
+static const byte *skipDead(tDeadScan *scan, const byte *p, const byte *end);
+static bool endDirective(tConditions *cond, const tDirective *dir,
+						 tDeadScan *scan);
+static const byte *passDead(tParser *parser, const byte *p, const byte *end,
+							int depthCurly);
+static void walkParser(tParser *parser, const char *data, size_t length,
+					   bool final);
+static size_t findLine(const char *data, size_t length, size_t offset,
+					   long *line, long target);
 
 /*
 	private functions
@@ -62,9 +187,9 @@ static void flushBuffer(tBuffer *buf);
 
 	@brief Mine the comments in a function's body.
 
-	Look for 'todo', 'fixme' or 'note' comments embedded within
-	comments and if found, record them for use later when generating
-	the function's description.
+	Look for comments that start with a marker like 'todo', 'fixme'
+	or 'note' (see keywordutils.c) and if found, record them for use
+	later when generating the function's description.
 	
 	@param[in,out] 	buf 	the tBuffer to process
 */
@@ -72,56 +197,29 @@ static void flushBuffer(tBuffer *buf);
 static void parseComment(tBuffer *buf)
 {
 	char *p;
-	bool match = false;
+	size_t length;
 
 	if (buf->commentStart != NULL)
 	{
 		p = skipPunct(buf->commentStart,buf->ptr);
 		
-		/* look for todos */
-		if (strncasecmp(p,"todo",4) == 0)
-		{
-			match = true;
-			p += 4;
-		}
-		else if (strncasecmp(p,"fixme",5) == 0)
-		{
-			match = true;
-			p += 5;
-		}
-		else if (strncasecmp(p,"fix-me",6) == 0)
+		switch (matchMarker(p, buf->ptr, &length))
 		{
-			match = true;
-			p += 6;
-		}
+		case qKeyTodo:
+			p += length;
+			addSlice(&(buf->arena), &(buf->todos), buf->data,
+				skipPunct(p, buf->ptr),
+				trimComment(buf->ptr, p));
+			break;
 
-		if (match)
-		{
-			addString(&(buf->todos),
+		case qKeyNote:
+			p += length;
+			addSlice(&(buf->arena), &(buf->notes), buf->data,
 				skipPunct(p, buf->ptr),
 				trimComment(buf->ptr, p));
-		}
-		else 
-		{ /* look for notes */
-			if (strncasecmp(p,"note",4) == 0)
-			{
-				match = true;
-				p += 4;
-			}
-			else if (strncasecmp(p,"nb",2) == 0)
-			{
-				match = true;
-				p += 2;
-			}
-			if (match)
-			{
-				addString(&(buf->notes),
-					skipPunct(p, buf->ptr),
-					trimComment(buf->ptr, p));
-			}
+			break;
 		}
 
-		
 		buf->commentStart = NULL;
 	}
 }
@@ -141,13 +239,14 @@ static void parseStatement(tBuffer *buf)
 {
 	char *s,*e,*p;
 	int count;
+	size_t length;
 
 	s = buf->statementStart;
 	if (s != NULL)
 	{
-		if (strncmp(s,"return",6) == 0)
+		if (matchKeyword(s, buf->ptr, &length) == qKeyReturn)
 		{
-			s = skipSpace(s+6, buf->ptr);
+			s = skipSpace(s+length, buf->ptr);
 			e = trimSpace(buf->ptr, s);
 
 			/* if the value is surrounded by brackets, remove them */
@@ -167,7 +266,7 @@ static void parseStatement(tBuffer *buf)
 					e = trimSpace(&e[-1], s);
 				}
 			}
-			addString(&(buf->retvals),s,e);
+			addUniqueSlice(&(buf->arena), &(buf->retvals), buf->data, s, e);
 		}
 
 		buf->statementStart = NULL;
@@ -190,37 +289,8 @@ static void parseStatement(tBuffer *buf)
 
 static void processBoilerplate(tBuffer *buf)
 {
-	FILE	*boilerplate;
-	byte	*tmp;
-	size_t	count;
-
-	if (gOptions.boilerplate != NULL)
-	{
-		tmp = (byte *)malloc(32768);
-		if (tmp == NULL)
-		{
-			fprintf(stderr,"### Error: unable to allocate memory");
-		}
-		else
-		{
-			boilerplate = fopen(gOptions.boilerplate,"r");
-			if (boilerplate == NULL)
-			{
-				fprintf(stderr,
-						"### error: unable to open '%s' to read\n",
-						gOptions.boilerplate);
-				exit(1);		
-			}
-			else
-			{
-				while ((count = fread(tmp,sizeof(byte),32768,boilerplate)) > 0)
-					fwrite(tmp, sizeof(byte), count, buf->file);
-
-				fclose(boilerplate);
-			}
-			free(tmp);			
-		}		
-	}
+	if (sBoilerplate.length > 0)
+		sinkWrite(buf->out, sBoilerplate.data, sBoilerplate.length);
 }
 
 /**
@@ -238,17 +308,17 @@ static void processBoilerplate(tBuffer *buf)
 */
 static void newFileComment(tBuffer *buf)
 {
-	fprintf(buf->file, "/**\n\t@file %s",
-		gOptions.filename != NULL ? gOptions.filename : "<unknown>" );
+	sinkPuts(buf->out, "/**\n\t@file ");
+	sinkPuts(buf->out, buf->filename != NULL ? buf->filename : "<unknown>");
 
-	fprintf(buf->file, "\n\n\tPut a description of the file here.\n");
+	sinkPuts(buf->out, "\n\n\tPut a description of the file here.\n");
 
 	/* insert the boilerplate file, if there is one */
 	processBoilerplate(buf);
 
-	fprintf(buf->file,
+	sinkPuts(buf->out,
 		"\n\t@todo Edit file comment (automatically generated by insertdox)");
-	fprintf(buf->file, "\n*/\n/* $Header$ */\n\n");
+	sinkPuts(buf->out, "\n*/\n/* $Header$ */\n\n");
 }
 
 /**
@@ -275,14 +345,14 @@ static void processFileComment(tBuffer *buf)
 	e = trimComment(e,s);
 
 	/* emit the original comment */
-	fprintf(buf->file, "/**\n\t");
+	sinkPuts(buf->out, "/**\n\t");
 	dumpBlock(buf, s, e);
-	fprintf(buf->file, "\n");
+	sinkChar(buf->out, '\n');
 
 	/* emit boilerplate, if any */
 	processBoilerplate(buf);
 
-	fprintf(buf->file, "\n*/\n");
+	sinkPuts(buf->out, "\n*/\n");
 }
 
 /**
@@ -293,12 +363,18 @@ static void processFileComment(tBuffer *buf)
 	This function is used on both the function name and each of its
 	arguments. It also makes an educated guess about whether the type
 	is input only, or may be used to modify the argument within the
-	function.
+	function. Types it has described before are remembered (see
+	typeutils.c), so each is only taken apart once.
+
+	C++ names keep their qualification ('tFoo::bar'), and destructors
+	and operators their punctuation ('~tFoo', 'operator=='). A
+	template's parameters are left out of the type, and references
+	are described much as pointers are.
 
 	@note isStaticP and inOnlyP will only be set if type is non-NULL
 
-	@param[out] 	type 		a buffer to fill with the type description
-	@param[in]	 	size	 	space available in the type buffer
+	@param[out] 	type 		receives the type description (NULL if
+								only the identifier is wanted)
 	@param[out] 	isStaticP 	set according to whether the type is static
 	@param[out] 	inOnlyP 	set according to educated guess about an
 								argument's direction (true if pass by value
@@ -309,23 +385,27 @@ static void processFileComment(tBuffer *buf)
 
 	@see processArgList()
 	@see processFunction()
-
-	@todo doesn't handle C++&ndash;style references
 */
-static void processTyped(	char *type, size_t size,
+static void processTyped(	tBuilder *type,
 							bool *isStaticP, bool *inOnlyP,
 							tRange *name )
 {
-	char *p;
+	char *p, *q, *w, *decl;
 	char *s = skipSpace(name->start,name->end);
 	char *e	= trimSpace(name->end, name->start);
+	char *last = e;
+	char *qualifier[qMaxQualifiers];
+	size_t qualifierLength[qMaxQualifiers];
+	int  qualifierCount = 0;
 	int  ptrCount = 0;
-	size_t  remaining = size;
+	int  refCount = 0;
+	size_t  length, declLength;
 	bool loop = true;
 	bool isArray = false;
 	bool isStatic = false;
 	bool isConst = false;
 	bool inOnly;
+	int  i;
 
 	/* if [] is present, flag it and remove */
 	--e;
@@ -347,40 +427,161 @@ static void processTyped(	char *type, size_t size,
 	}
 	p += 1;
 
+	/* an operator's name is 'operator' and what follows it
+		('operator==', 'operator bool'), up to the argument list.
+		Only a function's name can be one (or a destructor), and
+		that's the only name asked about without inOnlyP */
+	if (inOnlyP == NULL)
+	{
+		if (isArray && matchKeyword(p, e, &length) == qKeyOperator
+		 && p + length == e)
+		{
+			/* it's 'operator[]', not an array */
+			isArray = false;
+			e = last;
+		}
+		else
+		{
+			w = p;
+			if (p == e)
+			{
+				while (w > s && w[-1] != '\0'
+					&& strchr("+-*/%^&|~!=<>,()[]", w[-1]) != NULL)
+				{
+					--w;
+				}
+			}
+			w = trimSpace(w, s);
+			q = w;
+			while (q > s && (isalnum(q[-1]) || q[-1] == '_'))
+			{
+				--q;
+			}
+			if (q < w && matchKeyword(q, w, &length) == qKeyOperator
+			 && q + length == w)
+			{
+				p = q;
+			}
+			else if (p > s && p[-1] == '~')
+			{
+				--p;	/* a destructor */
+			}
+		}
+	}
+
+	/* add the qualification, e.g. 'tFoo::' or 'tList<T>::' */
+	while (p > s + 1 && p[-1] == ':' && p[-2] == ':')
+	{
+		w = p - 2;
+		if (w > s && w[-1] == '>')
+			w = trimAngles(w, s);
+		while (w > s && (isalnum(w[-1]) || w[-1] == '_'))
+		{
+			--w;
+		}
+		p = w;
+	}
+
 	name->start = p;
 	name->end = e;
 
+	/* described before? (it only depends on the text up to the name) */
+	decl = s;
+	declLength = (p > s) ? (size_t)(p - s) : 0;
+	if (type != NULL && declLength > 0
+	 && recallType(decl, declLength, isArray, type, &isStatic, &inOnly))
+	{
+		if (isStaticP != NULL) *isStaticP = isStatic;
+		if (inOnlyP != NULL) *inOnlyP = inOnly;
+	}
 	/* only do the following if asked */
-	if (type != NULL && size > 0)
+	else if (type != NULL)
 	{
-		*type = '\0';
+		clearBuilder(type);
 
-		while (loop)
+		/* strip off 'static', 'const' and the like */
+		while (loop && s < p)
 		{
-			/* strip off 'static' if it's present */
-			if (strncmp(s,"static",6) == 0)
+			switch (matchKeyword(s, p, &length))
 			{
+			case qKeyStatic:
 				isStatic = true;
-				s = skipSpace(s+6,e);
-			}
-			else if (strncmp(s,"const",5) == 0)			
-			{
+				break;
+
+			case qKeyConst:
 				isConst = true;
-				s = skipSpace(s+5,e);
+				break;
+
+			case qKeyQualifier:
+				if (qualifierCount < qMaxQualifiers)
+				{
+					qualifier[qualifierCount] = s;
+					qualifierLength[qualifierCount++] = length;
+				}
+				break;
+
+			case qKeyIgnored:
+				break;
+
+			case qKeyTemplate:
+				/* leave out 'template<...>' */
+				w = skipSpace(s+length,p);
+				if (w < p && *w == '<')
+					length = skipAngles(w,p) - s;
+				break;
+
+			default:
+				loop = false;
+				continue;
 			}
-			else loop = false;
+			s = skipSpace(s+length,e);
 		}
 		if (isStaticP != NULL) *isStaticP = isStatic;
 
 		e = trimSpace(p,s);
 		--e; /* because it normally points after the actual character */
-		while (e > s && *e == '*')
+		loop = true;
+		while (loop && e > s)
 		{
-			++ptrCount;
-			--e;
-			while (e > s && isspace(*e))
+			if (*e == '*' || *e == '&')
 			{
+				/* described from the name outwards */
+				if (*e == '*')
+				{
+					++ptrCount;
+					appendString(type, "a pointer to ");
+				}
+				else if (e[-1] == '&')
+				{
+					++refCount;
+					appendString(type, "an rvalue reference to ");
+					--e;
+				}
+				else
+				{
+					++refCount;
+					appendString(type, "a reference to ");
+				}
 				--e;
+				while (e > s && isspace(*e))
+				{
+					--e;
+				}
+			}
+			else
+			{
+				/* leave out words like 'restrict' that follow a '*' */
+				w = e + 1;
+				while (w > s && (isalnum(w[-1]) || w[-1] == '_'))
+				{
+					--w;
+				}
+				loop = (w > s && matchKeyword(w, e + 1, &length) == qKeyIgnored
+						&& w + length == e + 1);
+				if (loop)
+				{
+					e = trimSpace(w, s) - 1;
+				}
 			}
 		}
 		++e; /* put it back to normal */
@@ -388,50 +589,80 @@ static void processTyped(	char *type, size_t size,
 		 /* guess if the parameter cannot be modified by the function
 			(basically if it's const, or pass by value).
 			Very easily fooled by typdefs and #defines */
-		inOnly = (bool)(isConst || (ptrCount == 0 && !isArray));
+		inOnly = (bool)(isConst || (ptrCount == 0 && refCount == 0 && !isArray));
 		if (inOnlyP != NULL) *inOnlyP = inOnly;
 
-		while (ptrCount--)
-		{
-			strncat(type, "a pointer to ", remaining);
-			remaining -= 13; /* length of "pointer to " */
-		}
-
 		if (isArray)
 		{
-			strncat(type, "an array of ", remaining);
-			remaining -= 12; /* length of "an array of " */
+			appendString(type, "an array of ");
 		}
 #ifdef qTypePrefixedWithA
 		else
 		{
 			if (!isConst && strchr("aeiouAEIOU",*s) != NULL)
-			{
-				strncat(type, "an ", remaining);
-				remaining -= 3;
-			}
+				appendString(type, "an ");
 			else
-			{
-				strncat(type, "a ", remaining);
-				remaining -= 2;			
-			}
+				appendString(type, "a ");
 		}
 #endif
 
 		if (isConst)
 		{
-			strncat(type, "const ", remaining);
-			remaining -= 6; /* length of "const " */
+			appendString(type, "const ");
 		}
 
-		/* output the type */
-		if ((size_t)(e - s) < remaining)
+		for (i = 0; i < qualifierCount; ++i)
 		{
-			remaining = (e - s);
+			appendBlock(type, qualifier[i], qualifierLength[i]);
+			appendString(type, " ");
 		}
 
-		strncat(type, s, remaining);
+		/* output the type */
+		if (e > s)
+			appendBlock(type, s, e - s);
+		else
+			appendString(type, "");	/* so it's never NULL */
+
+		if (declLength > 0)
+			rememberType(decl, declLength, isArray, type, isStatic, inOnly);
+	}
+}
+
+/**
+	@internal
+
+	@brief Finds the next argument in a function's argument list.
+
+	A comma or bracket within a template's arguments, as in
+	'map<int, int> m', doesn't end the argument.
+
+	@param[in,out] 	list 	the rest of the argument list, after the
+							opening bracket; moved past the argument
+	@param[out] 	arg 	receives the argument's declaration
+
+	@return true if there was another argument
+*/
+static bool nextArgument(tRange *list, tRange *arg)
+{
+	char	*p;
+	int		depthAngle = 0;
+
+	for (p = list->start; p < list->end; ++p)
+	{
+		if (*p == '<')
+			++depthAngle;
+		else if (*p == '>' && depthAngle > 0)
+			--depthAngle;
+		else if (depthAngle == 0 && (*p == ',' || *p == ')'))
+		{
+			/* list seperator or terminator */
+			arg->start = list->start;
+			arg->end = p;
+			list->start = p + 1;
+			return true;
+		}
 	}
+	return false;
 }
 
 /**
@@ -442,7 +673,7 @@ static void processTyped(	char *type, size_t size,
 	Generates a list of \@param tags from the list
 	of arguments to a function.
 
-	@note Does not emit 'void'.
+	@note Does not emit 'void', or an empty list.
 
 	@param[in,out] 	buf 	the tBuffer to process
 	
@@ -450,49 +681,39 @@ static void processTyped(	char *type, size_t size,
 */
 static void processArgList(tBuffer *buf)
 {
-	tRange	name;
-	char	type[200];
-	char	*s = buf->arglist.start;
-	char	*e = buf->arglist.end;
-	char	*p;
+	tRange	list, name;
+	tBuilder	*type = &buf->argType;
 	bool	inOnly;
 
 	bool saidSomething = false;
 
-	while (s < e && (isspace(*s) || *s == '('))
+	list.start = buf->arglist.start;
+	list.end = buf->arglist.end;
+	while (list.start < list.end && (isspace(*list.start) || *list.start == '('))
 	{
-		++s;
+		++list.start;
 	}
-	p = s;
 
-	while (p < e)
+	while (nextArgument(&list, &name))
 	{
-		switch (*p)
+		processTyped(type, NULL, &inOnly, &name);
+
+		if (name.end > name.start
+		 && ((name.end - name.start) != 4
+		  || strncmp(name.start, "void", 4) != 0))
 		{
-		case ',': /* list seperator */
-		case ')': /* list terminator */
-			name.start = s;
-			name.end = p;
-			processTyped(type, sizeof(type), NULL, &inOnly, &name);
-			
-			if ((name.end - name.start) != 4
-			 || strncmp(name.start, "void", 4) != 0)
-			{
-				/* not 'void', so output it */
-				fprintf(buf->file,
-					"\n\t@param[in%s] \t", inOnly? "" : ",out");
-				dumpBlock(buf, name.start, name.end);
-				fprintf(buf->file," \t%s",type);
-				
-				saidSomething = true;
-			}
-			s = p + 1;
-			break;
+			/* not 'void', so output it */
+			sinkPuts(buf->out,
+				inOnly ? "\n\t@param[in] \t" : "\n\t@param[in,out] \t");
+			dumpBlock(buf, name.start, name.end);
+			sinkPuts(buf->out, " \t");
+			sinkWrite(buf->out, type->data, type->length);
+
+			saidSomething = true;
 		}
-		++p;
 	}
 	if (saidSomething)
-		fprintf(buf->file, "\n");	
+		sinkChar(buf->out, '\n');
 }
 
 /**
@@ -542,10 +763,31 @@ static void processDescription(tBuffer *buf)
 	if (buf->description.count == 0)
 	{
 		/* inject a placeholder */
-		fprintf(buf->file, "Brief description needed.");
-		fprintf(buf->file, "\n\n\tFollowed by a more complete description.");
+		sinkPuts(buf->out, "Brief description needed.");
+		sinkPuts(buf->out, "\n\n\tFollowed by a more complete description.");
 	}
-	fprintf(buf->file, "\n");
+	sinkChar(buf->out, '\n');
+}
+
+/**
+	@internal
+
+	Moves a pointer back past the indentation before it, as
+	a method's is in a class, if there's nothing else before
+	it on the line.
+
+	@param[in] 	buf 	the tBuffer ptr is in
+	@param[in] 	ptr 	the first character after the indentation
+
+	@return the start of the line, or ptr if it's not indented
+*/
+static char *trimIndent(tBuffer *buf, char *ptr)
+{
+	char *p = ptr;
+
+	while (p > buf->data && (p[-1] == ' ' || p[-1] == '\t'))
+		--p;
+	return (p == buf->data || p[-1] == '\n' || p[-1] == '\r') ? p : ptr;
 }
 
 /**
@@ -562,43 +804,64 @@ static void processDescription(tBuffer *buf)
 static void processFunction(tBuffer *buf)
 {
 	tRange name;
-	char type[200];
+	tBuilder *type = &buf->type;
 	bool isStatic;
+	bool ownLine = false;
 
 	/* fixup the description range, if there isn't one.
 		makes subsequent code simpler. */
 	if (buf->description.count == 0)
 	{
-		buf->description.start = buf->function.start - 1;
+		buf->description.start = trimIndent(buf, buf->function.start);
+		if (buf->description.start > buf->data)
+			--buf->description.start;
+		else
+		{
+			/* there's no line ending before the function to put the
+				comment in front of (e.g. after a directive), so the
+				comment needs one of its own, or the indentation would
+				follow it */
+			ownLine = true;
+		}
 		buf->description.end = buf->description.start;
 	}
+	else
+	{
+		/* the new comment replaces the old one's indentation, too */
+		buf->description.start = trimIndent(buf, buf->description.start);
+	}
 	/* emit up to the beginning of the description */
 	dumpBlock(buf, buf->data, buf->description.start);
 
 	name.start = buf->function.start;
 	name.end = buf->function.end;
-	processTyped(type, sizeof(type), &isStatic, NULL, &name);
+	processTyped(type, &isStatic, NULL, &name);
 
-	fprintf(buf->file, "\n/**\n%s\t", isStatic ? "\t@internal\n\n" : "");
+	sinkPuts(buf->out, isStatic ? "\n/**\n\t@internal\n\n\t" : "\n/**\n\t");
+	++buf->functions;
 
 	processDescription(buf);
 
 	processArgList(buf);
 
-	if (strcmp(type,"void") != 0)
+	/* (constructors and destructors have no type at all) */
+	if (type->length > 0 && strcmp(type->data,"void") != 0)
 	{
-		fprintf(buf->file, "\n\t@return %s", type);
-		dumpStringList(buf->file, buf->retvals, "\t@retval ");
-		fprintf(buf->file, "\n");
+		sinkPuts(buf->out, "\n\t@return ");
+		sinkWrite(buf->out, type->data, type->length);
+		dumpSliceList(buf->out, buf->retvals.first, buf->data, "\t@retval ");
+		sinkChar(buf->out, '\n');
 	}
 
-	dumpStringList(buf->file, buf->todos,"\t@todo ");
-	fprintf(buf->file, "\n\t@todo edit me (automatically generated by insertdox)\n*/");
+	dumpSliceList(buf->out, buf->todos, buf->data, "\t@todo ");
+	sinkPuts(buf->out, "\n\t@todo edit me (automatically generated by insertdox)\n*/");
+	if (ownLine)
+		sinkChar(buf->out, '\n');
 	
 	if (gOptions.onlyPrototypes)
 	{
 		dumpBlock(buf, buf->description.end, buf->arglist.end);
-		fprintf(buf->file, ";\n\n");
+		sinkPuts(buf->out, ";\n\n");
 	}
 	else
 	{
@@ -606,6 +869,192 @@ static void processFunction(tBuffer *buf)
 	}
 }
 
+/**
+	@internal
+
+	@brief Process a function that already has a Doxygen comment.
+
+	This will be the case if the file has been through insertdox
+	before, so the function is passed through as it is, and running
+	insertdox again doesn't change the output.
+
+	@param[in,out] 	buf 	the tBuffer to process
+*/
+static void processDocumented(tBuffer *buf)
+{
+	++buf->documented;
+
+	if (gOptions.onlyPrototypes)
+	{
+		/* the whitespace before it has been dropped */
+		sinkChar(buf->out, '\n');
+		dumpBlock(buf, buf->data, buf->arglist.end);
+		sinkPuts(buf->out, ";\n\n");
+	}
+	else
+	{
+		dumpBlock(buf, buf->data, buf->ptr);
+	}
+}
+
+/**
+	@internal
+
+	@brief Check for a function without a Doxygen comment (--check).
+
+	Used instead of all of the above, so nothing is output except
+	a line for each function that needs a comment, giving its
+	name and the line it's on, e.g.
+	@verbatim parser.c:120: parseComment @endverbatim
+
+	@param[in,out] 	buf 	the tBuffer to check
+*/
+static void checkFunction(tBuffer *buf)
+{
+	tRange name;
+	char line[32];
+
+	if (!buf->spilling
+	 && buf->function.start != NULL
+	 && buf->function.count == 1
+	 && buf->arglist.count == 1
+	 && buf->body.count == 1)
+	{
+		if (buf->description.count > 0
+		 && isDoxyComment(buf->description.start, buf->description.end))
+		{
+			++buf->documented;
+		}
+		else
+		{
+			++buf->missing;
+
+			name.start = buf->function.start;
+			name.end = buf->function.end;
+			processTyped(NULL, NULL, NULL, &name);
+			countLines(buf, buf->data, name.start);
+
+			sinkPuts(buf->out, buf->filename != NULL ? buf->filename : "<stdin>");
+			sprintf(line, ":%ld: ", buf->line);
+			sinkPuts(buf->out, line);
+			dumpBlock(buf, name.start, name.end);
+			sinkChar(buf->out, '\n');
+
+			countLines(buf, name.start, buf->ptr);
+			return;
+		}
+	}
+	countLines(buf, buf->data, buf->ptr);
+}
+
+/**
+	@internal
+
+	Writes a list of strings pulled from a function, as a
+	member of its record (see exportFunction()).
+
+	@param[out] out 	where to write the list
+	@param[in] 	label 	the member's name, with the comma before it
+	@param[in] 	sl 		the list
+	@param[in] 	base 	what the slices are relative to
+*/
+static void exportSlices(tSink *out, const char *label,
+						 tSliceList *sl, const char *base)
+{
+	tSliceList	*element;
+
+	sinkPuts(out, label);
+	sinkPuts(out, ":[");
+	for (element = sl; element != NULL; element = element->next)
+	{
+		if (element != sl)
+			sinkChar(out, ',');
+		sinkQuoted(out, &base[element->start], element->end - element->start);
+	}
+	sinkChar(out, ']');
+}
+
+/**
+	@internal
+
+	@brief Record a function, for --symbols.
+
+	Writes what's known about the function to the buffer's symbols,
+	as a line of JSON, so tools can index the code without having
+	to parse the comments back out again, e.g.
+	@verbatim
+{"file":"parser.c","line":120,"name":"parseComment","static":true,
+ "documented":false,"returns":"void","params":[{"name":"buf",
+ "type":"a pointer to tBuffer","direction":"in,out"}],
+ "retvals":[],"todos":[],"notes":[]}
+	@endverbatim
+	(all on one line). Also keeps count of the lines, to know
+	which one the function is on.
+
+	@param[in,out] 	buf 		the tBuffer holding the function
+	@param[in] 		documented 	whether it already has a Doxygen comment
+*/
+static void exportFunction(tBuffer *buf, bool documented)
+{
+	tSink	*out = buf->symbols;
+	tRange	list, name;
+	tBuilder	*type = &buf->type;
+	char	number[32];
+	char	*counted;
+	bool	isStatic, inOnly;
+	bool	first = true;
+
+	name.start = buf->function.start;
+	name.end = buf->function.end;
+	processTyped(type, &isStatic, NULL, &name);
+	countLines(buf, buf->data, name.start);
+	counted = name.start;
+
+	sinkPuts(out, "{\"file\":");
+	sinkQuoted(out, buf->path, strlen(buf->path));
+	sprintf(number, ",\"line\":%ld", buf->line);
+	sinkPuts(out, number);
+	sinkPuts(out, ",\"name\":");
+	sinkQuoted(out, name.start, name.end - name.start);
+	sinkPuts(out, isStatic ? ",\"static\":true" : ",\"static\":false");
+	sinkPuts(out, documented ? ",\"documented\":true" : ",\"documented\":false");
+	sinkPuts(out, ",\"returns\":");
+	sinkQuoted(out, type->data, type->length);
+
+	/* the same arguments as processArgList() finds */
+	sinkPuts(out, ",\"params\":[");
+	list.start = buf->arglist.start;
+	list.end = buf->arglist.end;
+	while (list.start < list.end && (isspace(*list.start) || *list.start == '('))
+	{
+		++list.start;
+	}
+	while (nextArgument(&list, &name))
+	{
+		processTyped(&buf->argType, NULL, &inOnly, &name);
+		if (name.end > name.start
+		 && ((name.end - name.start) != 4
+		  || strncmp(name.start, "void", 4) != 0))
+		{
+			sinkPuts(out, first ? "{\"name\":" : ",{\"name\":");
+			sinkQuoted(out, name.start, name.end - name.start);
+			sinkPuts(out, ",\"type\":");
+			sinkQuoted(out, buf->argType.data, buf->argType.length);
+			sinkPuts(out, inOnly ? ",\"direction\":\"in\"}"
+								 : ",\"direction\":\"in,out\"}");
+			first = false;
+		}
+	}
+	sinkChar(out, ']');
+
+	exportSlices(out, ",\"retvals\"", buf->retvals.first, buf->data);
+	exportSlices(out, ",\"todos\"", buf->todos, buf->data);
+	exportSlices(out, ",\"notes\"", buf->notes, buf->data);
+	sinkPuts(out, "}\n");
+
+	countLines(buf, counted, buf->ptr);
+}
+
 /*
 	public functions
 */
@@ -623,82 +1072,1068 @@ static void processFunction(tBuffer *buf)
 */
 static void flushBuffer(tBuffer *buf)
 {
+	bool	documented;
+	bool	counted = (bool)gOptions.check;	/* checkFunction() counts them */
+
 	if (buf->ptr > buf->data)
 	{
-		if (buf->fileComment) 
+		if (gOptions.check)
+			checkFunction(buf);
+		else if (buf->fileComment) 
 		{
-			processFileComment(buf);
+			/* leave an existing Doxygen file comment alone */
+			if (isDoxyComment(skipSpace(buf->data, buf->ptr), buf->ptr))
+			{
+				dumpBlock(buf, buf->data, buf->ptr);
+				if (gOptions.onlyPrototypes)
+					sinkChar(buf->out, '\n');
+			}
+			else
+				processFileComment(buf);
 		}
-		else if (buf->function.count == 1
+		/* (a comment within the declaration loses its start) */
+		else if (!buf->spilling
+			 && buf->function.start != NULL
+			 && buf->function.count == 1
 			 && buf->arglist.count == 1
 			 && buf->body.count == 1)
 		{
-			processFunction(buf);
+			documented = (bool)(buf->description.count > 0
+				&& isDoxyComment(buf->description.start, buf->description.end));
+			if (documented)
+				processDocumented(buf);
+			else
+				processFunction(buf);
+
+			if (buf->symbols != NULL)
+			{
+				exportFunction(buf, documented);
+				counted = true;
+			}
 		}
 		else if (!gOptions.onlyPrototypes)
 		{
 			dumpBlock(buf, buf->data, buf->ptr);
 		}
+
+		/* keep count of the lines, for the records */
+		if (buf->symbols != NULL && !counted)
+			countLines(buf, buf->data, buf->ptr);
+
+		/* a type that couldn't be described is an allocation that failed */
+		if (buf->type.failed || buf->argType.failed)
+			buf->out->failed = true;
 	}
 	clearBuffer(buf);
 }
 
 /**
-	@brief Controls the meat of the processing.
-
-	Basically a state machine, which accumulates the incoming
-	stream of characters and chops them up into meaningful
-	chunks, then passes	those chunks off to other routines
-	to further process and output.
+	@internal
 
-	@param[in] 	inFile		the file to process
-	@param[out] outFile 	where to write the result
+	Flushes the buffer at the start of a comment at the top level,
+	which may be the description of a function. The comment's
+	indentation is kept with it, so a new comment can replace both.
 
-	@return int
-	@retval 0		everything went smoothly
-	@retval -108	unable to allocate memory
+	@param[in,out] 	buf 	the tBuffer, just before the comment
 */
-int processFile(FILE *outFile, FILE *inFile)
+static void startDescription(tBuffer *buf)
 {
-	tBuffer *buf;
-	int		prevc, c, nextc;	/* needs to be int to hold EOF */
-	int		depthCurly,depthRound;
-	bool	inComment, inCppComment;
-	bool	inPreprocessor;
-	bool	inSingleQuotes, inDoubleQuotes;
-	bool	inBetween, isLiteral, isChar1;
-	bool	atStart, doFlush;
+	char	indent[qMaxIndent];
+	char	*p = trimIndent(buf, buf->ptr);
+	size_t	length = buf->ptr - p;
 
-	buf = (tBuffer *)malloc(sizeof(tBuffer));
-	if (buf == NULL)
-	{
-		fprintf(stderr,
-				"### error: unable to allocate a buffer\n");
-		return (-108);
-	}
+	if (length > qMaxIndent)
+		length = 0;
 
-	initBuffer(buf,outFile);
+	memcpy(indent, buf->ptr - length, length);
+	buf->ptr -= length;
+	flushBuffer(buf);
+	emitBlock(buf, indent, length);
 
-	depthCurly = 0;
-	depthRound = 0;
-	isLiteral = false;
+	buf->description.start = buf->ptr;
+}
+
+/**
+	@internal
+
+	Decides whether a round bracket at the top level opens the
+	argument list of what might be a function. It doesn't if it's
+	within a template's arguments ('function<void(int)> f'), or
+	if it's the operator in 'operator()', or if it follows an
+	argument list, as in a constructor's initializers (': a(x)')
+	or 'noexcept(true)'.
+
+	@param[in] 	buf 	the tBuffer, just before the bracket
+
+	@return true if it's an argument list
+*/
+static bool opensArgList(tBuffer *buf)
+{
+	char	*p, *e, *w;
+	size_t	length;
+	int		depthAngle = 0;
+
+	if (buf->function.count == 1 && buf->arglist.count == 1)
+	{
+		p = skipSpace(buf->arglist.end, buf->ptr);
+		return (bool)!(p < buf->ptr
+			&& (*p == ':' || *p == '-'
+			 || matchKeyword(p, buf->ptr, &length) == qKeyTrailing));
+	}
+
+	p = buf->function.start;
+	if (p == NULL || buf->function.count != 0)
+		return true;
+
+	/* 'operator()' */
+	e = trimSpace(buf->ptr, p);
+	w = e;
+	while (w > p && (isalnum(w[-1]) || w[-1] == '_'))
+	{
+		--w;
+	}
+	if (w < e && matchKeyword(w, e, &length) == qKeyOperator && w + length == e)
+		return false;
+
+	e = buf->ptr;
+	if (memchr(p, '<', e - p) == NULL)
+		return true;
+
+	for (; p < e; ++p)
+	{
+		if (*p == '<')
+			++depthAngle;
+		else if (*p == '>' && depthAngle > 0 && p[-1] != '-')
+			--depthAngle;
+		else if ((isalpha(*p) || *p == '_')
+			 && (p == buf->function.start || !(isalnum(p[-1]) || p[-1] == '_'))
+			 && matchKeyword(p, e, &length) == qKeyOperator)
+		{
+			/* the rest is the operator (see processTyped()) */
+			return (bool)(skipSpace(p + length, e) < e);
+		}
+	}
+	return (bool)(depthAngle == 0);
+}
+
+/**
+	@internal
+
+	Leaves the labels in a class ('public:' and the like) out of
+	the declaration of a function that follows them, so its
+	comment is inserted after them. A comment before the label
+	isn't the function's description.
+
+	@param[in,out] 	buf 	the tBuffer, at a function's argument list
+*/
+static void skipLabel(tBuffer *buf)
+{
+	char	*p = buf->function.start;
+	size_t	length;
+
+	while (p != NULL && matchKeyword(p, buf->ptr, &length) == qKeyAccess)
+	{
+		p = skipSpace(p + length, buf->ptr);
+		while (p < buf->ptr && isalpha(*p)) /* e.g. 'public slots:' */
+			++p;
+		p = skipSpace(p, buf->ptr);
+		if (p + 1 >= buf->ptr || p[0] != ':' || p[1] == ':')
+			return;
+
+		buf->function.start = skipSpace(p + 1, buf->ptr);
+		p = buf->function.start;
+
+		buf->description.count = 0;
+		buf->description.start = NULL;
+		buf->description.end = NULL;
+	}
+}
+
+/**
+	@internal
+
+	Decides whether a curly bracket at the top level opens a block
+	of declarations: a namespace, a class (or a struct or union,
+	which may have functions inside, in C++), or 'extern "C"'.
+	'struct tFoo x = {' is just data.
+
+	@param[in] 	buf 	the tBuffer, just before the bracket
+
+	@return true if it opens a block of declarations
+*/
+static bool opensScope(tBuffer *buf)
+{
+	char	*p = buf->function.start;
+	size_t	length;
+
+	if (p == NULL || memchr(p, '=', buf->ptr - p) != NULL)
+		return false;
+
+	switch (matchKeyword(p, buf->ptr, &length))
+	{
+	case qKeyTemplate:
+		p = skipSpace(p + length, buf->ptr);
+		if (p < buf->ptr && *p == '<')
+			p = skipSpace(skipAngles(p, buf->ptr), buf->ptr);
+		return (bool)(matchKeyword(p, buf->ptr, &length) == qKeyScope);
+
+	case qKeyScope:
+		return true;
+
+	case qKeyIgnored:	/* extern "C" */
+		p = skipSpace(p + length, buf->ptr);
+		return (bool)(p < buf->ptr && *p == '"');
+	}
+	return false;
+}
+
+/**
+	@internal
+
+	Decides whether a curly bracket at the top level initializes a
+	member, within a constructor's initializers (': a{x}'), rather
+	than opening the constructor's body. nextBoundary() relies on
+	this only being so after a ':', and right after a name.
+
+	@param[in] 	buf 	the tBuffer, just before the bracket
+
+	@return true if it's an initializer
+*/
+static bool opensInitializer(tBuffer *buf)
+{
+	char	*p;
+
+	if (buf->function.count != 1 || buf->arglist.count != 1)
+		return false;
+
+	p = skipSpace(buf->arglist.end, buf->ptr);
+	if (p + 1 >= buf->ptr || p[0] != ':' || p[1] == ':')
+		return false;
+
+	p = trimSpace(buf->ptr, p);
+	return (bool)(isalnum(p[-1]) || p[-1] == '_' || p[-1] == '>');
+}
+
+/**
+	@internal
+
+	Passes over a branch that's compiled out, looking for the next
+	directive. All that's followed is where the comments and literals
+	are, so that a '#' within one isn't taken for a directive (a
+	literal ends with its line, if it hasn't already, as it does
+	for a compiler). Braces and the rest are just text.
+
+	@param[in,out] 	scan 	where the scan has got to, which is
+							carried on to the next block
+	@param[in] 		p 		the first character to look at
+	@param[in] 		end 	points just past the last character
+
+	@return where the '#' is that starts the next directive,
+			or end if there isn't one before it
+*/
+static const byte *skipDead(tDeadScan *scan, const byte *p, const byte *end)
+{
+	const byte	*run;
+	int		c;
+
+	while (p < end)
+	{
+		/* the fast path: until the start of the next line,
+			only a few characters need looking at */
+		if (!scan->isChar1)
+		{
+			run = p;
+			while (p < end && (sSignificant[*p] & qInDead) == 0)
+				++p;
+			if (p > run)
+				scan->prevc = p[-1];
+			if (p == end)
+				break;
+		}
+
+		c = *p;
+		if (scan->isLiteral)
+			scan->isLiteral = false;
+		else if (scan->inComment)
+		{
+			if (scan->inCppComment ? (c == '\n' || c == '\r')
+								   : (scan->prevc == '*' && c == '/'))
+			{
+				scan->inComment = false;
+				scan->inCppComment = false;
+				c = '\0';	/* so it can't start another */
+			}
+		}
+		else if (scan->quote != 0)
+		{
+			if (c == scan->quote || c == '\n' || c == '\r')
+				scan->quote = 0;
+			else if (c == '\\')
+				scan->isLiteral = true;
+		}
+		else
+		{
+			switch (c)
+			{
+			case '*':
+				if (scan->prevc == '/')
+				{
+					scan->inComment = true;
+					c = '\0';	/* so it can't end it */
+				}
+				break;
+
+			case '/':
+				if (scan->prevc == '/')
+				{
+					scan->inComment = true;
+					scan->inCppComment = true;
+				}
+				break;
+
+			case '\'':
+			case '"':
+				scan->quote = c;
+				break;
+
+			case '#':
+				if (scan->isChar1)
+					return p;
+				break;
+			}
+		}
+
+		if (c == '\n' || c == '\r')
+			scan->isChar1 = true;
+		else if (!isspace(c) && c != '\0')
+			scan->isChar1 = false;
+
+		scan->prevc = c;
+		++p;
+	}
+
+	return end;
+}
+
+/**
+	@internal
+
+	Follows a directive that's just ended (see followDirective()),
+	and if the lines after it are compiled out, gets ready to pass
+	over them with skipDead().
+
+	@param[in,out] 	cond 	the conditionals the file is within
+	@param[in] 		dir 	the directive
+	@param[out] 	scan 	set up for skipDead(), if it's needed
+
+	@return true if the lines after it are compiled out
+*/
+static bool endDirective(tConditions *cond, const tDirective *dir,
+						 tDeadScan *scan)
+{
+	if (!followDirective(cond, dir))
+		return false;
+
+	scan->prevc = '\0';
+	scan->quote = 0;
+	scan->inComment = false;
+	scan->inCppComment = false;
+	scan->isLiteral = false;
+	scan->isChar1 = true;
+
+	return true;
+}
+
+/**
+	@internal
+
+	Passes a branch that's compiled out through to the output
+	untouched, as far as the next directive (see skipDead()).
+	At the top level, none of it can be part of a function, so
+	it isn't kept in the buffer any longer than it has to be.
+
+	@param[in,out] 	parser 	 	the tParser that's skipping
+	@param[in] 		p 		 	the first character to pass through
+	@param[in] 		end 	 	points just past the last character
+	@param[in] 		depthCurly 	how deeply nested in curly brackets,
+								counting from the top level (see tParser::depthScope)
+
+	@return where the '#' is that starts the next directive,
+			or end if there isn't one before it
+*/
+static const byte *passDead(tParser *parser, const byte *p, const byte *end,
+							int depthCurly)
+{
+	tBuffer	*buf = &parser->buf;
+	const byte	*stop;
+
+	stop = skipDead(&parser->dead, p, end);
+
+	if (depthCurly == 0)
+		buf->spilling = true;
+
+	if (emitBlock(buf, (const char *)p, stop - p) != 0)
+	{
+		/* no room for it, so pass the function through */
+		flushBuffer(buf);
+		buf->spilling = true;
+		++buf->overflows;
+		emitBlock(buf, (const char *)p, stop - p);
+	}
+
+	if (depthCurly == 0 && stop < end)
+		buf->spilling = false;
+
+	return stop;
+}
+
+/**
+	Loads the 'boilerplate' file, to be injected into every
+	file comment. It's read just once, before any files are
+	processed, and kept in memory.
+
+	@param[in] 	filename 	the boilerplate file
+
+	@return int
+	@retval 0		all is well
+	@retval -36		unable to read the file
+	@retval -43		the file doesn't exist, or can't be opened
+	@retval -108	unable to allocate memory
+*/
+int loadBoilerplate(const char *filename)
+{
+	FILE	*file;
+	int		result;
+
+	file = fopen(filename, "r");
+	if (file == NULL)
+		return (-43);
+
+	result = readSource(&sBoilerplate, file);
+	fclose(file);
+
+	if (result != 0)
+		freeSource(&sBoilerplate);
+
+	return result;
+}
+
+/**
+	Releases the boilerplate loaded by loadBoilerplate().
+*/
+void freeBoilerplate(void)
+{
+	freeSource(&sBoilerplate);
+}
+
+/**
+	Sets a tBoundary to the start of a file.
+
+	@param[out] 	at 	the tBoundary to set
+*/
+void firstBoundary(tBoundary *at)
+{
+	at->offset = 0;
+	at->prevc = '\0';
+	at->isChar1 = true;
+	at->line = 1;
+}
+
+/**
+	Finds the next boundary in a file (see tBoundary).
+
+	This is a stripped down copy of the state machine in walkParser(),
+	which only follows the state needed to find the places where the
+	parser flushes its buffer at the top level, so it's a good deal
+	quicker than parsing the file. The two must be kept in step;
+	the differential test checks that they are (see atBoundary()).
+
+	@param[in] 		data 	the whole file
+	@param[in] 		length 	the number of characters in data
+	@param[in,out] 	at 	 	a boundary (see firstBoundary()); moved
+							to the next one, if there is one
+
+	@return true if another boundary was found
+*/
+bool nextBoundary(const char *data, size_t length, tBoundary *at)
+{
+	const byte *p, *end, *run;
+	char	ch;
+	int		prevc, lastc, c, nextc;
+	int		depthCurly, depthRound;
+	bool	inComment, inCppComment;
+	bool	inPreprocessor;
+	bool	inSingleQuotes, inDoubleQuotes;
+	bool	inBetween, isLiteral, isChar1;
+	bool	afterColon, inInitializer;
+	bool	doFlush;
+	bool	conditional, skipping;
+	long	line;
+	tDirective	dir;
+	tConditions	cond;
+	tDeadScan	dead;
+
+	prevc = at->prevc;
+	lastc = '\0';
+	isChar1 = at->isChar1;
+	line = at->line;
+	depthCurly = 0;
+	depthRound = 0;
 	inComment = false;
 	inCppComment = false;
 	inPreprocessor = false;
 	inSingleQuotes = false;
 	inDoubleQuotes = false;
-	atStart = true;
 	inBetween = true;
-	isChar1 = true;
+	isLiteral = false;
+	afterColon = false;
+	inInitializer = false;
+
+	/* a boundary is always outside the conditionals (see isSettled()) */
+	conditional = haveMacros();
+	skipping = false;
+	clearDirective(&dir);
+	initConditions(&cond);
+
+	p = (const byte *)&data[at->offset];
+	end = (const byte *)&data[length];
+
+	while (p < end)
+	{
+		if (skipping)
+		{
+			run = p;
+			p = skipDead(&dead, p, end);
+
+			/* counted as below */
+			while (run < p)
+			{
+				c = *run++;
+				if (c == '\r' || (c == '\n' && prevc != '\r'))
+					++line;
+				prevc = c;
+			}
+			if (p == end)
+				break;
+
+			isChar1 = true;
+			skipping = false;
+		}
+
+		c = *p++;
+		nextc = (p < end) ? *p : EOF;
+		doFlush = false;
+
+		/* counted as countLines() does */
+		if (c == '\r' || (c == '\n' && prevc != '\r'))
+			++line;
+
+		if (isLiteral)
+		{
+			if ((c != '\r' || nextc != '\n')
+			 && (c != '\n' || nextc != '\r'))
+			{
+				isLiteral = false;
+			}
+		}
+		else if (inComment)
+		{
+			if (inCppComment)
+			{
+				if (c == '\n' || c == '\r')
+				{
+					if (inPreprocessor && conditional)
+						skipping = endDirective(&cond, &dir, &dead);
+					inCppComment = false;
+					inComment = false;
+					inPreprocessor = false;
+					isChar1 = true;
+				}
+			}
+			else if (prevc == '*' && c == '/')
+			{
+				inComment = false;
+				if (inPreprocessor && conditional)
+					addToDirective(&dir, " ", 1);
+			}
+		}
+		else if (inPreprocessor)
+		{
+			if (c == '\n' || c == '\r')
+			{
+				/* walkParser() flushes here too, but it only
+					starts afresh between statements */
+				doFlush = (bool)(depthCurly == 0 && depthRound == 0 && inBetween);
+				if (conditional)
+					skipping = endDirective(&cond, &dir, &dead);
+				inPreprocessor = false;
+				isChar1 = true;
+			}
+			else if (c == '\\' && (nextc == '\n' || nextc == '\r'))
+			{
+				/* carried on to the next line */
+				isLiteral = true;
+				if (conditional)
+					addToDirective(&dir, " ", 1);
+			}
+			else if (c == '/' && (nextc == '/' || nextc == '*'))
+			{
+				inComment = true;
+				inCppComment = (bool)(nextc == '/');
+			}
+			else if (conditional)
+			{
+				ch = (char)c;
+				addToDirective(&dir, &ch, 1);
+			}
+		}
+		else if (inSingleQuotes)
+		{
+			if (c == '\'')
+				inSingleQuotes = false;
+			else if (c == '\\')
+				isLiteral = true;
+		}
+		else if (inDoubleQuotes)
+		{
+			if (c == '"')
+				inDoubleQuotes = false;
+			else if (c == '\\')
+				isLiteral = true;
+		}
+		else {
+			switch (c)
+			{
+			case '\\':
+				isLiteral = true;
+				break;
+
+			case '/':
+				if (nextc == '/' || nextc == '*')
+				{
+					inComment = true;
+					inCppComment = (bool)(nextc == '/');
+				}
+				break;
+
+			case '#':
+				if (isChar1)
+				{
+					inPreprocessor = true;
+					clearDirective(&dir);
+				}
+				break;
+
+			case '\'':
+				inSingleQuotes = true;
+				break;
+
+			case '"':
+				inDoubleQuotes = true;
+				break;
+
+			case '(':
+				++depthRound;
+				break;
+
+			case ')':
+				--depthRound;
+				break;
+
+			case ':':
+				/* as in a constructor's initializers (not '::') */
+				if (depthCurly == 0 && depthRound == 0
+				 && prevc != ':' && nextc != ':')
+				{
+					afterColon = true;
+				}
+				inBetween = false;
+				break;
+
+			case '{':
+				/* an initializer, as far as walkParser() can tell
+					(see opensInitializer()), or perhaps not */
+				if (depthCurly == 0 && depthRound == 0 && afterColon
+				 && (isalnum(lastc) || lastc == '_' || lastc == '>'))
+				{
+					inInitializer = true;
+				}
+				++depthCurly;
+				inBetween = true;
+				break;
+
+			case '}':
+				--depthCurly;
+				if (depthCurly == 0 && inInitializer)
+					inInitializer = false;
+				else
+					doFlush = (bool)(depthCurly == 0 && depthRound == 0);
+				inBetween = true;
+				break;
+
+			case ';':
+				doFlush = (bool)(depthCurly == 0 && depthRound == 0);
+				inBetween = true;
+				break;
+
+			case '\n':
+			case '\r':
+				isChar1 = true;
+				break;
+
+			default:
+				if (inBetween && !isspace(c))
+					inBetween = false;
+				break;
+			}
+			if (!isspace(c))
+				lastc = c;
+		}
+
+		if (isChar1 && !isspace(c))
+			isChar1 = false;
+
+		prevc = c;
+		if (doFlush)
+			afterColon = false;
+
+		/* only where nothing is carried over past the flush */
+		if (doFlush && depthRound == 0 && inBetween
+		 && !inComment && !inPreprocessor
+		 && (!conditional || isSettled(&cond)))
+		{
+			at->offset = (const char *)p - data;
+			at->prevc = prevc;
+			at->isChar1 = isChar1;
+			at->line = line;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+	Creates a parser.
+
+	With --max-memory, the parser's buffer is limited to half
+	of it. Anything bigger is passed through unchanged.
+
+	@return the new tParser, ready for resetParser()
+	@retval NULL	unable to allocate memory
+*/
+tParser *createParser(void)
+{
+	tParser	*parser;
+
+	parser = (tParser *)malloc(sizeof(tParser));
+	if (parser != NULL && initBuffer(&parser->buf, NULL, NULL) != 0)
+	{
+		free(parser);
+		parser = NULL;
+	}
+	if (parser != NULL)
+	{
+		parser->bytes = 0;
+		parser->plain = false;
+
+		/* leave the other half for the output (see --max-memory) */
+		parser->buf.limit = gOptions.maxMemory / 2;
+	}
+
+	return parser;
+}
+
+/**
+	Turns the fast path through the state machine (see sSignificant)
+	off or on, for the files a parser processes from now on. With it
+	off, every character takes the plain path, one at a time, as they
+	all did before the fast path was added, so the differential test
+	can compare the fast path against it. (A branch that's compiled
+	out is still passed over by skipDead(), which has no plain path.)
+
+	@param[in,out] 	parser 	the tParser to change
+	@param[in] 		plain 	true to turn the fast path off
+*/
+void plainParser(tParser *parser, bool plain)
+{
+	parser->plain = plain;
+}
+
+/**
+	Checks that a parser is in the state a boundary says it's in,
+	so the differential test can check nextBoundary() against the
+	state machine it's a copy of. The parser has to have been fed
+	the file as far as the character after the boundary, which is
+	left pending, so the state is that of the boundary itself.
+
+	@param[in] 	parser 	the tParser to check
+	@param[in] 	at 		the boundary (see nextBoundary())
+
+	@return true if resuming from the boundary (see resumeParser())
+			would put a parser in the same state
+*/
+bool atBoundary(const tParser *parser, const tBoundary *at)
+{
+	return (bool)(parser->prevc == at->prevc
+			   && parser->isChar1 == at->isChar1
+			   && parser->depthCurly == 0 && parser->depthRound == 0
+			   && parser->depthScope == 0
+			   && !parser->inQuietRound && !parser->inQuietCurly
+			   && !parser->isLiteral && !parser->inComment
+			   && !parser->inPreprocessor
+			   && !parser->inSingleQuotes && !parser->inDoubleQuotes
+			   && parser->inBetween && !parser->atStart
+			   && !parser->skipping
+			   && (!parser->conditional || isSettled(&parser->conditions)));
+}
+
+/**
+	Releases a parser, and everything it holds.
+
+	@param[in] 	parser 	the tParser to destroy
+*/
+void destroyParser(tParser *parser)
+{
+	freeBuffer(&parser->buf);
+	free(parser);
+}
+
+/**
+	Prepares a parser to process a new file.
+
+	Whatever was left over from the previous file is discarded,
+	but the memory it occupied is kept, to be reused.
+
+	@param[in,out] 	parser 	 	the tParser to reset
+	@param[out] 	out 		where to write the result
+	@param[in] 		filename	the name to use in a new file comment
+								(NULL if unknown)
+*/
+void resetParser(tParser *parser, tSink *out, const char *filename)
+{
+	clearBuffer(&parser->buf);
+	parser->buf.out = out;
+	parser->buf.filename = filename;
+	parser->buf.line = 1;
+	parser->buf.afterCR = false;
+
+	parser->prevc = '\0';
+	parser->pending = EOF;
+	parser->depthCurly = 0;
+	parser->depthRound = 0;
+	parser->depthScope = 0;
+	parser->inQuietRound = false;
+	parser->inQuietCurly = false;
+	parser->isLiteral = false;
+	parser->inComment = false;
+	parser->inCppComment = false;
+	parser->inPreprocessor = false;
+	parser->inSingleQuotes = false;
+	parser->inDoubleQuotes = false;
+	parser->atStart = true;
+	parser->inBetween = true;
+	parser->isChar1 = true;
+
+	parser->conditional = haveMacros();
+	parser->skipping = false;
+	clearDirective(&parser->directive);
+	initConditions(&parser->conditions);
+}
+
+/**
+	Prepares a parser to process part of a file, starting from
+	a boundary found by nextBoundary(). The output is the same
+	as the output from that point on when processing the whole
+	file, as far as the next boundary.
+
+	@param[in,out] 	parser 	 	the tParser to reset
+	@param[out] 	out 		where to write the result
+	@param[in] 		filename	the name to use in a new file comment
+								(NULL if unknown)
+	@param[in] 		from 		where in the file to start
+*/
+void resumeParser(tParser *parser, tSink *out, const char *filename,
+				  const tBoundary *from)
+{
+	resetParser(parser, out, filename);
+
+	/* the file comment has already been taken care of */
+	if (from->offset > 0)
+	{
+		parser->atStart = false;
+		parser->prevc = from->prevc;
+		parser->isChar1 = from->isChar1;
+		parser->buf.line = from->line;
+		parser->buf.afterCR = (bool)(from->prevc == '\r');
+	}
+}
+
+/**
+	Has a parser record each function it finds in symbols
+	(see --symbols), as well as processing it. This lasts until
+	it's changed, even through resetParser() and resumeParser().
+
+	@param[in,out] 	parser 	the tParser
+	@param[in] 		symbols where to write the records (NULL for none)
+	@param[in] 		path 	the path of the file, for the records
+*/
+void exportParser(tParser *parser, tSink *symbols, const char *path)
+{
+	parser->buf.symbols = symbols;
+	parser->buf.path = (path != NULL) ? path : "<stdin>";
+}
+
+/**
+	@internal
+
+	@brief Controls the meat of the processing.
+
+	Basically a state machine, which accumulates the incoming
+	stream of characters and chops them up into meaningful
+	chunks, then passes	those chunks off to other routines
+	to further process and output.
+
+	The input is walked in memory, with a single character of
+	lookahead, rather than read a character at a time. The last
+	character of a block has to wait for the first character of
+	the next, so it's left pending in the tParser, along with
+	the rest of the state, until then.
+
+	@param[in,out] 	parser 	the tParser to run
+	@param[in] 		data	the next characters of the file
+	@param[in] 		length	the number of characters in data
+	@param[in] 		final	true if this is the end of the file
+*/
+static void walkParser(tParser *parser, const char *data, size_t length,
+					   bool final)
+{
+	tBuffer *buf = &parser->buf;
+	const byte *p, *end, *run, *first;
+	char	ch;
+	int		state;
+	int		prevc, c, nextc;	/* needs to be int to hold EOF */
+	int		depthCurly,depthRound,depthScope;
+	bool	inComment, inCppComment;
+	bool	inPreprocessor;
+	bool	inSingleQuotes, inDoubleQuotes;
+	bool	inBetween, isLiteral, isChar1;
+	bool	inQuietRound, inQuietCurly;
+	bool	atStart, doFlush, doSpill;
+	bool	conditional, skipping;
+
+	 /* work on copies of the state. The buffer is written through
+		char pointers, which could point anywhere as far as the
+		compiler knows, so it couldn't keep the fields in registers */
+	prevc = parser->prevc;
+	depthCurly = parser->depthCurly;
+	depthRound = parser->depthRound;
+	depthScope = parser->depthScope;
+	inQuietRound = parser->inQuietRound;
+	inQuietCurly = parser->inQuietCurly;
+	isLiteral = parser->isLiteral;
+	inComment = parser->inComment;
+	inCppComment = parser->inCppComment;
+	inPreprocessor = parser->inPreprocessor;
+	inSingleQuotes = parser->inSingleQuotes;
+	inDoubleQuotes = parser->inDoubleQuotes;
+	atStart = parser->atStart;
+	inBetween = parser->inBetween;
+	isChar1 = parser->isChar1;
+	conditional = parser->conditional;
+	skipping = parser->skipping;
 	doFlush = false;
+	doSpill = false;
 
-	prevc = '\0';
+	/* characters are fetched as unsigned, just as fgetc() would */
+	first = (const byte *)data;
+	p = first;
+	end = p + length;
 
-	c = fgetc(inFile);
+	c = parser->pending;
+	if (c == EOF)
+		c = (p < end) ? *p++ : EOF;
 
 	while (c != EOF)
 	{
-		nextc = fgetc(inFile);
+		if (skipping)
+		{
+			/* within a branch that's compiled out, as far as the next
+				directive. (a character is never left pending while
+				skipping, so c is always the one before p) */
+			run = p - 1;
+			p = passDead(parser, run, end, depthCurly - depthScope);
+			if (p > run)
+				prevc = p[-1];
+			if (p == end)
+			{
+				c = EOF;
+				continue;
+			}
+
+			/* the '#' of a directive, parsed as usual to see where it leads */
+			c = *p++;
+			isChar1 = true;
+			skipping = false;
+		}
+
+		/*
+			the fast path: if the current state has no interest in
+			this character, find the end of the run of characters
+			it has no interest in, and add them all to the buffer
+			at once. Then carry on from the first one that matters.
+		*/
+		state = 0;
+		if (!isLiteral && !atStart && !parser->plain)
+		{
+			if (inComment)
+				state = inCppComment ? qInLineComment : qInBlockComment;
+			else if (inPreprocessor)
+				state = qInPreprocessor;
+			else if (inSingleQuotes)
+				state = qInSingleQuotes;
+			else if (inDoubleQuotes)
+				state = qInDoubleQuotes;
+			else if (!inBetween)
+				state = qInCode;
+		}
+
+		/* (a pending character isn't in this block) */
+		if (state != 0 && p > first && (sSignificant[c] & state) == 0)
+		{
+			run = p - 1;
+			while (p < end && (sSignificant[*p] & state) == 0)
+				++p;
+
+			if (emitBlock(buf, (const char *)run, p - run) == 0)
+			{
+				if (state == qInPreprocessor && conditional)
+					addToDirective(&parser->directive, (const char *)run, p - run);
+
+				/* none of these states look at line endings, or
+					have line endings in the run, so isChar1 just
+					needs to know if there's anything but whitespace */
+				while (isChar1 && run < p)
+				{
+					if (!isspace(*run++))
+						isChar1 = false;
+				}
+
+				prevc = p[-1];
+				c = (p < end) ? *p++ : EOF;
+				continue;
+			}
+
+			/* no room for the run, so take the slow path */
+			p = run + 1;
+		}
+
+		if (p < end)
+			nextc = *p++;
+		else if (final)
+			nextc = EOF;
+		else
+			break;	/* wait for the next block */
 
 		/*
 			the main state machine
@@ -721,11 +2156,14 @@ int processFile(FILE *outFile, FILE *inFile)
 			{
 				if (c == '\n' || c == '\r')
 				{
+					if (inPreprocessor && conditional)
+						skipping = endDirective(&parser->conditions,
+									&parser->directive, &parser->dead);
 					inCppComment = false;
 					inComment = false;
 					inPreprocessor = false;
 					isChar1 = true;
-					if (depthCurly == 0)
+					if (depthCurly == depthScope)
 					{
 						buf->description.end = buf->ptr;
 						++buf->description.count;
@@ -746,7 +2184,12 @@ int processFile(FILE *outFile, FILE *inFile)
 				if (prevc == '*' && c == '/')
 				{
 					inComment = false;
-					if (depthCurly == 0)
+
+					/* a comment within a directive is a space */
+					if (inPreprocessor && conditional)
+						addToDirective(&parser->directive, " ", 1);
+
+					if (depthCurly == depthScope)
 					{
 						buf->description.end = buf->ptr + 1;
 						++buf->description.count;
@@ -772,7 +2215,7 @@ int processFile(FILE *outFile, FILE *inFile)
 				{
 					inCppComment = false;
 					inComment = false;
-					if (depthCurly == 0)
+					if (depthCurly == depthScope)
 					{
 						buf->description.end = buf->ptr;
 						++buf->description.count;
@@ -782,11 +2225,14 @@ int processFile(FILE *outFile, FILE *inFile)
 						parseComment(buf);
 					}
 				}
-				if (depthCurly == 0 && !inComment)
+				if (depthCurly == depthScope && !inComment)
 				{
 					doFlush = true;
 				}
 
+				if (conditional)
+					skipping = endDirective(&parser->conditions,
+								&parser->directive, &parser->dead);
 				inPreprocessor = false;
 				isChar1 = true;
 				break;
@@ -803,7 +2249,7 @@ int processFile(FILE *outFile, FILE *inFile)
 				}
 				if (inComment)
 				{
-					if (depthCurly == 0)
+					if (depthCurly == depthScope)
 					{
 						flushBuffer(buf);
 						buf->description.start = buf->ptr;
@@ -813,6 +2259,29 @@ int processFile(FILE *outFile, FILE *inFile)
 						buf->commentStart = buf->ptr;
 					}
 				}
+				else if (conditional)
+					addToDirective(&parser->directive, "/", 1);
+				break;
+
+			case '\\':
+				/* a backslash at the end of the line carries the
+					directive on to the next one, as in a long #define */
+				if (nextc == '\n' || nextc == '\r')
+				{
+					isLiteral = true;
+					if (conditional)
+						addToDirective(&parser->directive, " ", 1);
+				}
+				else if (conditional)
+					addToDirective(&parser->directive, "\\", 1);
+				break;
+
+			default:
+				if (conditional)
+				{
+					ch = (char)c;
+					addToDirective(&parser->directive, &ch, 1);
+				}
 				break;
 			}		
 		}
@@ -860,10 +2329,9 @@ int processFile(FILE *outFile, FILE *inFile)
 				}
 				if (inComment)
 				{
-					if (depthCurly == 0)
+					if (depthCurly == depthScope)
 					{
-						flushBuffer(buf);
-						buf->description.start = buf->ptr;
+						startDescription(buf);
 					}
 					else
 					{
@@ -876,7 +2344,7 @@ int processFile(FILE *outFile, FILE *inFile)
 				/* is this the first non-whitepace char on the line? */
 				if (isChar1)
 				{
-					if (depthCurly == 0)
+					if (depthCurly == depthScope)
 					{
 						/*  if there was a comment preceeding this pre-
 							processor directive, it wasn't a description */
@@ -886,6 +2354,7 @@ int processFile(FILE *outFile, FILE *inFile)
 					}
 
 					inPreprocessor = true;
+					clearDirective(&parser->directive);
 				}
 				break;
 
@@ -898,50 +2367,91 @@ int processFile(FILE *outFile, FILE *inFile)
 				break;
 
 			case '(':
-				if (depthCurly == 0 && depthRound == 0)
+				if (depthCurly == depthScope && depthRound == 0)
 				{
-					buf->function.end = buf->ptr;
-					++buf->function.count;
-					buf->arglist.start = buf->ptr;
+					if (!opensArgList(buf))
+						inQuietRound = true;
+					else
+					{
+						if (buf->function.count == 0)
+							skipLabel(buf);
+						buf->function.end = buf->ptr;
+						++buf->function.count;
+						buf->arglist.start = buf->ptr;
+
+						/* a second argument list can't be a function */
+						if (buf->function.count > 1)
+							buf->spilling = true;
+					}
 				}
 				++depthRound;
 				break;
 
 			case ')':
 				--depthRound;
-				if (depthCurly == 0 && depthRound == 0)
+				if (depthCurly == depthScope && depthRound == 0)
 				{
-					buf->arglist.end = buf->ptr + 1;
-					++buf->arglist.count;
+					if (inQuietRound)
+						inQuietRound = false;
+					else
+					{
+						buf->arglist.end = buf->ptr + 1;
+						++buf->arglist.count;
+					}
 				}
 				break;
 
 			case '{':
-				if (depthCurly == 0)
+				if (depthCurly != depthScope)
+					parseStatement(buf);
+				else if (buf->function.count == 0 && opensScope(buf))
 				{
-					buf->body.start = buf->ptr;
+					/* the declarations inside are at the top level */
+					++depthScope;
+					doFlush = true;
 				}
+				else if (depthRound == 0 && opensInitializer(buf))
+					inQuietCurly = true;
 				else
-					parseStatement(buf);
+				{
+					buf->body.start = buf->ptr;
+
+					/* e.g. a struct, or a table of data */
+					if (buf->function.count != 1 || buf->arglist.count != 1)
+						buf->spilling = true;
+				}
 				++depthCurly;
 				inBetween = true;
 				break;
 
 			case '}':
 				--depthCurly;
-				if (depthCurly == 0)
+				if (depthCurly < depthScope && depthScope > 0)
+				{
+					/* the end of a namespace, or a class */
+					--depthScope;
+					doFlush = true;
+				}
+				else if (depthCurly != depthScope)
+					parseStatement(buf);
+				else if (inQuietCurly)
+				{
+					/* the body is still to come */
+					inQuietCurly = false;
+					inBetween = false;
+					break;
+				}
+				else
 				{
 					buf->body.end = buf->ptr + 1;
 					++buf->body.count;
 					doFlush = true;
 				}
-				else
-					parseStatement(buf);
 				inBetween = true;
 				break;
 
 			case ';':
-				if (depthCurly == 0)
+				if (depthCurly == depthScope)
 					doFlush = true;
 				else
 					parseStatement(buf);
@@ -956,7 +2466,7 @@ int processFile(FILE *outFile, FILE *inFile)
 			default:
 				if (inBetween && !isspace(c))
 				{
-					if (depthCurly == 0)
+					if (depthCurly == depthScope)
 						buf->function.start = buf->ptr;
 					else
 						buf->statementStart = buf->ptr;
@@ -977,7 +2487,7 @@ int processFile(FILE *outFile, FILE *inFile)
 				/* set flag to act at the end of the comment */
 				buf->fileComment = true;
 			}
-			else
+			else if (!gOptions.check)
 			{
 				/* it's not a comment, so insert a new file comment */
 				newFileComment(buf);
@@ -986,9 +2496,11 @@ int processFile(FILE *outFile, FILE *inFile)
 
 		if (emitChar(buf, c) != 0)
 		{
-			 /* buffer overflowed! hopefully this won't
-				happen very often... no choice but to flush */
+			 /* buffer overflowed, and there's no memory left
+				to grow it! no choice but to flush */
+			doSpill = (bool)!doFlush;
 			doFlush = true;
+			++buf->overflows;
 		}
 
 		if (doFlush)
@@ -996,6 +2508,16 @@ int processFile(FILE *outFile, FILE *inFile)
 			doFlush = false;
 			flushBuffer(buf);
 			buf->fileComment = false;
+
+			/* only brackets that don't match can leave this set,
+				and nextBoundary() takes it to be over by now */
+			if (depthRound == 0)
+				inQuietRound = false;
+
+			/* the rest of something that overflowed is just
+				passed through, rather than taking up memory */
+			buf->spilling = doSpill;
+			doSpill = false;
 		}
 
 		 /* if the currect character isn't whitespace, we're
@@ -1008,9 +2530,311 @@ int processFile(FILE *outFile, FILE *inFile)
 
 	} /* end while */
 
+	/* save the state for the next block */
+	parser->pending = c;
+	parser->prevc = prevc;
+	parser->depthCurly = depthCurly;
+	parser->depthRound = depthRound;
+	parser->depthScope = depthScope;
+	parser->inQuietRound = inQuietRound;
+	parser->inQuietCurly = inQuietCurly;
+	parser->isLiteral = isLiteral;
+	parser->inComment = inComment;
+	parser->inCppComment = inCppComment;
+	parser->inPreprocessor = inPreprocessor;
+	parser->inSingleQuotes = inSingleQuotes;
+	parser->inDoubleQuotes = inDoubleQuotes;
+	parser->atStart = atStart;
+	parser->inBetween = inBetween;
+	parser->isChar1 = isChar1;
+	parser->skipping = skipping;
+}
+
+/**
+	Feeds the next block of a file to a parser.
+
+	The file may be split into blocks anywhere, of any size; the
+	result is the same as if the whole file was fed at once. Output
+	is written to the parser's tSink as each construct is completed.
+
+	@param[in,out] 	parser 	a tParser, reset by resetParser()
+	@param[in] 		data	the next characters of the file
+	@param[in] 		length	the number of characters in data
+
+	@return int
+	@retval 0		all is well so far
+	@retval -20		unable to write the output
+*/
+int feedParser(tParser *parser, const char *data, size_t length)
+{
+	parser->bytes += length;
+	walkParser(parser, data, length, false);
+
+	return (parser->buf.out->failed ? -20 : 0);
+}
+
+/**
+	Tells a parser it has reached the end of the file, so
+	it can process and output whatever's left.
+
+	@param[in,out] 	parser 	the tParser to finish
+
+	@return int
+	@retval 0		everything went smoothly
+	@retval -20		unable to write the output
+*/
+int finishParser(tParser *parser)
+{
+	walkParser(parser, "", 0, true);
+
 	/* flush whatever may be left in the buffer */
-	flushBuffer(buf);
-	free(buf);
-	
-	return 0;
+	flushBuffer(&parser->buf);
+
+	return flushSink(parser->buf.out);
+}
+
+/**
+	Reports what a parser has done, over all the files
+	it has processed since it was created.
+
+	@param[in] 	parser 	the tParser to report on
+	@param[out] counts 	receives the counts
+*/
+void countParser(tParser *parser, tParserCounts *counts)
+{
+	counts->bytes = parser->bytes;
+	counts->functions = parser->buf.functions;
+	counts->documented = parser->buf.documented;
+	counts->missing = parser->buf.missing;
+	counts->overflows = parser->buf.overflows;
+	counts->allocations = parser->buf.arena.allocations;
+}
+
+/**
+	Processes a file that's already in memory.
+
+	A convenience for processing a single file; the parser is
+	created for the one file, then destroyed again.
+
+	@param[out] out 		where to write the result
+	@param[in] 	data		the characters to process
+	@param[in] 	length		the number of characters in data
+	@param[in] 	filename	the name to use in a new file comment
+							(NULL if unknown)
+
+	@return int
+	@retval 0		everything went smoothly
+	@retval -20		unable to write the output
+	@retval -108	unable to allocate memory
+*/
+int processMemory(tSink *out, const char *data, size_t length,
+				  const char *filename)
+{
+	tParser	*parser;
+	int		result;
+
+	parser = createParser();
+	if (parser == NULL)
+		return (-108);
+
+	resetParser(parser, out, filename);
+	feedParser(parser, data, length);
+	result = finishParser(parser);
+	destroyParser(parser);
+
+	return result;
+}
+
+/**
+	@internal
+
+	Finds the start of a line.
+
+	A line ends with a newline, a carriage return, or both
+	(in either order).
+
+	@param[in] 		data 	the whole file
+	@param[in] 		length 	the number of characters in data
+	@param[in] 		offset 	where to start looking
+	@param[in,out] 	line 	the number of the line at offset;
+							updated to the line found
+	@param[in] 		target 	the number of the line to find
+
+	@return where the line starts, or the end of the file
+			if it doesn't have that many lines
+*/
+static size_t findLine(const char *data, size_t length, size_t offset,
+					   long *line, long target)
+{
+	char	c;
+
+	while (*line < target && offset < length)
+	{
+		c = data[offset++];
+		if (c == '\n' || c == '\r')
+		{
+			if (offset < length
+			 && (data[offset] == '\n' || data[offset] == '\r')
+			 && data[offset] != c)
+			{
+				++offset;
+			}
+			++*line;
+		}
+	}
+
+	return offset;
+}
+
+/**
+	Processes just the changed parts of a file that's already been
+	processed, copying the rest through untouched.
+
+	Each change is widened to the boundaries (see tBoundary) either
+	side of it, so whole functions are reprocessed, along with the
+	comments before them. It's up to the caller to make sure the
+	rest of the file is already insertdox's output, or it may not
+	be the same as the result of processing the whole file.
+
+	@param[in,out] 	parser 	 	the tParser to use
+	@param[out] 	out 		where to write the result
+	@param[in] 		data		the whole file
+	@param[in] 		length		the number of characters in data
+	@param[in] 		filename	the name to use in a new file comment
+								(NULL if unknown)
+	@param[in] 		lines 		the lines that have changed, in order
+	@param[in] 		count 		the number of ranges in lines
+
+	@return int
+	@retval 0		everything went smoothly
+	@retval -20		unable to write the output
+*/
+int processChanges(tParser *parser, tSink *out, const char *data,
+				   size_t length, const char *filename,
+				   const tLineRange *lines, int count)
+{
+	tBoundary	at, next, from;
+	size_t	pos, end, done;
+	long	line;
+	bool	more;
+	int		i, result;
+
+	firstBoundary(&at);
+	next = at;
+	more = nextBoundary(data, length, &next);
+
+	/* pos is where line starts */
+	pos = 0;
+	line = 1;
+	done = 0;
+	result = 0;
+	i = 0;
+	while (i < count && result == 0)
+	{
+		pos = findLine(data, length, pos, &line, lines[i].first);
+
+		/* back up to the boundary before the change */
+		while (more && next.offset <= pos)
+		{
+			at = next;
+			more = nextBoundary(data, length, &next);
+		}
+		from = at;
+
+		/* and forward to the boundary after it, taking in any
+			more changes that begin before (or at) that boundary */
+		end = pos;
+		do {
+			pos = findLine(data, length, pos, &line, lines[i].last + 1);
+			if (end < pos)
+				end = pos;
+
+			while (more && at.offset < end)
+			{
+				at = next;
+				more = nextBoundary(data, length, &next);
+			}
+			end = (at.offset >= end) ? at.offset : length;
+
+			if (++i < count)
+				pos = findLine(data, length, pos, &line, lines[i].first);
+		} while (i < count && pos <= end);
+
+		sinkWrite(out, &data[done], from.offset - done);
+		resumeParser(parser, out, filename, &from);
+		feedParser(parser, &data[from.offset], end - from.offset);
+		result = finishParser(parser);
+		done = end;
+	}
+
+	if (result == 0)
+	{
+		sinkWrite(out, &data[done], length - done);
+		result = flushSink(out);
+	}
+
+	return result;
+}
+
+/**
+	@brief Processes a stream.
+
+	Reads the input stream in large blocks, feeding each to the
+	parser as it arrives, so the output of a pipe is processed
+	as it comes in, rather than once it's all been read.
+
+	@param[out] outFile 	where to write the result
+	@param[in] 	inFile		the file to process
+	@param[in] 	filename	the name to use in a new file comment
+							(NULL if stdin)
+	@param[out] symbols 	receives a record of each function (NULL
+							if they aren't wanted, see exportParser())
+	@param[out] counts 		receives what the parser did (NULL if
+							that isn't wanted)
+
+	@return int
+	@retval 0		everything went smoothly
+	@retval -20		unable to write the output
+	@retval -36		unable to read the input file
+	@retval -108	unable to allocate memory
+*/
+int processFile(FILE *outFile, FILE *inFile, const char *filename,
+				tSink *symbols, tParserCounts *counts)
+{
+	tParser	*parser;
+	tSink	sink;
+	char	*block;
+	size_t	count;
+	int		result;
+
+	block = (char *)malloc(qReadBlockSize);
+	parser = createParser();
+	result = (block == NULL || parser == NULL) ? -108 : initSink(&sink, outFile);
+	if (result == 0)
+	{
+		resetParser(parser, &sink, filename);
+		exportParser(parser, symbols, filename);
+
+		while (result == 0
+			&& (count = fread(block, sizeof(char), qReadBlockSize, inFile)) > 0)
+		{
+			result = feedParser(parser, block, count);
+		}
+		if (result == 0 && ferror(inFile))
+			result = -36;
+		if (result == 0)
+			result = finishParser(parser);
+
+		freeSink(&sink);
+	}
+
+	if (parser != NULL)
+	{
+		if (counts != NULL)
+			countParser(parser, counts);
+		destroyParser(parser);
+	}
+	free(block);
+
+	return result;
 }
@@ -8,5 +8,64 @@
 	@date 2005-2006
 */
 
+int loadBoilerplate(const char *filename);
+void freeBoilerplate(void);
+
+typedef struct tParser tParser;
+
+/**
+	what a parser has done, as reported by countParser().
+*/
+typedef struct {
+	size_t	bytes;			/**< characters fed to the parser */
+	size_t	functions;		/**< functions annotated */
+	size_t	documented;		/**< functions passed through, already documented */
+	size_t	missing;		/**< functions without a Doxygen comment (--check) */
+	size_t	overflows;		/**< flushes forced by running out of memory */
+	size_t	allocations;	/**< allocations for todos, notes and return values */
+} tParserCounts;
+
+/**
+	a place in a file where the parser's state is as simple as it gets:
+	just after the end of a top-level statement, function or directive,
+	and outside any comment, string or brackets. Parsing the file can
+	be picked up from any boundary (see resumeParser()).
+*/
+typedef struct {
+	size_t	offset;		/**< where the boundary is */
+	int		prevc;		/**< the character just before it */
+	bool	isChar1;	/**< only whitespace so far on its line */
+	long	line;		/**< the line it's on, numbered from 1 */
+} tBoundary;
+
+/**
+	a range of lines in a file, numbered from 1.
+*/
+typedef struct {
+	long	first;		/**< the first line of the range */
+	long	last;		/**< the last line of the range */
+} tLineRange;
+
+void firstBoundary(tBoundary *at);
+bool nextBoundary(const char *data, size_t length, tBoundary *at);
+
+tParser *createParser(void);
+void destroyParser(tParser *parser);
+void plainParser(tParser *parser, bool plain);
+bool atBoundary(const tParser *parser, const tBoundary *at);
+void resetParser(tParser *parser, tSink *out, const char *filename);
+void resumeParser(tParser *parser, tSink *out, const char *filename,
+				  const tBoundary *from);
+int feedParser(tParser *parser, const char *data, size_t length);
+int finishParser(tParser *parser);
+void countParser(tParser *parser, tParserCounts *counts);
+void exportParser(tParser *parser, tSink *symbols, const char *path);
+
 /*	called from main() */
-int processFile(FILE *outFile, FILE *inFile);
+int processFile(FILE *outFile, FILE *inFile, const char *filename,
+				tSink *symbols, tParserCounts *counts);
+int processMemory(tSink *out, const char *data, size_t length,
+				  const char *filename);
+int processChanges(tParser *parser, tSink *out, const char *data,
+				   size_t length, const char *filename,
+				   const tLineRange *lines, int count);
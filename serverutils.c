@@ -0,0 +1,513 @@
+/**
+	@file serverutils.c
+
+	Answers requests to process files, read from a stream or from
+	the connections to a Unix domain socket, so an editor or a build
+	tool can keep one insertdox running rather than starting a new
+	one for every file (see --server).
+
+	Each request is one line, and some are followed by data:
+
+	- 'file <path>' asks for the processed contents of a file, which
+	  is left as it is.
+	- 'data <length> [<name>]' is followed by <length> bytes, the
+	  contents of a file called <name>, and asks for them processed.
+	- 'file-diff <path>' and 'data-diff <length> [<name>]' ask for a
+	  unified diff from the original to the processed contents
+	  instead (which is empty if nothing would change).
+	- 'quit' ends the stream or the connection.
+	- 'shutdown' does that, and stops listening on the socket, too.
+
+	Each reply is either 'ok <length>' followed by <length> bytes,
+	or 'error <code> <why>', each on a line of its own. Connections
+	to the socket are answered one at a time, in turn.
+
+	A 'data' request with a length that isn't a plain number, or is
+	more than qMaxData, gets an error, and the stream or connection
+	is ended, since there's no telling where its data would end.
+
+	@version 0.92
+	@author Paul Chambers
+	@date 2005-2006
+*/
+/* $Header$ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "common.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#ifndef WIN32
+#include <unistd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+#include "sinkutils.h"
+#include "fileutils.h"
+#include "diffutils.h"
+#include "serverutils.h"
+
+/*
+	what answerRequest() returns, other than an error code
+*/
+#define qServeNext		0	/**< carry on to the next request */
+#define qServeQuit		1	/**< the stream or connection is finished */
+#define qServeShutdown	2	/**< stop listening for connections, too */
+
+/**
+	what's kept from one request to the next, so
+	the buffers don't have to be allocated each time.
+*/
+typedef struct {
+	tServeHandler	handler;	/**< processes each file */
+	tSource	input;		/**< the contents of the file */
+	tSink	output;		/**< the processed contents */
+	tSink	diff;		/**< the diff between them, if asked for */
+	char	line[qMaxRequest + 2];	/**< the request, and its newline */
+} tServer;
+
+static int initServer(tServer *server, tServeHandler handler);
+static void freeServer(tServer *server);
+static int sendReply(FILE *out, const tSink *reply);
+static int sendError(FILE *out, int code, const char *why);
+static int readData(tServer *server, FILE *in, size_t length);
+static int loadFile(tServer *server, const char *path);
+static int answerRequest(tServer *server, FILE *in, FILE *out);
+static int serveConnection(tServer *server, FILE *in, FILE *out);
+
+/*
+	private functions
+*/
+
+/**
+	@internal
+
+	Sets up the buffers used to answer requests.
+
+	@param[out] server 	the server to set up
+	@param[in] 	handler the function that processes each file
+
+	@return int
+	@retval 0		all is well
+	@retval -108	unable to allocate memory
+*/
+static int initServer(tServer *server, tServeHandler handler)
+{
+	server->handler = handler;
+	initSource(&server->input);
+	if (initSink(&server->output, NULL) != 0)
+		return (-108);
+	if (initSink(&server->diff, NULL) != 0)
+	{
+		freeSink(&server->output);
+		return (-108);
+	}
+	return 0;
+}
+
+/**
+	@internal
+
+	Frees the buffers used to answer requests.
+
+	@param[in,out] 	server 	the server to free
+*/
+static void freeServer(tServer *server)
+{
+	freeSource(&server->input);
+	freeSink(&server->output);
+	freeSink(&server->diff);
+}
+
+/**
+	@internal
+
+	Sends a successful reply.
+
+	@param[out] out 	where to send the reply
+	@param[in] 	reply 	what to send
+
+	@return int
+	@retval 0	all is well
+	@retval -20	unable to write to the stream
+*/
+static int sendReply(FILE *out, const tSink *reply)
+{
+	fprintf(out, "ok %lu\n", (unsigned long)reply->length);
+	fwrite(reply->data, sizeof(char), reply->length, out);
+
+	return (fflush(out) != 0 || ferror(out)) ? -20 : 0;
+}
+
+/**
+	@internal
+
+	Sends a reply saying why a request couldn't be answered.
+
+	@param[out] out 	where to send the reply
+	@param[in] 	code 	the error code
+	@param[in] 	why 	a description of the error
+
+	@return int
+	@retval 0	all is well
+	@retval -20	unable to write to the stream
+*/
+static int sendError(FILE *out, int code, const char *why)
+{
+	fprintf(out, "error %d %s\n", code, why);
+
+	return (fflush(out) != 0 || ferror(out)) ? -20 : 0;
+}
+
+/**
+	@internal
+
+	Reads the contents given with a 'data' request.
+
+	@param[in,out] 	server 	receives the contents, in its input
+	@param[in] 		in 		the stream the request came from
+	@param[in] 		length 	the number of bytes to read (no more
+							than qMaxData)
+
+	@return int
+	@retval 0		all is well
+	@retval -36		the stream ended, or couldn't be read
+	@retval -108	unable to allocate memory
+*/
+static int readData(tServer *server, FILE *in, size_t length)
+{
+	tSource	*src = &server->input;
+	char	*data;
+
+	if (length > qMaxData)
+		return (-108);
+
+	if (src->size <= length)
+	{
+		data = (char *)realloc(src->data, length + 1);
+		if (data == NULL)
+			return (-108);
+		src->data = data;
+		src->size = length + 1;
+	}
+
+	src->length = fread(src->data, sizeof(char), length, in);
+
+	return (src->length == length) ? 0 : -36;
+}
+
+/**
+	@internal
+
+	Reads the file given with a 'file' request.
+
+	@param[in,out] 	server 	receives the contents, in its input
+	@param[in] 		path 	the file to read
+
+	@return int
+	@retval 0		all is well
+	@retval -36		the file couldn't be read
+	@retval -43		the file couldn't be opened
+	@retval -108	unable to allocate memory
+*/
+static int loadFile(tServer *server, const char *path)
+{
+	FILE	*file;
+	int		result;
+
+	file = fopen(path, "r");
+	if (file == NULL)
+		return (-43);
+
+	result = readSource(&server->input, file);
+	fclose(file);
+
+	return result;
+}
+
+/**
+	@internal
+
+	Reads a request, and replies to it.
+
+	@param[in,out] 	server 	the buffers to use
+	@param[in] 		in 		where to read the request from
+	@param[out] 	out 	where to send the reply
+
+	@return qServeNext, qServeQuit, qServeShutdown or an error code
+	@retval -20		unable to send the reply
+	@retval -36		unable to read the request
+	@retval -108	unable to allocate memory
+*/
+static int answerRequest(tServer *server, FILE *in, FILE *out)
+{
+	char	*line = server->line;
+	char	*arg, *name, *end;
+	size_t	length;
+	bool	diff;
+	int		result;
+
+	if (fgets(line, sizeof(server->line), in) == NULL)
+		return ferror(in) ? -36 : qServeQuit;
+
+	length = strlen(line);
+	if (length > 0 && line[length - 1] == '\n')
+		line[--length] = '\0';
+	else if (!feof(in))
+	{
+		/* skip the rest of it */
+		while ((result = getc(in)) != EOF && result != '\n')
+			;
+		return sendError(out, -1, "the request is too long");
+	}
+	if (length > 0 && line[length - 1] == '\r')
+		line[--length] = '\0';
+
+	arg = strchr(line, ' ');
+	if (arg != NULL)
+		*arg++ = '\0';
+
+	if (strcmp(line, "quit") == 0)
+		return qServeQuit;
+	if (strcmp(line, "shutdown") == 0)
+		return qServeShutdown;
+
+	diff = (bool)(strstr(line, "-diff") != NULL);
+	if (strcmp(line, "file") == 0 || strcmp(line, "file-diff") == 0)
+	{
+		if (arg == NULL || *arg == '\0')
+			return sendError(out, -1, "expected 'file <path>'");
+
+		name = arg;
+		result = loadFile(server, name);
+		if (result == -43)
+			return sendError(out, -43, "unable to open the file");
+		if (result == -36)
+			return sendError(out, -36, "unable to read the file");
+	}
+	else if (strcmp(line, "data") == 0 || strcmp(line, "data-diff") == 0)
+	{
+		/* nothing can be read for a request that's not understood */
+		if (arg == NULL || *arg < '0' || *arg > '9')
+			return sendError(out, -1, "expected 'data <length> [<name>]'");
+		errno = 0;
+		length = strtoul(arg, &end, 10);
+		if (*end != '\0' && *end != ' ')
+			return sendError(out, -1, "expected 'data <length> [<name>]'");
+
+		/* the data that follows can't be skipped, so that's the end */
+		if (errno == ERANGE || length > qMaxData)
+		{
+			result = sendError(out, -1, "the data is too long");
+			return (result != 0) ? result : qServeQuit;
+		}
+
+		name = (*end == ' ' && end[1] != '\0') ? end + 1 : NULL;
+		result = readData(server, in, length);
+		if (result != 0)
+			return result;	/* lost track of the stream */
+	}
+	else
+		return sendError(out, -1, "unknown request");
+
+	if (result == 0)
+	{
+		resetSink(&server->output, NULL);
+		result = server->handler(&server->output, server->input.data,
+								 server->input.length, name);
+		if (result == 0 && server->output.failed)
+			result = -108;
+	}
+	if (result == 0 && diff)
+	{
+		resetSink(&server->diff, NULL);
+		result = writeDiff(&server->diff, (name != NULL) ? name : "<data>",
+						   server->input.data, server->input.length,
+						   server->output.data, server->output.length);
+		if (result == 0 && server->diff.failed)
+			result = -108;
+	}
+
+	switch (result)
+	{
+	case 0:
+		return sendReply(out, diff ? &server->diff : &server->output);
+
+	case -108:
+		/* let the next one try, with whatever memory is left */
+		return sendError(out, -108, "ran out of memory");
+
+	default:
+		return sendError(out, result, "unable to process the file");
+	}
+}
+
+/**
+	@internal
+
+	Answers requests until the stream ends, or there's a 'quit'
+	or a 'shutdown' request.
+
+	@param[in,out] 	server 	the buffers to use
+	@param[in] 		in 		where to read the requests from
+	@param[out] 	out 	where to send the replies
+
+	@return qServeQuit, qServeShutdown or an error code
+	@retval -20		unable to send a reply
+	@retval -36		unable to read a request
+*/
+static int serveConnection(tServer *server, FILE *in, FILE *out)
+{
+	int		result;
+
+	do {
+		result = answerRequest(server, in, out);
+	} while (result == qServeNext);
+
+	return result;
+}
+
+/*
+	public functions
+*/
+
+/**
+	Answers the requests read from a stream, until it ends, or
+	there's a 'quit' or a 'shutdown' request.
+
+	@param[in] 	in 		 	where to read the requests from
+	@param[out] out 	 	where to send the replies
+	@param[in] 	handler 	the function that processes each file
+
+	@return int
+	@retval 0		all is well
+	@retval -20		unable to send a reply
+	@retval -36		unable to read a request
+	@retval -108	unable to allocate memory
+*/
+int serveStream(FILE *in, FILE *out, tServeHandler handler)
+{
+	tServer	*server;
+	int		result;
+
+	server = (tServer *)malloc(sizeof(tServer));
+	if (server == NULL || initServer(server, handler) != 0)
+	{
+		free(server);
+		return (-108);
+	}
+
+	result = serveConnection(server, in, out);
+
+	freeServer(server);
+	free(server);
+
+	return (result < 0) ? result : 0;
+}
+
+/**
+	Listens on a Unix domain socket, and answers the requests
+	on each connection made to it, one connection at a time,
+	until there's a 'shutdown' request.
+
+	The socket is created, replacing any socket that's already
+	there, and removed again afterwards.
+
+	@param[in] 	path 	 	the path of the socket
+	@param[in] 	handler 	the function that processes each file
+
+	@return int
+	@retval 0		all is well
+	@retval -1		unable to listen on the socket, or to accept a connection
+	@retval -108	unable to allocate memory
+*/
+int serveSocket(const char *path, tServeHandler handler)
+{
+#ifdef WIN32
+	(void)path;
+	(void)handler;
+	return (-1);
+#else
+	tServer	*server;
+	struct sockaddr_un	address;
+	struct stat	info;
+	FILE	*in, *out;
+	int		listener, connection;
+	int		result;
+
+	if (strlen(path) >= sizeof(address.sun_path))
+		return (-1);
+
+	server = (tServer *)malloc(sizeof(tServer));
+	if (server == NULL || initServer(server, handler) != 0)
+	{
+		free(server);
+		return (-108);
+	}
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+
+	/* left behind by an earlier server, but never anything else */
+	if (stat(path, &info) == 0 && S_ISSOCK(info.st_mode))
+		unlink(path);
+
+	listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0
+	 || bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0
+	 || listen(listener, 8) != 0)
+	{
+		if (listener >= 0)
+			close(listener);
+		freeServer(server);
+		free(server);
+		return (-1);
+	}
+
+	/* a client that goes away before its reply is just an error */
+	signal(SIGPIPE, SIG_IGN);
+
+	result = 0;
+	do {
+		connection = accept(listener, NULL, NULL);
+		if (connection < 0)
+		{
+			if (errno != EINTR && errno != ECONNABORTED)
+				break;
+			continue;
+		}
+
+		in = fdopen(connection, "r");
+		out = fdopen(dup(connection), "w");
+		if (in == NULL || out == NULL)
+		{
+			if (in != NULL)
+				fclose(in);
+			else
+				close(connection);
+			if (out != NULL)
+				fclose(out);
+			continue;
+		}
+
+		result = serveConnection(server, in, out);
+		fclose(in);
+		fclose(out);
+	} while (result != qServeShutdown);
+
+	close(listener);
+	unlink(path);
+	freeServer(server);
+	free(server);
+
+	return (connection < 0) ? -1 : 0;
+#endif
+}
@@ -0,0 +1,28 @@
+/**
+	@file serverutils.h
+
+	Public interface for serverutils.c
+
+	@version 0.92
+	@author Paul Chambers
+	@date 2005-2006
+*/
+/* $Header$ */
+
+/** the longest request line that's understood */
+#define qMaxRequest		4096
+
+/** the most data a 'data' request may include, in bytes */
+#define qMaxData		(256UL * 1048576)
+
+/**
+	processes the contents of a file for the server, writing the result
+	to out. path is the file's path, or the name given with inline
+	contents (NULL if there isn't one). Returns 0 if all is well,
+	otherwise an error code, as finishParser() does.
+*/
+typedef int (*tServeHandler)(tSink *out, const char *data, size_t length,
+							 char *path);
+
+int serveStream(FILE *in, FILE *out, tServeHandler handler);
+int serveSocket(const char *path, tServeHandler handler);
@@ -0,0 +1,262 @@
+/**
+	@file sinkutils.c
+
+	Functions that support the tSink structure.
+
+	Generating a function's comment involves many short strings.
+	Rather than pass each one through stdio (which parses a format
+	string and takes a lock every time), they're appended to a large
+	buffer, which is written out with a single fwrite() when it
+	fills up, or when the sink is flushed.
+
+	@version 0.92
+	@author Paul Chambers
+	@date 2005-2006
+*/
+/* $Header$ */
+
+#include "common.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sinkutils.h"
+
+static int drainSink(tSink *sink, size_t count);
+
+/*
+	private functions
+*/
+
+/**
+	@internal
+
+	Makes room for more output. Writes out what's buffered if
+	there's a file, otherwise grows the buffer.
+
+	@param[in,out] 	sink 	the tSink to make room in
+	@param[in] 		count 	the number of characters that are about
+							to be appended
+
+	@return int
+	@retval 0		there's room for count more characters
+	@retval 1		there isn't, so the caller should write them directly
+	@retval -108	unable to allocate memory
+*/
+static int drainSink(tSink *sink, size_t count)
+{
+	char	*data;
+	size_t	size;
+
+	if (sink->file != NULL)
+	{
+		flushSink(sink);
+		return (count > sink->size);
+	}
+
+	size = sink->size;
+	while (size - sink->length < count)
+		size *= 2;
+
+	data = (char *)realloc(sink->data, size);
+	if (data == NULL)
+	{
+		sink->failed = true;
+		return (-108);
+	}
+	sink->data = data;
+	sink->size = size;
+
+	return 0;
+}
+
+/*
+	public functions
+*/
+
+/**
+	Initialize a tSink object.
+
+	@param[out] 	sink 	the tSink to initialize
+	@param[in] 		file 	the output file (NULL to collect the
+							output in memory)
+
+	@return int
+	@retval 0		all is well
+	@retval -108	unable to allocate the sink's buffer
+*/
+int initSink(tSink *sink, FILE *file)
+{
+	sink->file = file;
+	sink->length = 0;
+	sink->failed = false;
+	sink->size = qSinkSize;
+	sink->data = (char *)malloc(qSinkSize);
+
+	return (sink->data == NULL ? -108 : 0);
+}
+
+/**
+	Empties a tSink, so it can be used again, keeping its buffer.
+	Anything not yet flushed is lost.
+
+	@param[in,out] 	sink 	the tSink to reset
+	@param[in] 		file 	where the output goes from now on
+							(NULL to keep it in memory)
+*/
+void resetSink(tSink *sink, FILE *file)
+{
+	sink->file = file;
+	sink->length = 0;
+	sink->failed = false;
+}
+
+/**
+	Releases a tSink's buffer. Anything not yet flushed is lost.
+
+	@param[in,out] 	sink 	the tSink to free
+*/
+void freeSink(tSink *sink)
+{
+	free(sink->data);
+	sink->data = NULL;
+	sink->length = 0;
+	sink->size = 0;
+}
+
+/**
+	Writes out everything buffered in a tSink.
+
+	Does nothing for a sink without a file; the output
+	stays in memory.
+
+	@param[in,out] 	sink 	the tSink to flush
+
+	@return int
+	@retval 0	all is well
+	@retval -20	a write failed, now or earlier
+*/
+int flushSink(tSink *sink)
+{
+	if (sink->file != NULL && sink->length > 0)
+	{
+		if (fwrite(sink->data, sizeof(char), sink->length, sink->file)
+			!= sink->length)
+		{
+			sink->failed = true;
+		}
+		sink->length = 0;
+	}
+
+	return (sink->failed ? -20 : 0);
+}
+
+/**
+	Appends a block of characters to a tSink.
+
+	@param[in,out] 	sink 	the tSink to write to
+	@param[in] 		start 	the first character to write
+	@param[in] 		count 	the number of characters to write
+*/
+void sinkWrite(tSink *sink, const char *start, size_t count)
+{
+	int	room = 0;
+
+	if (sink->size - sink->length < count)
+		room = drainSink(sink, count);
+
+	if (room == 0)
+	{
+		memcpy(&sink->data[sink->length], start, count);
+		sink->length += count;
+	}
+	else if (room > 0)
+	{
+		/* too big to be worth buffering */
+		if (fwrite(start, sizeof(char), count, sink->file) != count)
+			sink->failed = true;
+	}
+}
+
+/**
+	Appends a nul-terminated string to a tSink.
+
+	@param[in,out] 	sink 	the tSink to write to
+	@param[in] 		string 	the string to write
+*/
+void sinkPuts(tSink *sink, const char *string)
+{
+	sinkWrite(sink, string, strlen(string));
+}
+
+/**
+	Appends a single character to a tSink.
+
+	@param[in,out] 	sink 	the tSink to write to
+	@param[in] 		c 		the character to write
+*/
+void sinkChar(tSink *sink, int c)
+{
+	if (sink->length < sink->size || drainSink(sink, 1) == 0)
+		sink->data[sink->length++] = (char)c;
+}
+
+/**
+	Appends a block of characters to a tSink as a JSON string,
+	in double quotes, with quotes, backslashes and control
+	characters escaped (see --symbols).
+
+	@param[in,out] 	sink 	the tSink to write to
+	@param[in] 		start 	the first character to write
+	@param[in] 		count 	the number of characters to write
+*/
+void sinkQuoted(tSink *sink, const char *start, size_t count)
+{
+	const char	*run = start;
+	const char	*end = start + count;
+	const char	*p;
+	char	escape[8];
+	int		c;
+
+	sinkChar(sink, '"');
+	for (p = start; p < end; ++p)
+	{
+		c = (byte)*p;
+		if (c == '"' || c == '\\' || c < ' ')
+		{
+			sinkWrite(sink, run, p - run);
+			run = p + 1;
+
+			switch (c)
+			{
+			case '\n':
+				sinkPuts(sink, "\\n");
+				break;
+
+			case '\r':
+				sinkPuts(sink, "\\r");
+				break;
+
+			case '\t':
+				sinkPuts(sink, "\\t");
+				break;
+
+			default:
+				if (c < ' ')
+				{
+					sprintf(escape, "\\u%04x", c);
+					sinkPuts(sink, escape);
+				}
+				else
+				{
+					sinkChar(sink, '\\');
+					sinkChar(sink, c);
+				}
+				break;
+			}
+		}
+	}
+	sinkWrite(sink, run, end - run);
+	sinkChar(sink, '"');
+}
@@ -0,0 +1,41 @@
+/**
+	@file sinkutils.h
+
+	Public interface for sinkutils.c
+
+	@version 0.92
+	@author Paul Chambers
+	@date 2005-2006
+*/
+/* $Header$ */
+
+/**
+	the size of a tSink's buffer. Output is only written
+	to the file when this much has accumulated.
+*/
+#define qSinkSize	65536
+
+/**
+	an output stream, buffered in memory.
+
+	The parser writes everything through a tSink, which only
+	passes the output on to the file in large blocks. If there
+	is no file, the output just accumulates in memory.
+*/
+typedef struct
+{
+	FILE	*file;		/**< where the output goes (NULL to keep it in memory) */
+	char	*data;		/**< output not yet written to the file */
+	size_t	length;		/**< number of characters in data */
+	size_t	size;		/**< space allocated to data */
+	bool	failed;		/**< set if a write or an allocation failed */
+} tSink;
+
+int initSink(tSink *sink, FILE *file);
+void resetSink(tSink *sink, FILE *file);
+void freeSink(tSink *sink);
+int flushSink(tSink *sink);
+void sinkWrite(tSink *sink, const char *start, size_t count);
+void sinkPuts(tSink *sink, const char *string);
+void sinkChar(tSink *sink, int c);
+void sinkQuoted(tSink *sink, const char *start, size_t count);
@@ -0,0 +1,340 @@
+/**
+	@file statsutils.c
+
+	Collects the statistics reported by --stats.
+
+	The parser only counts what it does (see countParser()), which
+	costs next to nothing. The timing is done per file, around each
+	phase of processing it, and only if --stats was given.
+
+	Files may be processed by several worker threads at once, so
+	everything that's collected here is protected by a mutex.
+
+	The report is written as JSON, so it's easy to compare between
+	runs, or releases.
+
+	@version 0.92
+	@author Paul Chambers
+	@date 2005-2006
+*/
+/* $Header$ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "common.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "sinkutils.h"
+#include "arenautils.h"
+#include "stringutils.h"
+#include "bufferutils.h"
+#include "parser.h"
+#include "statsutils.h"
+
+#ifdef qHaveThreads
+#include <pthread.h>
+#endif
+
+/**
+	wall clock and CPU time spent.
+*/
+typedef struct {
+	double	wall;	/**< wall clock time, in seconds */
+	double	cpu;	/**< CPU time, in seconds */
+} tDuration;
+
+/**
+	one of the slowest files.
+*/
+typedef struct {
+	char	*path;	/**< the file */
+	size_t	bytes;	/**< its size */
+	double	wall;	/**< how long it took to process */
+} tSlowFile;
+
+/** when the run started */
+static tTimestamp sStart;
+
+/** the time spent in each phase, over all files */
+static tDuration sPhases[qPhaseCount];
+
+/** the number of files with each outcome */
+static size_t sOutcomes[qFileOutcomes];
+
+/** what the parsers have done */
+static tParserCounts sCounts;
+
+/** the slowest files so far, slowest first */
+static tSlowFile sSlowest[qSlowestFiles];
+
+/** the number of files in sSlowest */
+static int sSlowCount;
+
+#ifdef qHaveThreads
+/** protects all of the above */
+static pthread_mutex_t sStatsLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static void lockStats(void);
+static void unlockStats(void);
+static void writeString(FILE *file, const char *string);
+static void writeDuration(FILE *file, const char *name,
+						  const tDuration *duration, const char *after);
+
+/*
+	private functions
+*/
+
+/**
+	@internal
+
+	Takes the lock that protects the statistics.
+*/
+static void lockStats(void)
+{
+#ifdef qHaveThreads
+	pthread_mutex_lock(&sStatsLock);
+#endif
+}
+
+/**
+	@internal
+
+	Releases the lock that protects the statistics.
+*/
+static void unlockStats(void)
+{
+#ifdef qHaveThreads
+	pthread_mutex_unlock(&sStatsLock);
+#endif
+}
+
+/**
+	@internal
+
+	Writes a string as a JSON string, escaping it as needed.
+
+	@param[in] 	file 	where to write it
+	@param[in] 	string 	the string to write
+*/
+static void writeString(FILE *file, const char *string)
+{
+	const byte	*p;
+
+	fputc('"', file);
+	for (p = (const byte *)string; *p != '\0'; ++p)
+	{
+		if (*p == '"' || *p == '\\')
+			fprintf(file, "\\%c", *p);
+		else if (*p < ' ')
+			fprintf(file, "\\u%04x", *p);
+		else
+			fputc(*p, file);
+	}
+	fputc('"', file);
+}
+
+/**
+	@internal
+
+	Writes a tDuration, as a JSON member.
+
+	@param[in] 	file 		where to write it
+	@param[in] 	name 		the member's name
+	@param[in] 	duration 	the tDuration to write
+	@param[in] 	after 		what follows it
+*/
+static void writeDuration(FILE *file, const char *name,
+						  const tDuration *duration, const char *after)
+{
+	fprintf(file, "\"%s\": { \"wall\": %.6f, \"cpu\": %.6f }%s",
+			name, duration->wall, duration->cpu, after);
+}
+
+/*
+	public functions
+*/
+
+/**
+	Starts the clock on a run.
+*/
+void initStats(void)
+{
+	takeTimestamp(&sStart);
+}
+
+/**
+	Notes the current time.
+
+	@param[out] ts 	receives the time
+*/
+void takeTimestamp(tTimestamp *ts)
+{
+#ifdef WIN32
+	ts->wall = (double)clock() / CLOCKS_PER_SEC;
+	ts->cpu = ts->wall;
+#else
+	struct timespec	now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ts->wall = now.tv_sec + now.tv_nsec / 1e9;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	ts->cpu = now.tv_sec + now.tv_nsec / 1e9;
+#endif
+}
+
+/**
+	Adds the time spent in one phase of processing a file.
+
+	@param[in] 	phase 	which phase (e.g. qPhaseRead)
+	@param[in] 	start 	when the phase started
+	@param[in] 	end 	when the phase ended
+*/
+void addPhase(int phase, const tTimestamp *start, const tTimestamp *end)
+{
+	lockStats();
+	sPhases[phase].wall += end->wall - start->wall;
+	sPhases[phase].cpu += end->cpu - start->cpu;
+	unlockStats();
+}
+
+/**
+	Adds a file that's been processed.
+
+	@param[in] 	path 	 	the file
+	@param[in] 	outcome 	what became of it (e.g. qFileRewritten)
+	@param[in] 	bytes 	 	its size (0 if it wasn't read)
+	@param[in] 	start 	 	when processing it started
+	@param[in] 	end 	 	when processing it finished
+*/
+void addFile(const char *path, int outcome, size_t bytes,
+			 const tTimestamp *start, const tTimestamp *end)
+{
+	double	wall = end->wall - start->wall;
+	char	*copy;
+	int		i;
+
+	lockStats();
+	++sOutcomes[outcome];
+
+	/* find where it belongs among the slowest */
+	i = sSlowCount;
+	while (i > 0 && sSlowest[i - 1].wall < wall)
+		--i;
+
+	if (i < qSlowestFiles)
+	{
+		copy = (char *)malloc(strlen(path) + 1);
+		if (copy != NULL)
+		{
+			strcpy(copy, path);
+
+			if (sSlowCount == qSlowestFiles)
+				free(sSlowest[--sSlowCount].path);
+
+			memmove(&sSlowest[i + 1], &sSlowest[i],
+					(sSlowCount - i) * sizeof(tSlowFile));
+			++sSlowCount;
+
+			sSlowest[i].path = copy;
+			sSlowest[i].bytes = bytes;
+			sSlowest[i].wall = wall;
+		}
+	}
+	unlockStats();
+}
+
+/**
+	Adds what a parser has done.
+
+	@param[in] 	counts 	the parser's counts (see countParser())
+*/
+void addCounts(const tParserCounts *counts)
+{
+	lockStats();
+	sCounts.bytes += counts->bytes;
+	sCounts.functions += counts->functions;
+	sCounts.documented += counts->documented;
+	sCounts.overflows += counts->overflows;
+	sCounts.allocations += counts->allocations;
+	unlockStats();
+}
+
+/**
+	Writes out the statistics collected, as a JSON object.
+
+	@param[in] 	filename 	where to write them ('-' for stdout)
+
+	@return int
+	@retval 0	all is well
+	@retval -2	unable to write the file
+*/
+int writeStats(const char *filename)
+{
+	FILE		*file;
+	tTimestamp	now;
+	tDuration	total;
+	int			i, result;
+
+#ifndef WIN32
+	struct timespec	cpu;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu);
+	total.cpu = cpu.tv_sec + cpu.tv_nsec / 1e9;
+#endif
+	takeTimestamp(&now);
+	total.wall = now.wall - sStart.wall;
+#ifdef WIN32
+	total.cpu = now.cpu - sStart.cpu;
+#endif
+
+	file = (strcmp(filename, "-") == 0) ? stdout : fopen(filename, "w");
+	if (file == NULL)
+		return (-2);
+
+	lockStats();
+
+	fprintf(file, "{\n  \"version\": \"%s\",\n", qVersion);
+	fprintf(file, "  \"files\": { \"skipped\": %lu, \"unchanged\": %lu,"
+				  " \"rewritten\": %lu, \"failed\": %lu },\n",
+			(unsigned long)sOutcomes[qFileSkipped],
+			(unsigned long)sOutcomes[qFileUnchanged],
+			(unsigned long)sOutcomes[qFileRewritten],
+			(unsigned long)sOutcomes[qFileFailed]);
+	fprintf(file, "  \"bytes\": %lu,\n", (unsigned long)sCounts.bytes);
+	fprintf(file, "  \"functions\": %lu,\n", (unsigned long)sCounts.functions);
+	fprintf(file, "  \"documented\": %lu,\n", (unsigned long)sCounts.documented);
+	fprintf(file, "  \"overflowFlushes\": %lu,\n", (unsigned long)sCounts.overflows);
+	fprintf(file, "  \"allocations\": %lu,\n", (unsigned long)sCounts.allocations);
+
+	fprintf(file, "  \"phases\": {\n    ");
+	writeDuration(file, "read", &sPhases[qPhaseRead], ",\n    ");
+	writeDuration(file, "parse", &sPhases[qPhaseParse], ",\n    ");
+	writeDuration(file, "commit", &sPhases[qPhaseCommit], "\n  },\n  ");
+	writeDuration(file, "total", &total, ",\n");
+
+	fprintf(file, "  \"slowest\": [");
+	for (i = 0; i < sSlowCount; ++i)
+	{
+		fprintf(file, "%s\n    { \"path\": ", i > 0 ? "," : "");
+		writeString(file, sSlowest[i].path);
+		fprintf(file, ", \"bytes\": %lu, \"wall\": %.6f }",
+				(unsigned long)sSlowest[i].bytes, sSlowest[i].wall);
+		free(sSlowest[i].path);
+	}
+	sSlowCount = 0;
+	fprintf(file, "%s]\n}\n", i > 0 ? "\n  " : "");
+
+	unlockStats();
+
+	result = ferror(file) ? -2 : 0;
+	if (file != stdout && fclose(file) != 0)
+		result = -2;
+
+	return result;
+}
@@ -0,0 +1,47 @@
+/**
+	@file statsutils.h
+
+	Public interface for statsutils.c
+
+	@version 0.92
+	@author Paul Chambers
+	@date 2005-2006
+*/
+/* $Header$ */
+
+/** how many of the slowest files to report */
+#define qSlowestFiles	10
+
+/*
+	the phases of processing a file, timed separately
+*/
+#define qPhaseRead		0	/**< reading the file into memory */
+#define qPhaseParse		1	/**< running the parser over it */
+#define qPhaseCommit	2	/**< replacing the file with the result */
+#define qPhaseCount		3	/**< the number of phases */
+
+/*
+	what became of a file
+*/
+#define qFileSkipped	0	/**< unchanged since it was last processed */
+#define qFileUnchanged	1	/**< processing it didn't change anything */
+#define qFileRewritten	2	/**< it was replaced by the result */
+#define qFileFailed		3	/**< something went wrong */
+#define qFileOutcomes	4	/**< the number of outcomes */
+
+/**
+	a moment, by the wall clock and by the CPU time
+	used so far by the current thread.
+*/
+typedef struct {
+	double	wall;	/**< in seconds, from some arbitrary point */
+	double	cpu;	/**< in seconds */
+} tTimestamp;
+
+void initStats(void);
+void takeTimestamp(tTimestamp *ts);
+void addPhase(int phase, const tTimestamp *start, const tTimestamp *end);
+void addFile(const char *path, int outcome, size_t bytes,
+			 const tTimestamp *start, const tTimestamp *end);
+void addCounts(const tParserCounts *counts);
+int writeStats(const char *filename);
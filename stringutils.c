@@ -16,7 +16,11 @@
 #include <string.h>
 #include <ctype.h>
 
+#include "arenautils.h"
+#include "sinkutils.h"
 #include "stringutils.h"
+#include "fileutils.h"
+#include "cacheutils.h"
 
 /**
 	Microsoft likes their slashes one way, everyone else the other...
@@ -27,6 +31,11 @@
 #define qOSPathSeparator	'/'
 #endif
 
+/** the number of slots a tSliceSet starts with (a power of two) */
+#define qFirstSetSlots	16
+
+static bool growSliceSet(tArena *arena, tSliceSet *set);
+
 /**
 	Returns a pointer to the filename element of a path.
 
@@ -169,88 +178,345 @@ char *skipPunct(char *ptr, char *end)
 	return p;
 }
 
-
 /**
-	Frees all memory allocated to a tStringList.
-	@note not thread safe
+	utility function to advance a pointer past a
+	template's arguments, e.g. '<int, vector<int> >'.
 
-	@param[in,out] 	sl 	the first element of the tStringList to free
+	@param[in] 	ptr 	points at the opening '<'
+	@param[in] 	end 	result must not point past this
+
+	@return points just past the matching '>', or returns 'end'
 */
-void freeStringList(tStringList **sl)
+char *skipAngles(char *ptr, char *end)
 {
-	tStringList	*element;
+	char *p = ptr;
+	int depth = 0;
+
+	while (p < end)
+	{
+		if (*p == '<')
+			++depth;
+		else if (*p == '>' && --depth == 0)
+			return p + 1;
+		++p;
+	}
+	return end;
+}
 
-	element = *sl;
+/**
+	utility function to move a pointer backwards
+	past a template's arguments.
 
-	while (element != NULL)
+	@param[in] 	ptr 	points just past the closing '>'
+	@param[in] 	start 	result must not point before this
+
+	@return points at the matching '<', or returns 'start'
+*/
+char *trimAngles(char *ptr, char *start)
+{
+	char *p = ptr;
+	int depth = 0;
+
+	while (p > start)
 	{
-		/* remove it from the list (not thread safe) */
-		*sl = element->next;
+		--p;
+		if (*p == '>')
+			++depth;
+		else if (*p == '<' && --depth == 0)
+			return p;
+	}
+	return start;
+}
+
+/**
+	utility function to check whether a comment is
+	already a Doxygen comment, i.e. a block comment
+	that opens with an extra '*' or a '!', or a line
+	comment that opens with '///' or '//!'.
 
-		/* free the string (if any) */
-		if (element->string != NULL)
-			free(element->string);
+	A run of asterisks or slashes (e.g. a banner, or an
+	empty comment) doesn't count.
+
+	@param[in] 	ptr 	the start of the comment
+	@param[in] 	end 	points just past the end of the comment
+
+	@return true if it's a Doxygen comment
+*/
+bool isDoxyComment(char *ptr, char *end)
+{
+	if (end - ptr < 4 || ptr[0] != '/')
+		return false;
 
-		/* free the structure itself */
-		free(element);
+	switch (ptr[1])
+	{
+	case '*':
+		return (bool)(ptr[2] == '!' || (ptr[2] == '*' && ptr[3] != '*' && ptr[3] != '/'));
 
-		/* prepare for the next iteration */
-		element = *sl;
+	case '/':
+		return (bool)(ptr[2] == '!' || (ptr[2] == '/' && ptr[3] != '/'));
 	}
+	return false;
 }
 
+
 /**
-	adds a new string to a tStringList.
+	adds a new slice to a tSliceList.
+
+	Nothing is copied - the element just records where the
+	characters are, relative to the start of the storage.
 
-	@param[in,out] 	sl 		the tStringList which will 
+	@param[in,out] 	arena 	where to allocate the new element
+	@param[in,out] 	sl 		the tSliceList which will 
 							recieve the new element
+	@param[in] 		base 	the start of the storage the slice is in
 	@param[in] 		start 	points at the first character
-							of the string to add
+							of the slice to add
 	@param[in]	 	end 	points just after the last
-							character of the string to add
+							character of the slice to add
+							(an end before start is treated as empty)
 */
-void addString(tStringList **sl, char *start, char * end)
+void addSlice(tArena *arena, tSliceList **sl,
+			  const char *base, const char *start, const char *end)
 {
-	tStringList *element;
-	size_t len;
+	tSliceList *element;
 	
-	element = (tStringList *)malloc(sizeof(tStringList));
+	element = (tSliceList *)arenaAlloc(arena, sizeof(tSliceList));
 	if (element != NULL)
 	{
-		len = (end - start);
-		element->string = (char *)malloc(len + 1);
-		if (element->string != NULL) 
-		{
-			memcpy(element->string, start, len);
-			element->string[len] = '\0';
-			
-			/* note: not thread-safe! */
-			element->next = *sl;
-			*sl = element;
-		}
+		element->start = start - base;
+		element->end = (end > start) ? (size_t)(end - base) : element->start;
+		
+		/* note: not thread-safe! */
+		element->next = *sl;
+		*sl = element;
 	}
 }
 
 /**
-	Writes out all the elements of a tStringList.
+	Writes out all the elements of a tSliceList.
 
 	Outputs one element per line, prefixed with the string provided.
+	The slices are written straight from the storage they refer to.
 
-	@param[in] 	file 	the output file
-	@param[in] 	sl 		the tStringList to dump
+	@param[in,out] 	sink 	where to write them
+	@param[in] 	sl 		the tSliceList to dump
+	@param[in] 	base 	the start of the storage the slices are in
 	@param[in] 	prefix 	prefix each item with this string
 */
-void dumpStringList(FILE *file, tStringList *sl, char *prefix)
+void dumpSliceList(tSink *sink, tSliceList *sl, const char *base, char *prefix)
 {
-	tStringList *element;
+	tSliceList *element;
 	
 	element = sl;
 	while (element != NULL)
 	{
-		if (element->string == NULL)
-			fprintf(file, "\n%s<null>", prefix);
-		else
-			fprintf(file, "\n%s%s", prefix, element->string);
+		sinkChar(sink, '\n');
+		sinkPuts(sink, prefix);
+		sinkWrite(sink, &base[element->start],
+				  element->end - element->start);
 		element = element->next;
 	}
 }
+
+/**
+	@internal
+
+	Gives a tSliceSet a bigger hash table, or its first one. The old
+	table stays in the arena until the arena is reset.
+
+	@param[in,out] 	arena 	where to allocate the new table
+	@param[in,out] 	set 	the tSliceSet to grow
+
+	@return false if there isn't the memory for it
+*/
+static bool growSliceSet(tArena *arena, tSliceSet *set)
+{
+	tSetSlot	*slots;
+	size_t	count, mask, i, j;
+
+	count = (set->slotCount == 0) ? qFirstSetSlots : set->slotCount * 2;
+	slots = (tSetSlot *)arenaAlloc(arena, count * sizeof(tSetSlot));
+	if (slots == NULL)
+		return false;
+
+	for (i = 0; i < count; ++i)
+		slots[i].element = NULL;
+
+	mask = count - 1;
+	for (i = 0; i < set->slotCount; ++i)
+	{
+		if (set->slots[i].element != NULL)
+		{
+			j = set->slots[i].hash & mask;
+			while (slots[j].element != NULL)
+				j = (j + 1) & mask;
+			slots[j] = set->slots[i];
+		}
+	}
+
+	set->slots = slots;
+	set->slotCount = count;
+
+	return true;
+}
+
+/**
+	Empties a tSliceSet. Any storage it had came from an arena,
+	so this just forgets it.
+
+	@param[out] set 	the tSliceSet to empty
+*/
+void clearSliceSet(tSliceSet *set)
+{
+	set->first = NULL;
+	set->last = &set->first;
+	set->slots = NULL;
+	set->slotCount = 0;
+	set->count = 0;
+}
+
+/**
+	adds a slice to the end of a tSliceSet, unless the set already
+	holds a slice with the same characters.
+
+	Like addSlice(), nothing is copied. The slices are compared
+	through base, so it must be where the storage is now, even
+	if it has moved since earlier slices were added.
+
+	@param[in,out] 	arena 	where to allocate the new element
+	@param[in,out] 	set 	the tSliceSet which will
+							recieve the new element
+	@param[in] 		base 	the start of the storage the slice is in
+	@param[in] 		start 	points at the first character
+							of the slice to add
+	@param[in]	 	end 	points just after the last
+							character of the slice to add
+							(an end before start is treated as empty)
+*/
+void addUniqueSlice(tArena *arena, tSliceSet *set,
+					const char *base, const char *start, const char *end)
+{
+	tSliceList	*element;
+	tSetSlot	*slot;
+	unsigned long	hash;
+	size_t	length, mask, i;
+
+	length = (end > start) ? (size_t)(end - start) : 0;
+	hash = (unsigned long)hashBlock(start, length);
+
+	/* keep at least half the slots free, so probes stay short */
+	if ((set->count + 1) * 2 > set->slotCount
+	 && !growSliceSet(arena, set))
+		return;
+
+	mask = set->slotCount - 1;
+	i = hash & mask;
+	while ((slot = &set->slots[i])->element != NULL)
+	{
+		element = slot->element;
+		if (slot->hash == hash
+		 && element->end - element->start == length
+		 && memcmp(&base[element->start], start, length) == 0)
+			return;
+
+		i = (i + 1) & mask;
+	}
+
+	element = (tSliceList *)arenaAlloc(arena, sizeof(tSliceList));
+	if (element != NULL)
+	{
+		element->start = start - base;
+		element->end = element->start + length;
+		element->next = NULL;
+
+		*set->last = element;
+		set->last = &element->next;
+
+		slot->element = element;
+		slot->hash = hash;
+		++set->count;
+	}
+}
+
+/**
+	Sets up an empty tBuilder. Nothing is allocated
+	until something is appended.
+
+	@param[out] b 	the tBuilder to set up
+*/
+void initBuilder(tBuilder *b)
+{
+	b->data = NULL;
+	b->length = 0;
+	b->size = 0;
+	b->failed = false;
+}
+
+/**
+	Empties a tBuilder, keeping its storage.
+
+	@param[in,out] 	b 	the tBuilder to clear
+*/
+void clearBuilder(tBuilder *b)
+{
+	b->length = 0;
+	if (b->data != NULL)
+		b->data[0] = '\0';
+	b->failed = false;
+}
+
+/**
+	Releases a tBuilder's storage.
+
+	@param[in,out] 	b 	the tBuilder to free
+*/
+void freeBuilder(tBuilder *b)
+{
+	free(b->data);
+	initBuilder(b);
+}
+
+/**
+	Appends a block of characters to a tBuilder, growing its
+	storage geometrically if they don't fit. If it can't grow,
+	the characters are left out, and the tBuilder is marked
+	as having failed.
+
+	@param[in,out] 	b 		the tBuilder to append to
+	@param[in] 		start 	the first character to append
+	@param[in] 		count 	the number of characters to append
+*/
+void appendBlock(tBuilder *b, const char *start, size_t count)
+{
+	char	*data;
+	size_t	size;
+
+	if (b->size - b->length <= count)
+	{
+		for (size = (b->size < 64) ? 64 : b->size; size - b->length <= count; size *= 2)
+			;
+		data = (char *)realloc(b->data, size);
+		if (data == NULL)
+		{
+			b->failed = true;
+			return;
+		}
+		b->data = data;
+		b->size = size;
+	}
+
+	memcpy(&b->data[b->length], start, count);
+	b->length += count;
+	b->data[b->length] = '\0';
+}
+
+/**
+	Appends a nul-terminated string to a tBuilder.
+
+	@param[in,out] 	b 		the tBuilder to append to
+	@param[in] 		string 	the string to append
+*/
+void appendString(tBuilder *b, const char *string)
+{
+	appendBlock(b, string, strlen(string));
+}
@@ -19,16 +19,76 @@ char *trimSpace(char *ptr, char *start);
 char *skipComment(char *ptr, char *end);
 char *trimComment(char *ptr, char *start);
 char *skipPunct(char *ptr, char *end);
+char *skipAngles(char *ptr, char *end);
+char *trimAngles(char *ptr, char *start);
+bool isDoxyComment(char *ptr, char *end);
 
 /**
-	one element of a linked list of strings.
+	one element of a linked list of slices of some other storage.
+
+	The slice is recorded as offsets from the start of the storage,
+	rather than as pointers, so it stays valid if the storage moves.
+*/
+typedef struct tSliceList
+{
+	struct tSliceList	*next;	/**< pointer to the next element in the linked list */
+	size_t	start;				/**< offset of the first character of the slice */
+	size_t	end;				/**< offset just past the last character of the slice */
+} tSliceList;
+
+void addSlice(tArena *arena, tSliceList **sl,
+			  const char *base, const char *start, const char *end);
+void dumpSliceList(tSink *sink, tSliceList *sl, const char *base, char *prefix);
+
+/**
+	one slot of a tSliceSet's hash table.
+*/
+typedef struct
+{
+	tSliceList	*element;	/**< the slice in this slot, NULL if it's free */
+	unsigned long	hash;	/**< the hash of the slice's characters */
+} tSetSlot;
+
+/**
+	a list of slices that holds only one of each, kept in the order
+	they were added.
+
+	A hash table of the slices is kept alongside the list, so a
+	duplicate is spotted without walking the list. Everything is
+	allocated from an arena, so the set is emptied by resetting the
+	arena and calling clearSliceSet().
+*/
+typedef struct
+{
+	tSliceList	*first;		/**< the slices, oldest first */
+	tSliceList	**last;		/**< where to link the next slice */
+	tSetSlot	*slots;		/**< the hash table, NULL until the first slice */
+	size_t	slotCount;		/**< the number of slots (a power of two) */
+	size_t	count;			/**< the number of slices in the set */
+} tSliceSet;
+
+void clearSliceSet(tSliceSet *set);
+void addUniqueSlice(tArena *arena, tSliceSet *set,
+					const char *base, const char *start, const char *end);
+
+/**
+	a string that's built up a piece at a time.
+
+	The length is kept, so appending never has to look for the end
+	of the string first, and the storage grows as needed, so nothing
+	is cut short. The storage is kept when the string is cleared,
+	to be reused.
 */
-typedef struct tStringList
+typedef struct
 {
-	struct tStringList	*next;	/**< pointer to the next element in the linked list */
-	char	*string;			/**< pointer to the actual string */
-} tStringList;
+	char	*data;		/**< the string, always nul-terminated (once allocated) */
+	size_t	length;		/**< the number of characters, not counting the nul */
+	size_t	size;		/**< the space allocated to data */
+	bool	failed;		/**< set if it couldn't grow, so part is missing */
+} tBuilder;
 
-void freeStringList(tStringList **sl);
-void addString(tStringList **sl,char *start, char * end);
-void dumpStringList(FILE *file, tStringList *sl, char *prefix);
+void initBuilder(tBuilder *b);
+void clearBuilder(tBuilder *b);
+void freeBuilder(tBuilder *b);
+void appendBlock(tBuilder *b, const char *start, size_t count);
+void appendString(tBuilder *b, const char *string);
@@ -0,0 +1,219 @@
+/**
+	@file typeutils.c
+
+	Remembers how processTyped() has described each type, so
+	the same declaration doesn't have to be taken apart again.
+
+	The same few types ('const char *', 'size_t', 'tBuffer *')
+	turn up over and over again, in every file, so what's
+	remembered is shared by all of the files in a run, and
+	by all of the threads processing them.
+
+	A type is remembered by exactly the text that declares it,
+	up to the identifier, and whether it's an array, since
+	that's all its description depends on.
+
+	@version 0.92
+	@author Paul Chambers
+	@date 2005-2006
+*/
+/* $Header$ */
+
+#include "common.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "arenautils.h"
+#include "sinkutils.h"
+#include "stringutils.h"
+#include "fileutils.h"
+#include "cacheutils.h"
+#include "typeutils.h"
+
+#ifdef qHaveThreads
+#include <pthread.h>
+#endif
+
+/** the number of slots in the hash table */
+#define qTypeSlots	4096
+
+/**
+	one type that's been described.
+*/
+typedef struct tTypeEntry
+{
+	struct tTypeEntry	*next;	/**< the next entry in the same slot */
+	tHash	key;			/**< hash of the declaration, to speed up lookups */
+	size_t	length;			/**< the length of the declaration */
+	size_t	typeLength;		/**< the length of the description */
+	bool	isArray;		/**< the identifier was followed by [] */
+	bool	isStatic;		/**< the declaration was static */
+	bool	inOnly;			/**< the guess at the argument's direction */
+	char	text[1];		/**< the declaration, then the description and
+								 a nul, extends past the end of the struct */
+} tTypeEntry;
+
+/** the hash table */
+static tTypeEntry *sSlots[qTypeSlots];
+
+/** the number of entries in the table */
+static size_t sTypeCount;
+
+#ifdef qHaveThreads
+/** protects sSlots and sTypeCount */
+static pthread_mutex_t sTypeLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static tTypeEntry *findType(const char *decl, size_t length,
+							bool isArray, tHash key);
+
+/*
+	private functions
+*/
+
+/**
+	@internal
+
+	Finds the entry for a declaration. The table must be locked.
+
+	@param[in] 	decl 	the declaration
+	@param[in] 	length 	its length
+	@param[in] 	isArray whether it's an array
+	@param[in] 	key 	the hash of the declaration
+
+	@return the entry
+	@retval NULL	it isn't in the table
+*/
+static tTypeEntry *findType(const char *decl, size_t length,
+							bool isArray, tHash key)
+{
+	tTypeEntry	*entry = sSlots[key % qTypeSlots];
+
+	while (entry != NULL
+		&& (entry->key != key || entry->length != length
+		 || entry->isArray != isArray
+		 || memcmp(entry->text, decl, length) != 0))
+	{
+		entry = entry->next;
+	}
+
+	return entry;
+}
+
+/*
+	public functions
+*/
+
+/**
+	Looks for the description of a type that's been seen before.
+
+	@param[in] 	decl 	 	the declaration, up to the identifier
+	@param[in] 	length 	 	the length of the declaration
+	@param[in] 	isArray  	whether the identifier was followed by []
+	@param[out] type 	 	receives the description, if it's found
+	@param[out] isStatic 	receives whether it was static
+	@param[out] inOnly 	 	receives the guess at the argument's direction
+
+	@return true if it was found
+*/
+bool recallType(const char *decl, size_t length, bool isArray,
+				tBuilder *type, bool *isStatic, bool *inOnly)
+{
+	tTypeEntry	*entry;
+
+	if (length > qMaxTypeKey)
+		return false;
+
+#ifdef qHaveThreads
+	pthread_mutex_lock(&sTypeLock);
+#endif
+	entry = findType(decl, length, isArray, hashBlock(decl, length));
+#ifdef qHaveThreads
+	pthread_mutex_unlock(&sTypeLock);
+#endif
+	if (entry == NULL)
+		return false;
+
+	/* entries never change once they're in the table */
+	clearBuilder(type);
+	appendBlock(type, &entry->text[length], entry->typeLength);
+	*isStatic = entry->isStatic;
+	*inOnly = entry->inOnly;
+
+	return true;
+}
+
+/**
+	Remembers the description of a type. Nothing is remembered if
+	there isn't the memory for it, or enough have been already.
+
+	@param[in] 	decl 	 	the declaration, up to the identifier
+	@param[in] 	length 	 	the length of the declaration
+	@param[in] 	isArray  	whether the identifier was followed by []
+	@param[in] 	type 	 	its description
+	@param[in] 	isStatic 	whether it was static
+	@param[in] 	inOnly 	 	the guess at the argument's direction
+*/
+void rememberType(const char *decl, size_t length, bool isArray,
+				  const tBuilder *type, bool isStatic, bool inOnly)
+{
+	tTypeEntry	*entry;
+	tHash	key;
+
+	if (length > qMaxTypeKey || type->failed)
+		return;
+
+	entry = (tTypeEntry *)malloc(sizeof(tTypeEntry) + length + type->length);
+	if (entry == NULL)
+		return;
+
+	key = hashBlock(decl, length);
+	entry->key = key;
+	entry->length = length;
+	entry->typeLength = type->length;
+	entry->isArray = isArray;
+	entry->isStatic = isStatic;
+	entry->inOnly = inOnly;
+	memcpy(entry->text, decl, length);
+	memcpy(&entry->text[length], type->data, type->length);
+	entry->text[length + type->length] = '\0';
+
+#ifdef qHaveThreads
+	pthread_mutex_lock(&sTypeLock);
+#endif
+	/* another thread may have got there first */
+	if (sTypeCount < qMaxTypes && findType(decl, length, isArray, key) == NULL)
+	{
+		entry->next = sSlots[key % qTypeSlots];
+		sSlots[key % qTypeSlots] = entry;
+		++sTypeCount;
+		entry = NULL;
+	}
+#ifdef qHaveThreads
+	pthread_mutex_unlock(&sTypeLock);
+#endif
+
+	free(entry);
+}
+
+/**
+	Forgets every type that's been remembered, releasing the memory.
+	Only to be called once nothing else is using them.
+*/
+void forgetTypes(void)
+{
+	tTypeEntry	*entry;
+	int		i;
+
+	for (i = 0; i < qTypeSlots; ++i)
+	{
+		while ((entry = sSlots[i]) != NULL)
+		{
+			sSlots[i] = entry->next;
+			free(entry);
+		}
+	}
+	sTypeCount = 0;
+}
@@ -0,0 +1,22 @@
+/**
+	@file typeutils.h
+
+	Public interface for typeutils.c
+
+	@version 0.92
+	@author Paul Chambers
+	@date 2005-2006
+*/
+/* $Header$ */
+
+/** the longest declaration whose description is remembered */
+#define qMaxTypeKey		128
+
+/** the most descriptions remembered, so a huge tree can't use up memory */
+#define qMaxTypes		8192
+
+bool recallType(const char *decl, size_t length, bool isArray,
+				tBuilder *type, bool *isStatic, bool *inOnly);
+void rememberType(const char *decl, size_t length, bool isArray,
+				  const tBuilder *type, bool isStatic, bool inOnly);
+void forgetTypes(void);